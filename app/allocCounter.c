@@ -0,0 +1,123 @@
+// allocCounter.c
+// Feeds light_sampler's heap allocations to Realtime_countAllocation()
+// (see hal/realtime.h). Lives in the application, not the HAL, so other
+// programs linking the HAL keep the normal allocator.
+//
+//   - AddressSanitizer builds, which own malloc: an allocation hook
+//     installed with __sanitizer_install_malloc_and_free_hooks().
+//   - Normal builds: the executable defines the whole malloc family, as
+//     glibc requires of a replacement, so libc's internal calls resolve here
+//     too. Every function forwards to glibc's own implementation, so all
+//     blocks stay glibc's; only the allocating ones count.
+
+#define _GNU_SOURCE
+#include "hal/realtime.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+// From sanitizer/allocator_interface.h, which not every toolchain installs
+int __sanitizer_install_malloc_and_free_hooks(void (*malloc_hook)(const volatile void *, size_t),
+                                              void (*free_hook)(const volatile void *));
+
+static void on_asan_malloc(const volatile void *p, size_t size)
+{
+    (void)p; (void)size;
+    Realtime_countAllocation();
+}
+
+static void on_asan_free(const volatile void *p)
+{
+    (void)p;   // ASan refuses to install a malloc hook without one
+}
+
+__attribute__((constructor)) static void install_alloc_hook(void)
+{
+    int ok = __sanitizer_install_malloc_and_free_hooks(on_asan_malloc, on_asan_free);
+    Realtime_setAllocCheckAvailable(ok != 0);
+}
+
+#else
+#include <dlfcn.h>
+#include <errno.h>
+
+extern void *__libc_malloc(size_t size);
+extern void  __libc_free(void *p);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+
+// glibc has no __libc_ alias for this one
+static size_t (*s_usableSize)(void *p);
+
+__attribute__((constructor)) static void install_alloc_counter(void)
+{
+    *(void **)&s_usableSize = dlsym(RTLD_NEXT, "malloc_usable_size");   // POSIX's idiom
+    Realtime_setAllocCheckAvailable(true);
+}
+
+void *malloc(size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_malloc(size);
+}
+
+void free(void *p)
+{
+    __libc_free(p);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_realloc(p, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) return EINVAL;
+    Realtime_countAllocation();
+    void *p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size)
+{
+    Realtime_countAllocation();
+    return __libc_pvalloc(size);
+}
+
+size_t malloc_usable_size(void *p)
+{
+    return p && s_usableSize ? s_usableSize(p) : 0;
+}
+#endif
@@ -26,33 +26,63 @@
 #include "hal/PWM.h"
 #include "hal/rotary_encoder.h"
 #include "hal/UDP.h"
+#include "hal/tcpBulk.h"
+#include "hal/flightRecorder.h"
+#include "hal/simulation.h"
+#include "hal/medianFilter.h"
+#include "hal/loopback.h"
+#include "hal/freqSweep.h"
+#include "hal/threadConfig.h"
+#include "hal/realtime.h"
+#include "hal/historyCache.h"
+#include "hal/reactor.h"
+#include "hal/uring.h"
+#include "hal/statusWriter.h"
+#include "hal/trace.h"
+#include "hal/metrics.h"
+#include "hal/overrun.h"
+#include "hal/threadStats.h"
+#include "hal/pwmControl.h"
+#include "hal/startup.h"
 #include <stdio.h> // fopen, fprintf, fclose, perror
 #include <stdlib.h>  // exit, EXIT_FAILURE, EXIT_SUCCESS
 #include <stdbool.h>
 #include <time.h>
 #include <stdarg.h>  // for va_list, va_start, va_end
 #include <signal.h>  // for signal handling
+#include <getopt.h>  // for command-line options
+#include <unistd.h>  // sysconf
+#include <sys/resource.h>  // getrusage
 
 #define MS_IN_SECOND 1000
 
 // Flag to indicate when the program should exit
 static volatile bool running = true;
+// Set by SIGUSR1; the trace is written at the next second boundary
+static volatile sig_atomic_t trace_dump_requested = 0;
 
 // Signal handler for CTRL+C
 static void cleanup_handler(int signo) {
     if (signo == SIGINT) {
         printf("\nReceived CTRL+C, cleaning up...\n");
         running = false;
+        Reactor_stop();
+    } else if (signo == SIGUSR1) {
+        trace_dump_requested = 1;
     }
 }
 
 // Function to cleanup all resources
 static void cleanup_resources(void) {
-    // Stop UDP server
+    // Stop network servers
+    Metrics_stopServer();
+    tcp_bulk_stop();
     udp_stop();
+    PwmControl_stop();   // after UDP, which posts to it
     
     // Cleanup all modules in reverse order of initialization
     PWM_disable();
+    Recorder_stop();     // reads from the sampler's ring, so stop it first
     Sampler_cleanup();
     rotary_close();
     Period_cleanup();
@@ -60,14 +90,57 @@ static void cleanup_resources(void) {
     printf("Cleanup complete. Exiting.\n");
 }
 
-// Current PWM frequency (Hz). Made global so UDP control callbacks can access it.
-static int current_freq = 1;
 static bool console_output_enabled = true;  // Allow disabling console output
 
-// Format and display status each second (fixed-width fields for stable alignment)
+// --perf-status: per-thread rates over the last second, from alternating snapshots
+static bool perf_status = false;
+static ThreadStatsSnapshot perf_snaps[2];
+static int perf_cur = 0;
+static int perf_taken = 0;
+
+static void sample_perf(void) {
+    perf_cur ^= 1;
+    ThreadStats_sample(&perf_snaps[perf_cur]);
+    if (perf_taken < 2) perf_taken++;
+}
+
+static void display_perf(bool json) {
+    if (perf_taken < 2) return;
+    const ThreadStatsSnapshot *prev = &perf_snaps[perf_cur ^ 1], *cur = &perf_snaps[perf_cur];
+    bool first = true;
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        ThreadPerf p;
+        ThreadStats_diff(prev, cur, i, &p);
+        if (!p.valid) continue;
+        if (json) {
+            StatusWriter_printf("%s\"%s\":{\"cpu\":%.2f,\"vcs\":%.0f,\"ivcs\":%.0f,\"wait\":%.3f}",
+                                first ? ",\"threads\":{" : ",", ThreadConfig_name(i),
+                                p.cpuPct, p.volPerSec, p.involPerSec, p.waitPct);
+        } else {
+            StatusWriter_printf("%s %s %.1f/%.2f", first ? "Threads cpu%/wait%:" : "",
+                                ThreadConfig_name(i), p.cpuPct, p.waitPct);
+        }
+        first = false;
+    }
+    if (!first) StatusWriter_printf(json ? "}" : "\n");
+}
+
+// Index of the k-th of up to 10 evenly-spaced samples out of history_size
+static int shown_index(int k, int history_size)
+{
+    if (history_size <= 10) return k;
+    // Map k in [0,9] to an index in [0,history_size-1]
+    // round((k * (N-1)) / 9.0)
+    double pos = (double)k * (double)(history_size - 1) / 9.0;
+    return (int)(pos + 0.5);
+}
+
+// Format and display status each second (fixed-width fields for stable alignment).
+// Formatted into the status writer's queue; its own thread does the printing.
 static void display_status(
     int samples_in_second,
     int led_hz,
+    double measured_hz,
     double avg_light,
     int dips,
     const Period_statistics_t *light_stats,
@@ -76,38 +149,66 @@ static void display_status(
 {
     // Line 1: counts and levels
     // Fields are fixed-width to keep columns aligned as values change
-    printf("\nSamples: %4d  LED: %3d Hz  avg: %6.3fV  Dips: %3d   ",
-           samples_in_second, led_hz, avg_light, dips);
+    StatusWriter_printf("\nSamples: %4d  LED: %3d Hz  f: %5.1fHz  avg: %6.3fV  Dips: %3d   ",
+                        samples_in_second, led_hz, measured_hz, avg_light, dips);
 
     // Timing jitter information for samples collected during the previous second
     // Format: Smpl ms[{min}, {max}] avg {avg}/{num-samples}
     if (light_stats) {
-        printf("Smpl ms[%6.1f, %6.1f] avg %6.1f/%4d\n",
-               light_stats->minPeriodInMs,
-               light_stats->maxPeriodInMs,
-               light_stats->avgPeriodInMs,
-               light_stats->numSamples);
+        StatusWriter_printf("Smpl ms[%6.1f, %6.1f] avg %6.1f/%4d\n",
+                            light_stats->minPeriodInMs,
+                            light_stats->maxPeriodInMs,
+                            light_stats->avgPeriodInMs,
+                            light_stats->numSamples);
     }
 
     // Line 2: up to 10 evenly-spaced samples from the previous second
     if (history_samples && history_size > 0) {
         int to_show = history_size < 10 ? history_size : 10;
-        // Evenly spaced indices across [0, history_size-1]
         for (int k = 0; k < to_show; k++) {
-            int idx;
-            if (history_size <= 10) {
-                idx = k;
-            } else {
-                // Map k in [0,9] to an index in [0,history_size-1]
-                // round((k * (N-1)) / 9.0)
-                double pos = (double)k * (double)(history_size - 1) / 9.0;
-                idx = (int)(pos + 0.5);
-            }
+            int idx = shown_index(k, history_size);
             // Print as {sample number}:{value} with stable widths
-            printf(" %4d:%6.3f", idx, history_samples[idx]);
+            StatusWriter_printf(" %4d:%6.3f", idx, history_samples[idx]);
         }
-        printf("\n");
+        StatusWriter_printf("\n");
+    }
+}
+
+// Same status as one JSON object per line, for log shippers
+static void display_status_json(
+    int samples_in_second,
+    int led_hz,
+    double measured_hz,
+    double avg_light,
+    int dips,
+    const Period_statistics_t *light_stats,
+    const double *history_samples,
+    int history_size)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    StatusWriter_printf("{\"time\":%lld.%03ld,\"samples\":%d,\"led_hz\":%d,"
+                        "\"measured_hz\":%.2f,\"avg_v\":%.4f,\"dips\":%d",
+                        (long long)now.tv_sec, now.tv_nsec / 1000000,
+                        samples_in_second, led_hz, measured_hz, avg_light, dips);
+    if (light_stats) {
+        StatusWriter_printf(",\"period_ms\":{\"min\":%.3f,\"max\":%.3f,\"avg\":%.3f,\"n\":%d}",
+                            light_stats->minPeriodInMs, light_stats->maxPeriodInMs,
+                            light_stats->avgPeriodInMs, light_stats->numSamples);
+    }
+    StatusWriter_printf(",\"history\":[");
+    int to_show = history_samples ? (history_size < 10 ? history_size : 10) : 0;
+    for (int k = 0; k < to_show; k++) {
+        int idx = shown_index(k, history_size);
+        StatusWriter_printf("%s[%d,%.4f]", k ? "," : "", idx, history_samples[idx]);
+    }
+    StatusWriter_printf("],\"overruns\":{");
+    for (int k = 0; k < OVERRUN_KIND_COUNT; k++) {
+        StatusWriter_printf("%s\"%s\":%lld", k ? "," : "", Overrun_name(k), Overrun_get(k).count);
     }
+    StatusWriter_printf("}");
+    if (perf_status) display_perf(true);
+    StatusWriter_printf(",\"dropped\":%lld}\n", StatusWriter_dropped());
 }
 
 // (Removed) send_status helper was used for UDP + console combined output.
@@ -119,41 +220,543 @@ static bool cb_set_console_output(bool enabled) {
     return true;
 }
 
+// Both only post to the PWM owner; "OK" means the value was accepted
 static bool cb_set_frequency(int hz) {
-    if (hz <= 0 || hz > 1000) return false;
-    // Keep duty at 50% when changing frequency via this simple wrapper
-    bool ok = PWM_setFrequency(hz, 50);
-    if (ok) current_freq = hz;
-    return ok;
+    return PwmControl_requestFrequency(hz, 0);
 }
 static bool cb_set_duty(int pct) {
-    if (pct < 0 || pct > 100) return false;
-    // Reuse PWM_setFrequency helper to compute period+duty in ns
-    return PWM_setFrequency(current_freq, pct);
+    return PwmControl_requestDuty(pct, 0);
+}
+
+// Command-line options
+static const char *record_path = NULL;      // --record FILE
+static int record_mb = RECORDER_DEFAULT_MB; // --record-mb N
+static int sample_rate = 1000;              // --rate HZ
+static int stats_windows[SAMPLER_MAX_STATS_WINDOWS]; // --stats MS[,MS...]
+static int num_stats_windows = -1;          // -1: sampler defaults
+static int median_width = 0;                // --median W[:THRESHOLD]
+static double median_threshold = 0;
+static const char *filter_spec = NULL;      // --filter SPEC
+static int latency_steps = 0;               // --latency N
+static const char *sweep_spec = NULL;       // --sweep[=FROM:TO:STEP]
+static const char *sweep_out = NULL;        // --sweep-out FILE
+static const char *thread_spec = NULL;      // --threads SPEC
+static bool realtime_mode = false;          // --realtime
+static bool threaded_mode = false;          // --threaded
+static bool json_output = false;            // --output json
+static const char *trace_path = NULL;       // --trace
+static int metrics_port = METRICS_DEFAULT_PORT; // --metrics-port (0: off)
+static int pwm_interval_ms = PWM_CONTROL_DEFAULT_INTERVAL_MS; // --pwm-interval
+
+// Preallocated copy of each second's history for the status display
+static double *display_samples = NULL;
+static int display_capacity = 0;
+
+static void print_usage(FILE *out, const char *prog) {
+    fprintf(out, "Usage: %s [options]\n"
+           "  --record FILE    keep a crash-safe flight recording of all samples in FILE\n"
+           "  --record-mb N    size of the recording file in MiB (default %d)\n"
+           "  --rate HZ        light sampling rate (default 1000, max 15000)\n"
+           "  --stats MS,...   sliding statistics windows in ms (default 100,1000,10000)\n"
+           "  --median W[:V]   median prefilter of W samples before dip detection; with V,\n"
+           "                   only replace samples more than V volts from the median\n"
+           "  --filter SPEC    filter/decimate the stored history, e.g. \"decim=4,notch=60\"\n"
+           "                   (see hal/filterChain.h)\n"
+           "  --latency N      measure PWM-to-sensor latency over N LED steps, then exit\n"
+           "  --sweep[=RANGE]  step the LED over RANGE (default %s, \"FROM:TO:STEP\"\n"
+           "                   or \"FROM:TO:xFACTOR\"), report dips vs flash rate, then exit\n"
+           "  --sweep-out FILE write the sweep as CSV, or JSON if FILE ends in .json\n"
+           "  --threads SPEC   CPU affinity and scheduling per thread, e.g.\n"
+           "                   \"sampler=cpu1:fifo80,udp=cpu0\" (see hal/threadConfig.h)\n"
+           "  --realtime       preallocate everything, lock memory and check that no heap\n"
+           "                   allocation happens after start-up (exit status 1 if one does)\n"
+           "  --io-uring       use io_uring for UDP receive/history replies and PWM writes,\n"
+           "                   where the kernel supports it\n"
+           "  --trace[=FILE]   record trace points; SIGUSR1 or the UDP \"trace\" command writes\n"
+           "                   them to FILE (default %s) as Chrome trace JSON\n"
+           "  --metrics-port P serve Prometheus metrics at http://HOST:P/metrics\n"
+           "                   (default %d, 0 to turn off)\n"
+           "  --pwm-interval MS\n"
+           "                   write knob/UDP LED changes at most once every MS ms\n"
+           "                   (default %d, 0 to write every change)\n"
+           "  --perf-status    add per-thread CPU%% and run-queue wait to the status\n"
+           "  --output FORMAT  status each second as \"text\" (default) or \"json\" lines\n"
+           "  --threaded       run UDP, TCP, rotary and the main loop on their own threads\n"
+           "                   instead of one event loop (the old layout, for comparison)\n"
+           "  --sim[=SPEC]     run on a host with simulated ADC, PWM and rotary encoder\n"
+           "                   (SPEC e.g. \"noise=0.01,rotary=+10@2;-5@8\", see hal/simulation.h)\n"
+           "  --help           show this message\n",
+           prog, RECORDER_DEFAULT_MB, SWEEP_DEFAULT_SPEC, TRACE_DEFAULT_PATH,
+           METRICS_DEFAULT_PORT, PWM_CONTROL_DEFAULT_INTERVAL_MS);
+}
+
+typedef enum {
+    OPTIONS_RUN,        // go ahead
+    OPTIONS_HELP,       // --help was printed; exit successfully
+    OPTIONS_INVALID     // bad option or value, reported on stderr; exit with failure
+} OptionsResult;
+
+static OptionsResult parse_options(int argc, char *argv[]) {
+    static const struct option opts[] = {
+        { "record",    required_argument, NULL, 'r' },
+        { "record-mb", required_argument, NULL, 'm' },
+        { "rate",      required_argument, NULL, 'R' },
+        { "stats",     required_argument, NULL, 'S' },
+        { "median",    required_argument, NULL, 'M' },
+        { "filter",    required_argument, NULL, 'f' },
+        { "latency",   required_argument, NULL, 'L' },
+        { "sweep",     optional_argument, NULL, 'w' },
+        { "sweep-out", required_argument, NULL, 'o' },
+        { "threads",   required_argument, NULL, 't' },
+        { "realtime",  no_argument,       NULL, 'T' },
+        { "threaded",  no_argument,       NULL, 'P' },
+        { "io-uring",  no_argument,       NULL, 'U' },
+        { "output",    required_argument, NULL, 'O' },
+        { "trace",     optional_argument, NULL, 'X' },
+        { "metrics-port", required_argument, NULL, 'Q' },
+        { "perf-status", no_argument,     NULL, 'F' },
+        { "pwm-interval", required_argument, NULL, 'I' },
+        { "sim",       optional_argument, NULL, 's' },
+        { "help",      no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'r': record_path = optarg; break;
+        case 'm': record_mb = atoi(optarg); break;
+        case 'R': sample_rate = atoi(optarg); break;
+        case 'S': {
+            num_stats_windows = 0;
+            for (char *tok = strtok(optarg, ","); tok; tok = strtok(NULL, ",")) {
+                if (num_stats_windows == SAMPLER_MAX_STATS_WINDOWS) {
+                    fprintf(stderr, "At most %d stats windows\n", SAMPLER_MAX_STATS_WINDOWS);
+                    return OPTIONS_INVALID;
+                }
+                stats_windows[num_stats_windows++] = atoi(tok);
+            }
+            break;
+        }
+        case 'M':
+            if (!MedianFilter_parseSpec(optarg, &median_width, &median_threshold)) {
+                fprintf(stderr, "Invalid --median %s\n", optarg);
+                return OPTIONS_INVALID;
+            }
+            break;
+        case 'f': filter_spec = optarg; break;
+        case 'L': latency_steps = atoi(optarg); break;
+        case 'w': sweep_spec = optarg ? optarg : SWEEP_DEFAULT_SPEC; break;
+        case 'o': sweep_out = optarg; break;
+        case 't':
+            if (!ThreadConfig_parse(optarg)) {
+                fprintf(stderr, "Invalid --threads %s\n", optarg);
+                return OPTIONS_INVALID;
+            }
+            thread_spec = optarg;
+            break;
+        case 'T':
+            realtime_mode = true;
+            Realtime_enable();
+            break;
+        case 'P': threaded_mode = true; break;
+        case 'U': Uring_enable(); break;
+        case 'O':
+            if (strcmp(optarg, "text") && strcmp(optarg, "json")) {
+                fprintf(stderr, "Invalid --output %s (text or json)\n", optarg);
+                return OPTIONS_INVALID;
+            }
+            json_output = !strcmp(optarg, "json");
+            break;
+        case 'F': perf_status = true; break;
+        case 'I': pwm_interval_ms = atoi(optarg); break;
+        case 'Q': metrics_port = atoi(optarg); break;
+        case 'X': trace_path = optarg ? optarg : TRACE_DEFAULT_PATH; break;
+        case 's':
+            if (!Sim_enable(optarg)) return OPTIONS_INVALID;
+            break;
+        case 'h':
+            print_usage(stdout, argv[0]);
+            return OPTIONS_HELP;
+        default:   // getopt_long() has said what was wrong
+            print_usage(stderr, argv[0]);
+            return OPTIONS_INVALID;
+        }
+    }
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument %s\n", argv[optind]);
+        print_usage(stderr, argv[0]);
+        return OPTIONS_INVALID;
+    }
+    return OPTIONS_RUN;
+}
+
+// --latency: step the LED and report how long the sampler takes to see it
+static void run_latency_measurement(int steps) {
+    printf("Measuring optical loopback latency over %d steps...\n", steps);
+    LoopbackConfig cfg = { .steps = steps, .holdMs = LOOPBACK_DEFAULT_HOLD_MS };
+    LoopbackResult res;
+    if (!Loopback_measure(&cfg, &res)) {
+        fprintf(stderr, "Latency measurement failed\n");
+        return;
+    }
+    printf("Steps detected: %d/%d  (avg step %.3fV, PWM write %.1f us)\n",
+           res.detected, res.steps, res.stepVolts, res.writeMeanNs / 1000.0);
+    if (res.detected > 0) {
+        printf("Latency us: min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  mean %.1f\n",
+               res.minNs / 1000.0, res.p50Ns / 1000.0, res.p90Ns / 1000.0,
+               res.p99Ns / 1000.0, res.maxNs / 1000.0, res.meanNs / 1000.0);
+    }
+    Loopback_freeResult(&res);
+}
+
+// --sweep: step the LED frequency and write the detector's accuracy curve
+static void run_sweep(const char *spec, const char *out_path) {
+    static SweepResult res;   // large; keep it off the stack
+    SweepConfig cfg;
+    if (!Sweep_parseSpec(spec, &cfg)) {
+        fprintf(stderr, "Invalid --sweep range '%s'\n", spec);
+        return;
+    }
+    printf("Sweeping LED %.0f..%.0f Hz...\n", cfg.fromHz, cfg.toHz);
+    if (!Sweep_run(&cfg, &res)) {
+        fprintf(stderr, "Sweep failed\n");
+        return;
+    }
+
+    FILE *f = out_path ? fopen(out_path, "w") : stdout;
+    if (!f) {
+        perror("--sweep-out");
+        return;
+    }
+    size_t len = out_path ? strlen(out_path) : 0;
+    if (len > 5 && !strcmp(out_path + len - 5, ".json")) {
+        Sweep_writeJson(&res, f);
+    } else {
+        Sweep_writeCsv(&res, f);
+    }
+    if (f != stdout) fclose(f);
+    printf("Detector tracks the LED up to %d Hz\n", res.maxTrackedHz);
+}
+
+// LED rate for an encoder position: start at 10 Hz, one Hz per detent
+// (4 edges per detent), clamped to 1-500 Hz
+static int encoder_frequency(int edges) {
+    int new_freq = 10 + edges / 4;
+    if (new_freq < 1)   new_freq = 1;    // Minimum 1 Hz
+    if (new_freq > PWM_MAX_HZ) new_freq = PWM_MAX_HZ;
+    return new_freq;
+}
+
+// Post the knob's rate to the PWM owner when it moves, stamped with the
+// time of the encoder step behind it (the kernel's edge timestamp with edge
+// events, the poll time otherwise); UDP setfreq stays in effect until the
+// next move
+static int encoder_freq_posted = -1;
+
+static void apply_led_frequency(int new_freq, long long stepNs) {
+    if (new_freq != encoder_freq_posted) {
+        encoder_freq_posted = new_freq;
+        PwmControl_requestFrequency(new_freq, stepNs);
+    }
+}
+
+// Once a second: close the sampler's second and print the status
+static long long allocs_reported = 0;
+static long long drops_reported = 0;
+static long long overruns_reported[OVERRUN_KIND_COUNT];
+static long long last_second_ns = 0;
+
+// Text status: one extra line naming what went wrong during the last second
+static void display_overruns(void) {
+    bool any = false;
+    for (int k = 0; k < OVERRUN_KIND_COUNT; k++) {
+        long long count = Overrun_get(k).count;
+        if (count != overruns_reported[k]) {
+            StatusWriter_printf("%s %s %lld", any ? "," : "Overruns:", Overrun_name(k),
+                                count - overruns_reported[k]);
+            any = true;
+        }
+    }
+    if (any) StatusWriter_printf("  (total %lld)\n", Overrun_total());
+}
+
+// Per-second values for the metrics endpoint
+static Metric *m_samples_last_second, *m_dips_last_second, *m_led_hz, *m_measured_hz,
+              *m_avg_volts, *m_period_min, *m_period_max, *m_period_avg, *m_status_dropped;
+
+static void register_app_metrics(void) {
+    m_samples_last_second = Metrics_gauge("light_samples_last_second",
+                                          "Samples stored in the previous second.");
+    m_dips_last_second = Metrics_gauge("light_dips_last_second",
+                                       "Dips detected in the previous second.");
+    m_led_hz = Metrics_gauge("led_frequency_hz", "Commanded LED flash frequency.");
+    m_measured_hz = Metrics_gauge("led_measured_frequency_hz",
+                                  "LED flash frequency measured from the light.");
+    m_avg_volts = Metrics_gauge("light_average_volts", "Averaged light level.");
+    m_period_min = Metrics_gauge("light_sample_period_ms{stat=\"min\"}",
+                                 "Sample period over the previous second.");
+    m_period_max = Metrics_gauge("light_sample_period_ms{stat=\"max\"}",
+                                 "Sample period over the previous second.");
+    m_period_avg = Metrics_gauge("light_sample_period_ms{stat=\"avg\"}",
+                                 "Sample period over the previous second.");
+    m_status_dropped = Metrics_gauge("status_lines_dropped",
+                                     "Status lines dropped because the console was slow.");
+}
+
+static void update_app_metrics(int samples, int dips, const Period_statistics_t *stats) {
+    FreqEstimate freq;
+    Sampler_getFrequencyEstimate(&freq);
+    Metrics_set(m_samples_last_second, samples);
+    Metrics_set(m_dips_last_second, dips);
+    Metrics_set(m_led_hz, PwmControl_getFrequency());
+    Metrics_set(m_measured_hz, freq.tracked.hz);
+    Metrics_set(m_avg_volts, Sampler_getAverageReading());
+    Metrics_set(m_period_min, stats->minPeriodInMs);
+    Metrics_set(m_period_max, stats->maxPeriodInMs);
+    Metrics_set(m_period_avg, stats->avgPeriodInMs);
+    Metrics_set(m_status_dropped, (double)StatusWriter_dropped());
+}
+static void process_second(void) {
+    Trace_begin("second");
+    long long now_ns = getTimeInNs();
+    if (last_second_ns > 0 &&
+        now_ns - last_second_ns > (MS_IN_SECOND + OVERRUN_LATE_SECOND_MS) * 1000000LL) {
+        Overrun_recordAt(OVERRUN_LATE_SECOND, now_ns);
+    }
+    last_second_ns = now_ns;
+    Sampler_moveCurrentDataToHistory();
+
+    Period_statistics_t _lastSecondsSample = Sampler_getLastSecondStatistics();
+
+    int dips_in_last_second = Sampler_getDipCount();
+    int history_size = Sampler_copyHistory(display_samples, display_capacity);
+    update_app_metrics(history_size, dips_in_last_second, &_lastSecondsSample);
+    if (perf_status) sample_perf();
+    if (history_size > 0 && console_output_enabled) {
+        double avg = Sampler_getAverageReading();
+        FreqEstimate freq;
+        Sampler_getFrequencyEstimate(&freq);
+        // Print terminal status exactly as specified
+        (json_output ? display_status_json : display_status)(
+            history_size,           // samples in previous second
+            PwmControl_getFrequency(), // LED Hz
+            freq.tracked.hz,         // LED Hz as measured from the light
+            avg,                     // averaged light level (V)
+            dips_in_last_second,     // dips found in previous second
+            &_lastSecondsSample,     // timing jitter stats for light samples
+            display_samples,         // history samples from previous second
+            history_size);
+        if (!json_output) display_overruns();
+        if (!json_output && perf_status) display_perf(false);
+        // Text mode says when lines were lost; JSON lines carry the count
+        long long dropped = StatusWriter_dropped();
+        if (!json_output && dropped != drops_reported) {
+            StatusWriter_printf("(%lld status lines dropped)\n", dropped - drops_reported);
+            drops_reported = dropped;
+        }
+        StatusWriter_commit();
+    }
+    for (int k = 0; k < OVERRUN_KIND_COUNT; k++) overruns_reported[k] = Overrun_get(k).count;
+
+    long long allocs = Realtime_steadyStateAllocations();
+    if (realtime_mode && allocs != allocs_reported) {
+        if (json_output) {
+            StatusWriter_printf("{\"realtime_heap_allocations\":%lld}\n", allocs);
+        } else {
+            StatusWriter_printf("realtime: %lld heap allocations since start-up\n", allocs);
+        }
+        StatusWriter_commit();
+        allocs_reported = allocs;
+    }
+    Trace_end("second");
+
+    if (trace_dump_requested) {
+        trace_dump_requested = 0;
+        long n = Trace_dump(NULL);
+        if (n < 0) StatusWriter_printf("trace: could not write %s\n", Trace_defaultPath());
+        else StatusWriter_printf("trace: %ld events written to %s\n", n, Trace_defaultPath());
+        StatusWriter_commit();
+    }
+}
+
+// Reactor handlers (all on the main thread)
+static void on_rotary(int count, long long stepNs, void *arg) {
+    (void)arg;
+    apply_led_frequency(encoder_frequency(count), stepNs);
+}
+
+static void on_second(uint64_t expirations, void *arg) {
+    (void)expirations; (void)arg;
+    process_second();
+}
+
+// Old layout: every module on its own thread and main polling the encoder
+static void run_threaded_loop(void) {
+    long long lastTime = getTimeInMs();
+    while (running) {
+        apply_led_frequency(encoder_frequency(rotary_getCount()), rotary_getLastStepNs());
+
+        if (getTimeInMs() - lastTime >= MS_IN_SECOND) {
+            process_second();
+            lastTime = getTimeInMs();
+        }
+    }
+}
+
+// Process-wide context switches and CPU time, to compare the two layouts
+static void report_load(const struct rusage *start, long long start_ms) {
+    struct rusage end;
+    getrusage(RUSAGE_SELF, &end);
+    double secs = (getTimeInMs() - start_ms) / 1000.0;
+    if (secs <= 0) return;
+
+    long vol = end.ru_nvcsw - start->ru_nvcsw;
+    long invol = end.ru_nivcsw - start->ru_nivcsw;
+    double cpu_s = (end.ru_utime.tv_sec - start->ru_utime.tv_sec) +
+                   (end.ru_stime.tv_sec - start->ru_stime.tv_sec) +
+                   ((end.ru_utime.tv_usec - start->ru_utime.tv_usec) +
+                    (end.ru_stime.tv_usec - start->ru_stime.tv_usec)) / 1e6;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    double busy_pct = 100.0 * cpu_s / secs;
+    printf("Load over %.1fs (%s): %.0f context switches/s (%.0f voluntary), "
+           "CPU %.1f%% of one core, %.1f%% of %ld CPUs idle\n",
+           secs, threaded_mode ? "threaded" : "reactor",
+           (vol + invol) / secs, vol / secs, busy_pct,
+           100.0 - busy_pct / cpus, cpus);
+}
+
+// Start-up steps (see hal/startup.h); the first three run in parallel
+static bool init_pwm(void *arg) {
+    (void)arg;
+    if (!PWM_export()) {
+        fprintf(stderr, "Failed to export PWM\n");
+        return false;
+    }
+    return true;
+}
+
+static bool init_rotary(void *arg) {
+    (void)arg;
+    if (!rotary_init()) {
+        fprintf(stderr, "Failed to initialize rotary encoder\n");
+        return false;
+    }
+    return true;
+}
+
+static bool init_sampler(void *arg) {
+    (void)arg;
+    if (!Sampler_setSampleRate(sample_rate)) {
+        fprintf(stderr, "Invalid sample rate %d Hz\n", sample_rate);
+        return false;
+    }
+    if (num_stats_windows >= 0 &&
+        !Sampler_setStatsWindows(stats_windows, num_stats_windows)) {
+        fprintf(stderr, "Invalid stats windows\n");
+        return false;
+    }
+    Sampler_setPrefilter(median_width, median_threshold);
+    char filter_err[80];
+    if (filter_spec && !Sampler_setFilter(filter_spec, filter_err, sizeof(filter_err))) {
+        fprintf(stderr, "Invalid --filter: %s\n", filter_err);
+        return false;
+    }
+    Sampler_init();
+    return true;
 }
 
-int main() {
+static bool start_recorder(void *arg) {
+    (void)arg;
+    if (!Recorder_start(record_path, record_mb)) {
+        fprintf(stderr, "Flight recorder not started\n");
+        return false;
+    }
+    return true;
+}
+
+// The servers register with the event loop, so they start on main's thread
+static bool start_network(void *arg) {
+    const UdpCallbacks *cb = arg;
+    bool ok = true;
+    if (udp_start(12345, *cb) != 0) {
+        fprintf(stderr, "udp_start failed\n");
+        ok = false;
+    }
+    // Encoded history replies come from a fixed pool instead of the heap
+    if (realtime_mode &&
+        !HistoryCache_preallocate(Sampler_getMaxHistorySize(), 4, Sampler_copyHistory)) {
+        fprintf(stderr, "Failed to preallocate history replies\n");
+        ok = false;
+    }
+    if (tcp_bulk_start(TCP_BULK_DEFAULT_PORT, *cb) != 0) {
+        fprintf(stderr, "tcp_bulk_start failed\n");
+        ok = false;
+    }
+    register_app_metrics();
+    if (metrics_port > 0 && Metrics_startServer((uint16_t)metrics_port) != 0) {
+        fprintf(stderr, "Metrics endpoint failed to start\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    OptionsResult options = parse_options(argc, argv);
+    if (options != OPTIONS_RUN) {
+        return options == OPTIONS_HELP ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Set up signal handler for CTRL+C
     if (signal(SIGINT, cleanup_handler) == SIG_ERR) {
         fprintf(stderr, "Failed to set up signal handler\n");
         return -1;
     }
+    if (trace_path) {
+        if (!Trace_enable(TRACE_DEFAULT_EVENTS, trace_path) ||
+            signal(SIGUSR1, cleanup_handler) == SIG_ERR) {
+            fprintf(stderr, "Failed to enable tracing\n");
+            return -1;
+        }
+        printf("Tracing: send SIGUSR1 (kill -USR1 %d) or UDP \"trace\" to write %s\n",
+               (int)getpid(), trace_path);
+    }
     
     printf("Starting light_sampler application...\n");
 
-    // Initialize modules
+    // Calibrate the fast timestamp clock before any thread needs it
+    Timing_init();
+    printf("Timestamp clock: %s\n", Timing_clockSourceName());
+
+    // Lock memory before any thread starts so their stacks are locked too
+    bool memory_locked = realtime_mode && Realtime_lockMemory(REALTIME_HEAP_PREFAULT);
+
+    // Everything but acquisition runs on this thread's event loop
+    if (!threaded_mode && !Reactor_init()) {
+        fprintf(stderr, "Event loop unavailable, using one thread per module\n");
+        threaded_mode = true;
+    }
+
+    // PWM, encoder and sampler don't depend on each other: bring them up side
+    // by side, then the network servers, which attach to the event loop
     Period_init();  // Initialize period timer first
-    if (!PWM_export()) {
-        fprintf(stderr, "Failed to export PWM\n");
+    const StartupStep hardware[] = {
+        { "pwm",     init_pwm,     NULL },
+        { "rotary",  init_rotary,  NULL },
+        { "sampler", init_sampler, NULL },
+    };
+    if (!Startup_runParallel(hardware, (int)(sizeof(hardware) / sizeof(hardware[0])))) {
+        Startup_report(stderr);
         return -1;
     }
-    
-    if (!rotary_init()) {
-        fprintf(stderr, "Failed to initialize rotary encoder\n");
+    display_capacity = Sampler_getMaxHistorySize();
+    display_samples = malloc(sizeof(double) * display_capacity);
+    if (!display_samples) {
+        perror("display buffer");
         return -1;
     }
-
-    Sampler_init();
+    if (record_path) Startup_run("recorder", start_recorder, NULL);
+    if (!threaded_mode) rotary_setListener(on_rotary, NULL);
     rotary_start();
     PWM_enable();
 
@@ -164,68 +767,75 @@ int main() {
         .get_history = Sampler_getHistory,
         .set_frequency = cb_set_frequency,
         .set_duty = cb_set_duty,
-        .set_console_output = cb_set_console_output  // Allow remote control of console output
+        .set_console_output = cb_set_console_output,  // Allow remote control of console output
+        .get_history_seq = Sampler_getHistorySeq,    // Cache encoded history per second
+        .get_frequency = Sampler_getFrequencyEstimate, // Measured LED frequency
+        .get_window_stats = Sampler_getWindowStats,  // Sliding-window statistics
+        .get_stats_windows = Sampler_getStatsWindows,
+        .set_filter = Sampler_setFilter,             // History filter/decimation
+        .describe_filter = Sampler_describeFilter
     };
+    Startup_run("network", start_network, &cb);
+    Startup_report(stdout);
 
-    if (udp_start(12345, cb) != 0) {
-        fprintf(stderr, "udp_start failed\n");
+    // Apply main's own settings only now, so the threads above don't inherit
+    // them; then show what every thread actually got.
+    ThreadConfig_applySelf(THREAD_MAIN);
+    if (thread_spec) {
+        sleepForMs(20);   // let the threads start and apply their settings
+        ThreadConfig_report(stdout);
     }
-    // Set initial PWM frequency
-    PWM_setFrequency(current_freq, 50);  // 50% duty cycle
-    long long lastTime = getTimeInMs();
-    //long long startTimeS = getTimeInMs();
+    if (latency_steps > 0) {
+        run_latency_measurement(latency_steps);
+        cleanup_resources();
+        return 0;
+    }
+    if (sweep_spec) {
+        run_sweep(sweep_spec, sweep_out);
+        cleanup_resources();
+        return 0;
+    }
+
+    // From here on only the PWM owner writes the PWM: knob and UDP post to it
+    encoder_freq_posted = encoder_frequency(rotary_getCount());
+    if (!PwmControl_start(encoder_freq_posted, 50, pwm_interval_ms)) {  // 50% duty cycle
+        fprintf(stderr, "PWM control not started; the LED stays at %d Hz\n", encoder_freq_posted);
+    }
+    // Status lines go through a low-priority writer so a slow console can't stall this loop
+    StatusWriter_start(STDOUT_FILENO);
+    if (realtime_mode) {
+        StatusWriter_printf("Realtime mode: memory %s, allocation check %s\n",
+                            memory_locked ? "locked" : "NOT locked",
+                            Realtime_allocCheckAvailable() ? "on" : "unavailable");
+        StatusWriter_commit();
+        Realtime_beginSteadyState();
+    }
+
+    struct rusage load_start;
+    getrusage(RUSAGE_SELF, &load_start);
+    long long load_start_ms = getTimeInMs();
+
     // Main processing loop
-    while (running) {
-        // Update LED blink rate based on rotary encoder
-        int edges = rotary_getCount();
-        
-        // Convert edges to detents (4 edges per detent)
-        int detents = edges / 4;
-        
-        // Start at 10 Hz, add detents, and clamp to 1-500 Hz range
-        int new_freq = 10 + detents;
-        if (new_freq < 1)   new_freq = 1;    // Minimum 1 Hz
-        if (new_freq > 500) new_freq = 500;  // Maximum 500 Hz
-        
-        if (new_freq != current_freq) {
-            current_freq = new_freq;
-            PWM_setFrequency(current_freq, 50);  // 50% duty cycle
-        }
-        
-       long long timeDiff = (getTimeInMs() - lastTime)/MS_IN_SECOND;
-       if (timeDiff >= 1) {
-            // Process light samples every second
-            Sampler_moveCurrentDataToHistory();
-            
-            Period_statistics_t _lastSecondsSample = Sampler_getLastSecondStatistics();
-            
-            int dips_in_last_second = Sampler_getDipCount();
-            int history_size;
-            double* samples = Sampler_getHistory(&history_size);
-            if (samples) {
-            
-            
-            double avg = Sampler_getAverageReading();
-            lastTime = getTimeInMs();
-            // long long TotalTimeS = (getTimeInMs()-startTimeS)/MS_IN_SECOND; // no longer printed
-            // Print terminal status exactly as specified
-            display_status(
-                history_size,           // samples in previous second
-                current_freq,            // LED Hz
-                avg,                     // averaged light level (V)
-                dips_in_last_second,     // dips found in previous second
-                &_lastSecondsSample,     // timing jitter stats for light samples
-                samples,                 // history samples from previous second
-                history_size);
-              
-            free(samples);
-            }
-        }
-        // Wait for next second
-        //sleepForMs(1000);
+    if (threaded_mode) {
+        run_threaded_loop();
+    } else if (Reactor_addTimer(1000000000LL, on_second, NULL) >= 0) {
+        if (running) Reactor_run();
     }
 
+    // Allocations during shutdown don't count
+    long long steady_allocs = Realtime_steadyStateAllocations();
+    StatusWriter_stop();
+    report_load(&load_start, load_start_ms);
+
     // Perform cleanup
     cleanup_resources();
+    free(display_samples);
+    Reactor_cleanup();
+    Trace_cleanup();
+    if (realtime_mode && steady_allocs > 0) {
+        fprintf(stderr, "FAIL: %lld heap allocations after start-up in realtime mode\n",
+                steady_allocs);
+        return 1;
+    }
     return 0;
 }
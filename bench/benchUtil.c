@@ -0,0 +1,85 @@
+// benchUtil.c
+// Shared helpers for the bench_* programs (see benchUtil.h).
+
+#include "benchUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+
+static FILE *s_out = NULL;
+static int   s_numResults = 0;
+
+long long Bench_nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void Bench_begin(const char *suite, int *argc, char *argv[])
+{
+    s_out = stdout;
+    for (int i = 1; i < *argc - 1; i++) {
+        if (strcmp(argv[i], "-o") != 0) continue;
+        s_out = fopen(argv[i + 1], "w");
+        if (!s_out) {
+            perror(argv[i + 1]);
+            exit(1);
+        }
+        for (int j = i; j + 2 <= *argc; j++) argv[j] = argv[j + 2];
+        *argc -= 2;
+        break;
+    }
+
+    struct utsname u;
+    if (uname(&u) != 0) {
+        strcpy(u.nodename, "unknown");
+        strcpy(u.machine, "unknown");
+    }
+    fprintf(s_out, "{\n  \"suite\": \"%s\",\n  \"host\": \"%s\",\n  \"arch\": \"%s\",\n"
+                   "  \"unix_time\": %lld,\n  \"results\": [",
+            suite, u.nodename, u.machine, (long long)time(NULL));
+    s_numResults = 0;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+void Bench_report(const char *name, long long iterations, double totalNs,
+                  long long *latNs, int nLat)
+{
+    double perOp = iterations > 0 ? totalNs / iterations : 0;
+    fprintf(s_out, "%s\n    { \"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.1f",
+            s_numResults++ ? "," : "", name, iterations, perOp);
+    fprintf(stderr, "%-36s %10.1f ns/op", name, perOp);
+    if (latNs && nLat > 0) {
+        qsort(latNs, nLat, sizeof(long long), cmp_ll);
+        long long p50 = latNs[nLat / 2];
+        long long p99 = latNs[(int)(nLat * 0.99)];
+        long long max = latNs[nLat - 1];
+        fprintf(s_out, ", \"p50_ns\": %lld, \"p99_ns\": %lld, \"max_ns\": %lld", p50, p99, max);
+        fprintf(stderr, "  p50 %lld  p99 %lld  max %lld", p50, p99, max);
+    }
+    fprintf(s_out, " }");
+    fprintf(stderr, "\n");
+}
+
+void Bench_reportValue(const char *name, double value, const char *unit)
+{
+    fprintf(s_out, "%s\n    { \"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\" }",
+            s_numResults++ ? "," : "", name, value, unit);
+    fprintf(stderr, "%-36s %10.3f %s\n", name, value, unit);
+}
+
+int Bench_end(void)
+{
+    fprintf(s_out, "\n  ]\n}\n");
+    if (s_out != stdout) fclose(s_out);
+    return 0;
+}
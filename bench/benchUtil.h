@@ -0,0 +1,35 @@
+// benchUtil.h
+// Shared helpers for the bench_* programs: timing and JSON result output.
+//
+// Every benchmark program writes one JSON document:
+//   { "suite": "...", "host": "...", "arch": "...", "unix_time": N,
+//     "results": [ { "name": "...", "iterations": N, "ns_per_op": X,
+//                    "p50_ns": X, "p99_ns": X, "max_ns": X }, ...
+//                  { "name": "...", "value": X, "unit": "..." }, ... ] }
+// to stdout, or to FILE when run with "-o FILE", so results from different
+// commits can be compared by a script. A short human-readable line per
+// result goes to stderr.
+
+#ifndef _BENCH_UTIL_H_
+#define _BENCH_UTIL_H_
+
+#include <stdbool.h>
+
+// Start a suite. Consumes "-o FILE" from argv (argc is updated).
+void Bench_begin(const char *suite, int *argc, char *argv[]);
+
+// Report a timed operation. `totalNs` covers all `iterations`. If `latNs`
+// is given (one entry per timed op, `nLat` entries) percentiles are added.
+void Bench_report(const char *name, long long iterations, double totalNs,
+                  long long *latNs, int nLat);
+
+// Report a single derived value (throughput, loss, ...).
+void Bench_reportValue(const char *name, double value, const char *unit);
+
+// Finish the JSON document. Returns the process exit code to use.
+int Bench_end(void);
+
+// Monotonic time in ns for timing loops.
+long long Bench_nowNs(void);
+
+#endif
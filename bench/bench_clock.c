@@ -0,0 +1,80 @@
+// bench_clock.c
+// Cost per timestamp of each clock source available to the HAL, and how far
+// the calibrated cycle-counter clock drifts from CLOCK_MONOTONIC.
+//
+// Usage: bench_clock [-o results.json]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+
+#include "benchUtil.h"
+#include "hal/timing.h"
+
+#define N 2000000
+
+static volatile long long s_sink;   // keeps reads from being optimized out
+
+static void bench_posix(clockid_t id, const char *name)
+{
+    struct timespec ts;
+    long long t0 = Bench_nowNs();
+    for (int i = 0; i < N; i++) {
+        clock_gettime(id, &ts);
+        s_sink += ts.tv_nsec;
+    }
+    Bench_report(name, N, (double)(Bench_nowNs() - t0), NULL, 0);
+}
+
+static void bench_cycles(void)
+{
+    long long t0 = Bench_nowNs();
+    for (int i = 0; i < N; i++) s_sink += (long long)Timing_readCycles();
+    Bench_report("cycle_counter_raw", N, (double)(Bench_nowNs() - t0), NULL, 0);
+}
+
+static void bench_getTimeInNs(const char *name)
+{
+    long long t0 = Bench_nowNs();
+    for (int i = 0; i < N; i++) s_sink += getTimeInNs();
+    Bench_report(name, N, (double)(Bench_nowNs() - t0), NULL, 0);
+}
+
+// Largest |getTimeInNs() - CLOCK_MONOTONIC| seen over about a second
+static void report_drift(void)
+{
+    long long worst = 0;
+    for (int i = 0; i < 100; i++) {
+        struct timespec ts, wait = {0, 10 * 1000 * 1000};
+        long long fast = getTimeInNs();
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        long long mono = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        long long d = fast > mono ? fast - mono : mono - fast;
+        if (d > worst) worst = d;
+        nanosleep(&wait, NULL);
+    }
+    Bench_reportValue("cycle_clock_max_offset_vs_monotonic", (double)worst, "ns");
+}
+
+int main(int argc, char *argv[])
+{
+    Bench_begin("clock", &argc, argv);
+
+    bench_posix(CLOCK_MONOTONIC, "clock_gettime_monotonic");
+    bench_posix(CLOCK_MONOTONIC_COARSE, "clock_gettime_monotonic_coarse");
+    bench_posix(CLOCK_REALTIME, "clock_gettime_realtime");
+    bench_posix(CLOCK_BOOTTIME, "clock_gettime_boottime");
+
+    Timing_init();
+    if (Timing_getClockSource() == TIMING_CLOCK_CYCLES) {
+        bench_cycles();
+        bench_getTimeInNs("getTimeInNs_cycle_counter");
+        report_drift();
+    } else {
+        fprintf(stderr, "No usable cycle counter; getTimeInNs uses CLOCK_MONOTONIC\n");
+    }
+
+    Timing_useMonotonic();
+    bench_getTimeInNs("getTimeInNs_monotonic_fallback");
+    return Bench_end();
+}
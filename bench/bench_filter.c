@@ -0,0 +1,90 @@
+// bench_filter.c
+// Per-sample cost of the sampler's signal filters, measured on a synthetic
+// noisy LED signal so branch behaviour resembles the real stream.
+//
+// Usage: bench_filter [-o results.json]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchUtil.h"
+#include "hal/dipDetector.h"
+#include "hal/filterChain.h"
+#include "hal/medianFilter.h"
+#include "hal/replay.h"
+
+#define N 2000000
+
+static volatile double s_sink;   // keeps results from being optimized out
+
+static void bench_detector(const ReplayData *d)
+{
+    DipDetector det;
+    DipDetector_init(&det);
+    long long t0 = Bench_nowNs();
+    long long dips = 0;
+    for (size_t i = 0; i < d->count; i++) dips += DipDetector_feed(&det, d->volts[i]);
+    Bench_report("dip_detector", (long long)d->count, (double)(Bench_nowNs() - t0), NULL, 0);
+    s_sink += dips;
+}
+
+static void bench_median(const ReplayData *d, int width, double threshold)
+{
+    MedianFilter mf;
+    if (!MedianFilter_init(&mf, width, threshold)) return;
+    long long t0 = Bench_nowNs();
+    double acc = 0;
+    for (size_t i = 0; i < d->count; i++) acc += MedianFilter_feed(&mf, d->volts[i]);
+    char name[64];
+    snprintf(name, sizeof(name), "median_w%d%s", width, threshold > 0 ? "_hampel" : "");
+    Bench_report(name, (long long)d->count, (double)(Bench_nowNs() - t0), NULL, 0);
+    s_sink += acc;
+}
+
+// Cost per *input* sample of a filter-and-decimate chain
+static void bench_chain(const ReplayData *d, const char *spec)
+{
+    char err[80];
+    FilterChain *fc = FilterChain_create(spec, 1000, err, sizeof(err));
+    if (!fc) {
+        fprintf(stderr, "%s: %s\n", spec, err);
+        return;
+    }
+    long long t0 = Bench_nowNs();
+    double acc = 0, out;
+    for (size_t i = 0; i < d->count; i++) {
+        if (FilterChain_push(fc, d->volts[i], &out)) acc += out;
+    }
+    char name[96];
+    snprintf(name, sizeof(name), "chain_%s", spec);
+    Bench_report(name, (long long)d->count, (double)(Bench_nowNs() - t0), NULL, 0);
+    FilterChain_destroy(fc);
+    s_sink += acc;
+}
+
+int main(int argc, char *argv[])
+{
+    Bench_begin("filter", &argc, argv);
+
+    ReplayData d;
+    if (!Replay_synthesize(20, N / 1000.0, 1000, 0.02, &d)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    Replay_addGlitches(&d, 0.001);
+
+    bench_detector(&d);
+    static const int widths[] = { 3, 5, 9, 31, 127 };
+    for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+        bench_median(&d, widths[i], 0);
+    }
+    bench_median(&d, 5, 0.2);
+
+    bench_chain(&d, "decim=1,taps=33");
+    bench_chain(&d, "decim=4");
+    bench_chain(&d, "decim=8,taps=127");
+    bench_chain(&d, "decim=4,notch=60,lp=80");
+
+    Replay_freeData(&d);
+    return Bench_end();
+}
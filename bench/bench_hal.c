@@ -0,0 +1,337 @@
+// bench_hal.c
+// Microbenchmarks for the HAL hot paths, runnable on the host:
+//   - Read_ADC_Values() against a stand-in spidev (a temp file whose SPI
+//     ioctls are answered in user space, so open/close are real syscalls)
+//   - Period_markEvent() with 1 and 4 threads contending for its lock
+//   - the sampler's per-sample path (Sampler_recordSample)
+//   - Sampler_moveCurrentDataToHistory() and Sampler_getHistory()
+//   - PWM_setFrequency() writing into a temporary sysfs-like tree
+//   - UDP command round trips over loopback
+//   - Trace_begin()/Trace_end() with tracing off and on, and a trace dump
+//
+// Usage: bench_hal [-o results.json]
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/spi/spidev.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "benchUtil.h"
+#include "hal/PWM.h"
+#include "hal/SPI.h"
+#include "hal/UDP.h"
+#include "hal/periodTimer.h"
+#include "hal/sampler.h"
+#include "hal/trace.h"
+
+#define UDP_PORT 22347
+
+// ---------------------------------------------------------------------------
+// Stand-in SPI device. The bench links with -Wl,--wrap=open,--wrap=ioctl so
+// the HAL's calls land here; only the stand-in file is intercepted.
+// ---------------------------------------------------------------------------
+int __real_open(const char *path, int flags, ...);
+int __real_ioctl(int fd, unsigned long req, ...);
+
+static char s_spiPath[] = "/tmp/bench_spidevXXXXXX";
+static int  s_spiFd = -1;
+static unsigned s_adcCount = 0;
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = (flags & O_CREAT) ? (mode_t)va_arg(ap, int) : 0;
+    va_end(ap);
+    int fd = __real_open(path, flags, mode);
+    if (fd >= 0 && strcmp(path, s_spiPath) == 0) s_spiFd = fd;
+    return fd;
+}
+
+int __wrap_ioctl(int fd, unsigned long req, ...)
+{
+    va_list ap;
+    va_start(ap, req);
+    void *arg = va_arg(ap, void*);
+    va_end(ap);
+    if (fd != s_spiFd) return __real_ioctl(fd, req, arg);
+
+    if (req == SPI_IOC_MESSAGE(1)) {
+        // MCP3202 answer: 12-bit value in rx[1..2]; a 20 Hz square wave so
+        // the dip detector has work to do
+        struct spi_ioc_transfer *tr = arg;
+        uint8_t *rx = (uint8_t*)(uintptr_t)tr->rx_buf;
+        int v = ((s_adcCount++ / 25) & 1) ? 2500 : 1500;
+        rx[0] = 0;
+        rx[1] = (uint8_t)((v >> 8) & 0x0F);
+        rx[2] = (uint8_t)(v & 0xFF);
+        return (int)tr->len;
+    }
+    return 0;   // mode / bits / speed setup
+}
+
+static void bench_spi(void)
+{
+    enum { N = 20000 };
+    static long long lat[N];
+    long long total = 0;
+    for (int i = 0; i < N; i++) {
+        long long t0 = Bench_nowNs();
+        Read_ADC_Values(0);
+        lat[i] = Bench_nowNs() - t0;
+        total += lat[i];
+    }
+    Bench_report("spi_read_adc_standin", N, (double)total, lat, N);
+}
+
+// ---------------------------------------------------------------------------
+// Period_markEvent under contention. Its buffer holds MAX_EVENT_TIMESTAMPS
+// per event, so threads mark in rounds and the buffer is cleared in between.
+// ---------------------------------------------------------------------------
+#define MARK_ROUNDS 200
+
+static pthread_barrier_t s_barrier;
+static int s_markThreads;
+static long long s_markNs[8];
+
+static void* mark_thread(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    int perRound = (MAX_EVENT_TIMESTAMPS / 2) / s_markThreads;
+    long long spent = 0;
+    for (int r = 0; r < MARK_ROUNDS; r++) {
+        pthread_barrier_wait(&s_barrier);
+        long long t0 = Bench_nowNs();
+        for (int i = 0; i < perRound; i++) Period_markEvent(PERIOD_EVENT_MARK_SECOND);
+        spent += Bench_nowNs() - t0;
+        pthread_barrier_wait(&s_barrier);   // main clears the buffer here
+    }
+    s_markNs[id] = spent;
+    return NULL;
+}
+
+static void bench_period(int threads)
+{
+    pthread_t tid[8];
+    s_markThreads = threads;
+    pthread_barrier_init(&s_barrier, NULL, threads + 1);
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&tid[t], NULL, mark_thread, (void*)(intptr_t)t);
+    }
+    for (int r = 0; r < MARK_ROUNDS; r++) {
+        pthread_barrier_wait(&s_barrier);
+        pthread_barrier_wait(&s_barrier);
+        Period_statistics_t st;
+        Period_getStatisticsAndClear(PERIOD_EVENT_MARK_SECOND, &st);
+    }
+    long long total = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tid[t], NULL);
+        total += s_markNs[t];
+    }
+    pthread_barrier_destroy(&s_barrier);
+
+    char name[64];
+    snprintf(name, sizeof(name), "period_mark_event_%dthreads", threads);
+    long long marks = (long long)MARK_ROUNDS * ((MAX_EVENT_TIMESTAMPS / 2) / threads) * threads;
+    Bench_report(name, marks, (double)total, NULL, 0);
+}
+
+// ---------------------------------------------------------------------------
+// Sampler: per-sample path and the once-a-second history hand-off.
+// The real sampler thread keeps running against the stand-in ADC at 1 kHz.
+// ---------------------------------------------------------------------------
+static void rotate_second(void)
+{
+    Sampler_moveCurrentDataToHistory();
+    Sampler_getLastSecondStatistics();
+    Sampler_getDipCount();
+}
+
+static void bench_sampler(void)
+{
+    enum { SECONDS = 200, PER_SECOND = 1000 };
+    static long long moveLat[SECONDS], getLat[SECONDS];
+    long long recordNs = 0, moveNs = 0, getNs = 0;
+
+    rotate_second();
+    for (int s = 0; s < SECONDS; s++) {
+        long long t0 = Bench_nowNs();
+        for (int i = 0; i < PER_SECOND; i++) {
+            Sampler_recordSample((i / 25) & 1 ? 2.0 : 1.2);
+        }
+        recordNs += Bench_nowNs() - t0;
+
+        t0 = Bench_nowNs();
+        Sampler_moveCurrentDataToHistory();
+        moveLat[s] = Bench_nowNs() - t0;
+        moveNs += moveLat[s];
+
+        int n;
+        t0 = Bench_nowNs();
+        double *h = Sampler_getHistory(&n);
+        free(h);
+        getLat[s] = Bench_nowNs() - t0;
+        getNs += getLat[s];
+
+        Sampler_getLastSecondStatistics();
+        Sampler_getDipCount();
+    }
+    Bench_report("sampler_record_sample", (long long)SECONDS * PER_SECOND, (double)recordNs, NULL, 0);
+    Bench_report("sampler_move_to_history", SECONDS, (double)moveNs, moveLat, SECONDS);
+    Bench_report("sampler_get_history", SECONDS, (double)getNs, getLat, SECONDS);
+}
+
+// ---------------------------------------------------------------------------
+// PWM writes into a temp directory shaped like /dev/hat/pwm/GPIO15
+// ---------------------------------------------------------------------------
+static void bench_pwm(void)
+{
+    enum { N = 2000 };
+    static long long lat[N];
+    char dir[] = "/tmp/bench_pwmXXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return; }
+    const char *files[] = { "duty_cycle", "period", "enable" };
+    char path[128];
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        FILE *f = fopen(path, "w");
+        if (f) fclose(f);
+    }
+    PWM_setDirectory(dir);
+
+    long long total = 0;
+    for (int i = 0; i < N; i++) {
+        long long t0 = Bench_nowNs();
+        PWM_setFrequency(1 + i % 500, 50);
+        lat[i] = Bench_nowNs() - t0;
+        total += lat[i];
+    }
+    Bench_report("pwm_set_frequency_tmpfs", N, (double)total, lat, N);
+
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+    PWM_setDirectory(NULL);
+}
+
+// ---------------------------------------------------------------------------
+// UDP command round trips over loopback against the real command server
+// ---------------------------------------------------------------------------
+static void bench_udp_cmd(int fd, const char *cmd, int expectBytes, const char *name)
+{
+    enum { N = 2000 };
+    static long long lat[N];
+    static char buf[65536];
+    long long total = 0;
+    for (int i = 0; i < N; i++) {
+        long long t0 = Bench_nowNs();
+        send(fd, cmd, strlen(cmd), 0);
+        int got = 0;
+        do {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) break;       // timeout: count what we have
+            got += (int)n;
+        } while (got < expectBytes);
+        lat[i] = Bench_nowNs() - t0;
+        total += lat[i];
+    }
+    Bench_report(name, N, (double)total, lat, N);
+}
+
+static void bench_udp(void)
+{
+    UdpCallbacks cb = {
+        .get_count = Sampler_getNumSamplesTaken,
+        .get_history_size = Sampler_getHistorySize,
+        .get_history = Sampler_getHistory,
+        .get_history_seq = Sampler_getHistorySeq,
+    };
+    if (udp_start(UDP_PORT, cb) != 0) return;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a = {0};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(UDP_PORT);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    connect(fd, (struct sockaddr*)&a, sizeof(a));
+
+    bench_udp_cmd(fd, "count", 1, "udp_roundtrip_count");
+    int n = Sampler_getHistorySize();
+    bench_udp_cmd(fd, "history_bin", 8 + 2 * n, "udp_roundtrip_history_bin");
+
+    close(fd);
+    udp_stop();
+}
+
+// ---------------------------------------------------------------------------
+// Trace points: cost of a begin/end pair off and on, and of a full dump
+// ---------------------------------------------------------------------------
+static void bench_trace(void)
+{
+    enum { N = 1000000 };
+    long long t0 = Bench_nowNs();
+    for (int i = 0; i < N; i++) {
+        Trace_begin("bench");
+        Trace_end("bench");
+    }
+    Bench_report("trace_pair_disabled", N, (double)(Bench_nowNs() - t0), NULL, 0);
+
+    if (!Trace_enable(TRACE_DEFAULT_EVENTS, NULL)) return;
+    t0 = Bench_nowNs();
+    for (int i = 0; i < N; i++) {
+        Trace_begin("bench");
+        Trace_end("bench");
+    }
+    Bench_report("trace_pair_enabled", N, (double)(Bench_nowNs() - t0), NULL, 0);
+
+    char path[] = "/tmp/bench_traceXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    t0 = Bench_nowNs();
+    long events = Trace_dump(path);
+    Bench_report("trace_dump", 1, (double)(Bench_nowNs() - t0), NULL, 0);
+    Bench_reportValue("trace_dump_events", (double)events, "events");
+    unlink(path);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench_begin("hal", &argc, argv);
+
+    int tmp = mkstemp(s_spiPath);
+    if (tmp < 0) { perror("mkstemp"); return 1; }
+    close(tmp);
+    SPI_setDevicePath(s_spiPath);
+
+    bench_spi();
+    Period_init();
+    bench_period(1);
+    bench_period(4);
+
+    Sampler_init();
+    bench_sampler();
+    bench_pwm();
+    bench_udp();
+    Sampler_cleanup();
+    bench_trace();
+    Trace_cleanup();
+
+    unlink(s_spiPath);
+    return Bench_end();
+}
@@ -0,0 +1,106 @@
+// bench_jitter.c
+// Sampler-style periodic wake-up jitter under a synthetic CPU load, for each
+// thread placement / scheduling configuration of threadConfig.h.
+//
+// A measurement thread configured as THREAD_SAMPLER sleeps for the sampler's
+// 1 ms period in a loop while one busy thread per CPU competes with it. The
+// reported latency is how far each period overran 1 ms. Real-time settings
+// are refused without privileges; the applied settings are reported too.
+//
+// Usage: bench_jitter [-o results.json] [periods]
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "benchUtil.h"
+#include "hal/threadConfig.h"
+#include "hal/timing.h"
+
+#define PERIOD_US 1000
+
+static atomic_bool s_loadRunning;
+static int s_periods = 2000;
+
+static void *load_thread(void *arg)
+{
+    (void)arg;
+    volatile unsigned long long x = 0;
+    while (atomic_load(&s_loadRunning)) x++;
+    return NULL;
+}
+
+typedef struct {
+    const char *name;
+    ThreadSettings settings;
+} JitterConfig;
+
+static void *measure_thread(void *arg)
+{
+    const JitterConfig *cfg = arg;
+    ThreadConfig_set(THREAD_SAMPLER, cfg->settings);
+    ThreadConfig_applySelf(THREAD_SAMPLER);
+
+    long long *late = malloc(sizeof(long long) * s_periods);
+    if (!late) return NULL;
+    long long start = Bench_nowNs(), prev = start;
+    for (int i = 0; i < s_periods; i++) {
+        sleepForUs(PERIOD_US);
+        long long now = Bench_nowNs();
+        long long over = now - prev - PERIOD_US * 1000LL;
+        late[i] = over > 0 ? over : 0;
+        prev = now;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "overrun_%s", cfg->name);
+    Bench_report(name, s_periods, (double)(Bench_nowNs() - start), late, s_periods);
+
+    ThreadState st = ThreadConfig_get(THREAD_SAMPLER);
+    bool applied = st.applied.cpu == cfg->settings.cpu &&
+                   st.applied.policy == cfg->settings.policy;
+    snprintf(name, sizeof(name), "applied_%s", cfg->name);
+    Bench_reportValue(name, applied ? 1 : 0, "bool");
+    free(late);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    Bench_begin("jitter", &argc, argv);
+    if (argc > 1) s_periods = atoi(argv[1]);
+    if (s_periods <= 0) s_periods = 2000;
+
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int lastCpu = ncpu > 0 ? ncpu - 1 : 0;
+    const JitterConfig configs[] = {
+        { "idle_default", { -1, SCHED_OTHER, 0 } },
+        { "load_default", { -1, SCHED_OTHER, 0 } },
+        { "load_pinned",  { lastCpu, SCHED_OTHER, 0 } },
+        { "load_fifo",    { -1, SCHED_FIFO, 80 } },
+        { "load_fifo_pinned", { lastCpu, SCHED_FIFO, 80 } },
+    };
+
+    pthread_t load[256];
+    int nload = 0;
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        if (c == 1) {
+            // Everything after the idle baseline runs against one spinner per CPU
+            atomic_store(&s_loadRunning, true);
+            for (nload = 0; nload < ncpu && nload < 256; nload++) {
+                pthread_create(&load[nload], NULL, load_thread, NULL);
+            }
+        }
+        pthread_t t;
+        if (pthread_create(&t, NULL, measure_thread, (void *)&configs[c]) == 0) {
+            pthread_join(t, NULL);
+        }
+    }
+    atomic_store(&s_loadRunning, false);
+    for (int i = 0; i < nload; i++) pthread_join(load[i], NULL);
+    return Bench_end();
+}
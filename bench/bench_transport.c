@@ -0,0 +1,132 @@
+// bench_transport.c
+// Throughput of history replies over loopback: UDP datagram burst vs the
+// TCP bulk channel. Both servers answer from the same history cache, so the
+// difference is purely the transport.
+//
+// Usage: bench_transport [-o results.json] [samples-per-history] [requests]
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "benchUtil.h"
+#include "hal/UDP.h"
+#include "hal/tcpBulk.h"
+
+#define UDP_PORT 22345
+#define TCP_PORT 22346
+#define BATCH    16          // requests in flight at once
+
+static int s_samples = 1000;
+
+static double* fake_history(int *size)
+{
+    double *h = malloc(sizeof(double) * s_samples);
+    if (!h) { *size = 0; return NULL; }
+    for (int i = 0; i < s_samples; i++) h[i] = 1.0 + (i % 100) * 0.01;
+    *size = s_samples;
+    return h;
+}
+static unsigned long long fake_seq(void) { return 1; }
+
+static double now_s(void)
+{
+    return Bench_nowNs() / 1e9;
+}
+
+static int connect_to(int type, int port)
+{
+    int fd = socket(AF_INET, type, 0);
+    struct sockaddr_in a = {0};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&a, sizeof(a)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+static void report(const char *name, long long expected, long long got, double secs)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "%s_history_bin_throughput", name);
+    Bench_reportValue(key, got / secs / 1e6, "MB/s");
+    snprintf(key, sizeof(key), "%s_history_bin_delivered", name);
+    Bench_reportValue(key, 100.0 * got / expected, "%");
+}
+
+// Fire BATCH requests, then drain datagrams until the socket goes quiet.
+static void bench_udp(int requests, long long perReply)
+{
+    int fd = connect_to(SOCK_DGRAM, UDP_PORT);
+    long long got = 0;
+    static char buf[65536];
+    double t0 = now_s();
+    for (int done = 0; done < requests; done += BATCH) {
+        for (int i = 0; i < BATCH; i++) send(fd, "history_bin", 11, 0);
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+        while (poll(&p, 1, 20) > 0) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) got += n;
+        }
+    }
+    // The trailing 20 ms idle wait per batch is not transfer time
+    double secs = now_s() - t0 - (requests / BATCH) * 0.020;
+    report("udp", perReply * requests, got, secs > 0 ? secs : 1e-9);
+    close(fd);
+}
+
+// Pipeline BATCH requests and read exactly the expected reply bytes.
+static void bench_tcp(int requests, long long perReply)
+{
+    int fd = connect_to(SOCK_STREAM, TCP_PORT);
+    long long got = 0;
+    static char buf[65536];
+    char cmds[BATCH * 12];
+    for (int i = 0; i < BATCH; i++) memcpy(cmds + i * 12, "history_bin\n", 12);
+
+    double t0 = now_s();
+    for (int done = 0; done < requests; done += BATCH) {
+        if (send(fd, cmds, sizeof(cmds), 0) < 0) { perror("send"); break; }
+        long long want = got + perReply * BATCH;
+        while (got < want) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) { perror("recv"); goto out; }
+            got += n;
+        }
+    }
+out:
+    report("tcp", perReply * requests, got, now_s() - t0);
+    close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench_begin("transport", &argc, argv);
+    if (argc > 1) s_samples = atoi(argv[1]);
+    int requests = (argc > 2) ? atoi(argv[2]) : 2048;
+    if (s_samples <= 0 || requests <= 0) {
+        fprintf(stderr, "usage: %s [samples] [requests]\n", argv[0]);
+        return 1;
+    }
+    requests = (requests + BATCH - 1) / BATCH * BATCH;
+
+    UdpCallbacks cb = { .get_history = fake_history, .get_history_seq = fake_seq };
+    if (udp_start(UDP_PORT, cb) != 0 || tcp_bulk_start(TCP_PORT, cb) != 0) return 1;
+
+    long long perReply = 8 + 2LL * s_samples;   // HBIN header + uint16 samples
+    bench_udp(requests, perReply);
+    bench_tcp(requests, perReply);
+
+    tcp_bulk_stop();
+    udp_stop();
+    return Bench_end();
+}
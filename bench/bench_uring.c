@@ -0,0 +1,445 @@
+// bench_uring.c
+// Current synchronous I/O against the io_uring backend (see hal/uring.h):
+//   - PWM_setFrequency() into a temporary sysfs-like tree, through PWM.c
+//   - draining queued UDP command datagrams: recvfrom() per datagram
+//     against one multishot recvmsg into a provided buffer ring
+//   - a 16-packet history reply: sendto() per packet against one batch of
+//     linked sendmsg operations
+//   - UDP "count" round trips through the real command server
+// For each path the latency is timed in process, and the syscalls per
+// operation are counted by running the same work in a ptrace'd child
+// (reported as -1 where ptrace is not permitted).
+//
+// Usage: bench_uring [-o results.json]
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "benchUtil.h"
+#include "hal/PWM.h"
+#include "hal/UDP.h"
+#include "hal/uring.h"
+
+#define UDP_PORT     22351
+#define N_MSGS       256      // datagrams drained per repetition
+#define RECV_REPS    200
+#define N_PKTS       16       // packets per history reply
+#define PKT_BYTES    1400
+#define SEND_REPS    2000
+#define PWM_OPS      2000
+#define TRACED_REPS  20       // repetitions run under ptrace
+
+// ---------------------------------------------------------------------------
+// Syscall counting: run `run` in a child stopped under ptrace after `setup`
+// ---------------------------------------------------------------------------
+typedef void (*Workload)(void);
+
+static long long count_syscalls(Workload setup, Workload run)
+{
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        if (setup) setup();
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0) _exit(2);
+        raise(SIGSTOP);
+        run();
+        _exit(0);
+    }
+
+    int st;
+    if (waitpid(pid, &st, 0) < 0 || !WIFSTOPPED(st)) {
+        if (!WIFEXITED(st)) kill(pid, SIGKILL);
+        waitpid(pid, &st, 0);
+        return -1;
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+    long long stops = 0;
+    int sig = 0;
+    for (;;) {
+        if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)sig) < 0) break;
+        if (waitpid(pid, &st, 0) < 0 || WIFEXITED(st) || WIFSIGNALED(st)) break;
+        sig = 0;
+        if (WSTOPSIG(st) == (SIGTRAP | 0x80)) stops++;
+        else sig = WSTOPSIG(st);
+    }
+    // An entry and an exit stop per call, except the final exit_group
+    return stops > 0 ? (stops - 1) / 2 : -1;
+}
+
+static void empty_run(void) { }
+
+// Calls the harness itself makes around `run` (start-up after the stop)
+static long long s_baseline = 0;
+
+static long long count_run_syscalls(Workload setup, Workload run)
+{
+    long long calls = count_syscalls(setup, run);
+    return calls >= 0 ? calls - s_baseline : -1;
+}
+
+static void report_syscalls(const char *name, long long calls, long long ops, double nsPerOp)
+{
+    char key[96];
+    double perOp = calls >= 0 ? (double)calls / ops : -1;
+    snprintf(key, sizeof(key), "syscalls_per_op_%s", name);
+    Bench_reportValue(key, perOp, "syscalls");
+    snprintf(key, sizeof(key), "syscall_rate_%s", name);
+    Bench_reportValue(key, perOp >= 0 && nsPerOp > 0 ? perOp * 1e9 / nsPerOp : -1, "syscalls/s");
+}
+
+// ---------------------------------------------------------------------------
+// PWM through PWM.c
+// ---------------------------------------------------------------------------
+static char s_pwmDir[] = "/tmp/bench_uringXXXXXX";
+static int s_pwmOps = PWM_OPS;
+
+static void pwm_run(void)
+{
+    for (int i = 0; i < s_pwmOps; i++) PWM_setFrequency(1 + i % 500, 50);
+}
+
+static void pwm_setup_uring(void)
+{
+    Uring_enable();
+    PWM_setDirectory(s_pwmDir);
+    PWM_export();
+}
+
+static void bench_pwm(bool uring)
+{
+    static long long lat[PWM_OPS];
+    if (uring) Uring_enable();
+    PWM_setDirectory(s_pwmDir);
+    PWM_export();
+
+    long long total = 0;
+    for (int i = 0; i < PWM_OPS; i++) {
+        long long t0 = Bench_nowNs();
+        PWM_setFrequency(1 + i % 500, 50);
+        lat[i] = Bench_nowNs() - t0;
+        total += lat[i];
+    }
+    const char *name = uring ? "pwm_set_frequency_uring" : "pwm_set_frequency_sync";
+    Bench_report(name, PWM_OPS, (double)total, lat, PWM_OPS);
+
+    s_pwmOps = TRACED_REPS;
+    long long calls = count_run_syscalls(uring ? pwm_setup_uring : NULL, pwm_run);
+    s_pwmOps = PWM_OPS;
+    report_syscalls(uring ? "pwm_uring" : "pwm_sync", calls, TRACED_REPS,
+                    (double)total / PWM_OPS);
+}
+
+// ---------------------------------------------------------------------------
+// UDP receive and send, mirroring UDP.c
+// ---------------------------------------------------------------------------
+static int s_rxSock = -1, s_txSock = -1;
+static struct sockaddr_in s_rxAddr;
+static Uring s_ring;
+static UringBufRing s_bufs;
+static struct msghdr s_rxMsg;
+static int s_reps;
+
+static void open_sockets(void)
+{
+    s_rxSock = socket(AF_INET, SOCK_DGRAM, 0);
+    s_txSock = socket(AF_INET, SOCK_DGRAM, 0);
+    int big = 8 << 20;
+    setsockopt(s_rxSock, SOL_SOCKET, SO_RCVBUF, &big, sizeof(big));
+    memset(&s_rxAddr, 0, sizeof(s_rxAddr));
+    s_rxAddr.sin_family = AF_INET;
+    s_rxAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(s_rxAddr);
+    bind(s_rxSock, (struct sockaddr *)&s_rxAddr, sizeof(s_rxAddr));
+    getsockname(s_rxSock, (struct sockaddr *)&s_rxAddr, &len);
+}
+
+static void prefill(void)
+{
+    for (int i = 0; i < N_MSGS; i++) {
+        sendto(s_txSock, "count", 5, 0, (struct sockaddr *)&s_rxAddr, sizeof(s_rxAddr));
+    }
+}
+
+static void recv_sync(void)
+{
+    char buf[2048];
+    struct sockaddr_in cli;
+    for (int i = 0; i < N_MSGS; i++) {
+        socklen_t slen = sizeof(cli);
+        recvfrom(s_rxSock, buf, sizeof(buf), 0, (struct sockaddr *)&cli, &slen);
+    }
+}
+
+static bool arm_recv(void)
+{
+    struct io_uring_sqe *sqe = Uring_getSqe(&s_ring);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = 0;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->addr = (uintptr_t)&s_rxMsg;
+    sqe->len = 1;
+    sqe->buf_group = s_bufs.group;
+    return Uring_submit(&s_ring, 0) == 1;
+}
+
+static bool open_recv_ring(void)
+{
+    if (!Uring_init(&s_ring, 8, 128)) return false;
+    memset(&s_rxMsg, 0, sizeof(s_rxMsg));
+    s_rxMsg.msg_namelen = sizeof(struct sockaddr_in);
+    if (Uring_registerFiles(&s_ring, &s_rxSock, 1) == 0 &&
+        Uring_setupBufRing(&s_ring, &s_bufs, 0, 64, 2048) && arm_recv()) {
+        return true;
+    }
+    Uring_cleanup(&s_ring);
+    return false;
+}
+
+static void close_recv_ring(void)
+{
+    Uring_freeBufRing(&s_ring, &s_bufs);
+    Uring_cleanup(&s_ring);
+}
+
+// Returns false if the kernel rejected the multishot receive
+static bool recv_uring(void)
+{
+    char buf[2048];
+    int got = 0;
+    while (got < N_MSGS) {
+        bool rearm = false;
+        struct io_uring_cqe *cqe;
+        while ((cqe = Uring_peekCqe(&s_ring)) != NULL) {
+            int res = cqe->res;
+            unsigned flags = cqe->flags;
+            Uring_cqeSeen(&s_ring);
+            if (!(flags & IORING_CQE_F_MORE)) rearm = true;
+            if (res < 0 && res != -ENOBUFS) return false;
+            if (res < 0 || !(flags & IORING_CQE_F_BUFFER)) continue;
+            uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+            size_t off = sizeof(struct io_uring_recvmsg_out) + s_rxMsg.msg_namelen;
+            size_t len = (size_t)res > off ? (size_t)res - off : 0;
+            memcpy(buf, (char *)Uring_bufAddr(&s_bufs, bid) + off, len);
+            Uring_recycleBuf(&s_bufs, bid);
+            got++;
+        }
+        if (rearm && !arm_recv()) return false;
+        if (got < N_MSGS && Uring_submit(&s_ring, 1) < 0) return false;
+    }
+    return true;
+}
+
+static void recv_sync_traced(void)  { for (int r = 0; r < s_reps; r++) { prefill(); recv_sync(); } }
+static void recv_uring_setup(void)  { open_recv_ring(); }
+static void recv_uring_traced(void) { for (int r = 0; r < s_reps; r++) { prefill(); recv_uring(); } }
+
+static void bench_recv(bool uring)
+{
+    static long long lat[RECV_REPS];
+    if (uring && !open_recv_ring()) {
+        fprintf(stderr, "io_uring multishot receive unavailable: %s\n", strerror(errno));
+        return;
+    }
+    long long total = 0;
+    for (int r = 0; r < RECV_REPS; r++) {
+        prefill();
+        long long t0 = Bench_nowNs();
+        if (uring) {
+            if (!recv_uring()) { fprintf(stderr, "multishot receive rejected\n"); break; }
+        } else {
+            recv_sync();
+        }
+        lat[r] = (Bench_nowNs() - t0) / N_MSGS;   // per datagram
+        total += Bench_nowNs() - t0;
+    }
+    if (uring) close_recv_ring();
+    Bench_report(uring ? "udp_recv_datagram_uring" : "udp_recv_datagram_sync",
+                 (long long)RECV_REPS * N_MSGS, (double)total, lat, RECV_REPS);
+
+    // The traced child prefills with its own sendto()s; count those apart
+    s_reps = TRACED_REPS;
+    long long calls = uring ? count_run_syscalls(recv_uring_setup, recv_uring_traced)
+                            : count_run_syscalls(NULL, recv_sync_traced);
+    if (calls >= 0) calls -= (long long)TRACED_REPS * N_MSGS;
+    report_syscalls(uring ? "udp_recv_uring" : "udp_recv_sync", calls,
+                    (long long)TRACED_REPS * N_MSGS, (double)total / (RECV_REPS * N_MSGS));
+}
+
+static char s_pkt[PKT_BYTES];
+static struct msghdr s_txMsg[N_PKTS];
+static struct iovec s_txIov[N_PKTS];
+
+static void send_sync(void)
+{
+    for (int p = 0; p < N_PKTS; p++) {
+        sendto(s_txSock, s_pkt, sizeof(s_pkt), 0, (struct sockaddr *)&s_rxAddr, sizeof(s_rxAddr));
+    }
+}
+
+static void send_uring(void)
+{
+    for (int p = 0; p < N_PKTS; p++) {
+        struct io_uring_sqe *sqe = Uring_getSqe(&s_ring);
+        s_txIov[p].iov_base = s_pkt;
+        s_txIov[p].iov_len = sizeof(s_pkt);
+        memset(&s_txMsg[p], 0, sizeof(s_txMsg[p]));
+        s_txMsg[p].msg_name = &s_rxAddr;
+        s_txMsg[p].msg_namelen = sizeof(s_rxAddr);
+        s_txMsg[p].msg_iov = &s_txIov[p];
+        s_txMsg[p].msg_iovlen = 1;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = 0;
+        sqe->flags = IOSQE_FIXED_FILE | (p + 1 < N_PKTS ? IOSQE_IO_LINK : 0);
+        sqe->addr = (uintptr_t)&s_txMsg[p];
+        sqe->len = 1;
+    }
+    int submitted = Uring_submit(&s_ring, N_PKTS);
+    for (int done = 0; done < submitted; ) {
+        if (!Uring_peekCqe(&s_ring)) {
+            if (Uring_submit(&s_ring, 1) < 0) return;
+            continue;
+        }
+        Uring_cqeSeen(&s_ring);
+        done++;
+    }
+}
+
+static bool open_send_ring(void)
+{
+    if (!Uring_init(&s_ring, N_PKTS, 0)) return false;
+    if (Uring_registerFiles(&s_ring, &s_txSock, 1) == 0) return true;
+    Uring_cleanup(&s_ring);
+    return false;
+}
+
+static void drain_rx(void)
+{
+    char buf[2048];
+    while (recv(s_rxSock, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+}
+
+static void send_sync_traced(void)  { for (int r = 0; r < s_reps; r++) send_sync(); }
+static void send_uring_setup(void)  { open_send_ring(); }
+static void send_uring_traced(void) { for (int r = 0; r < s_reps; r++) send_uring(); }
+
+static void bench_send(bool uring)
+{
+    static long long lat[SEND_REPS];
+    if (uring && !open_send_ring()) {
+        fprintf(stderr, "io_uring unavailable: %s\n", strerror(errno));
+        return;
+    }
+    long long total = 0;
+    for (int r = 0; r < SEND_REPS; r++) {
+        long long t0 = Bench_nowNs();
+        if (uring) send_uring();
+        else       send_sync();
+        lat[r] = Bench_nowNs() - t0;
+        total += lat[r];
+        drain_rx();
+    }
+    if (uring) Uring_cleanup(&s_ring);
+    Bench_report(uring ? "udp_send_history_uring" : "udp_send_history_sync",
+                 SEND_REPS, (double)total, lat, SEND_REPS);
+
+    s_reps = TRACED_REPS;
+    long long calls = uring ? count_run_syscalls(send_uring_setup, send_uring_traced)
+                            : count_run_syscalls(NULL, send_sync_traced);
+    report_syscalls(uring ? "udp_send_history_uring" : "udp_send_history_sync", calls,
+                    TRACED_REPS, (double)total / SEND_REPS);
+    drain_rx();
+}
+
+// ---------------------------------------------------------------------------
+// Round trips through the command server (its thread uses whichever path)
+// ---------------------------------------------------------------------------
+static int cb_count_dummy(void) { return 0; }
+static long long cb_total_dummy(void) { return 42; }
+
+static void bench_roundtrip(bool uring)
+{
+    enum { N = 2000 };
+    static long long lat[N];
+    if (uring) Uring_enable();
+    UdpCallbacks cb = { .get_count = cb_total_dummy, .get_history_size = cb_count_dummy };
+    if (udp_start(UDP_PORT, cb) != 0) return;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a = {0};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(UDP_PORT);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    connect(fd, (struct sockaddr *)&a, sizeof(a));
+
+    char buf[256];
+    long long total = 0;
+    for (int i = 0; i < N; i++) {
+        long long t0 = Bench_nowNs();
+        send(fd, "count", 5, 0);
+        recv(fd, buf, sizeof(buf), 0);
+        lat[i] = Bench_nowNs() - t0;
+        total += lat[i];
+    }
+    Bench_report(uring ? "udp_roundtrip_count_uring" : "udp_roundtrip_count_sync",
+                 N, (double)total, lat, N);
+    close(fd);
+    udp_stop();
+}
+
+int main(int argc, char *argv[])
+{
+    Bench_begin("uring", &argc, argv);
+    memset(s_pkt, 'x', sizeof(s_pkt));
+
+    if (!mkdtemp(s_pwmDir)) { perror("mkdtemp"); return 1; }
+    const char *files[] = { "duty_cycle", "period", "enable" };
+    char path[128];
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", s_pwmDir, files[i]);
+        FILE *f = fopen(path, "w");
+        if (f) fclose(f);
+    }
+
+    s_baseline = count_syscalls(NULL, empty_run);
+    if (s_baseline < 0) {
+        fprintf(stderr, "ptrace not permitted: syscall counts reported as -1\n");
+        s_baseline = 0;
+    }
+
+    open_sockets();
+    bench_pwm(false);
+    bench_recv(false);
+    bench_send(false);
+    bench_roundtrip(false);
+    // Uring_enable() has no off switch, so the io_uring runs come last
+    bench_recv(true);
+    bench_send(true);
+    bench_pwm(true);
+    bench_roundtrip(true);
+    close(s_rxSock);
+    close(s_txSock);
+
+    PWM_setDirectory(NULL);
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", s_pwmDir, files[i]);
+        unlink(path);
+    }
+    rmdir(s_pwmDir);
+    return Bench_end();
+}
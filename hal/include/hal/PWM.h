@@ -6,10 +6,18 @@
 #include <time.h>
 
 
-#define PWM_DUTY_CYCLE_FILE "/dev/hat/pwm/GPIO15/duty_cycle"
-#define PWM_PERIOD_FILE "/dev/hat/pwm/GPIO15/period"
-#define PWM_ENABLE_FILE "/dev/hat/pwm/GPIO15/enable"
+#define PWM_DIR "/dev/hat/pwm/GPIO15"
+#define PWM_DUTY_CYCLE_FILE PWM_DIR "/duty_cycle"
+#define PWM_PERIOD_FILE PWM_DIR "/period"
+#define PWM_ENABLE_FILE PWM_DIR "/enable"
 
+// Highest LED frequency; PWM_setFrequency() refuses anything above it
+#define PWM_MAX_HZ 500
+
+
+// Use the duty_cycle/period/enable files in `dir` instead of PWM_DIR
+// (another pin, or a temporary tree for benchmarks). Call before PWM_export().
+void PWM_setDirectory(const char *dir);
 
 // PWM helper Functions
 bool PWM_export();
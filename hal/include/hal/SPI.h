@@ -14,6 +14,10 @@
 
 #define SPI_DEV_PATH "/dev/spidev0.0"
 
+// Use a different spidev node than SPI_DEV_PATH (other bus/chip select, or a
+// stand-in device for benchmarks). The string must outlive its use.
+void SPI_setDevicePath(const char *path);
+
 // read a channel from the ADC and return the 12-bit raw value (0..4095)
 // static int read_ch(int fd, int ch, uint32_t speed_hz);
 
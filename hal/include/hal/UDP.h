@@ -14,6 +14,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "hal/freqAnalyzer.h"
+#include "hal/windowStats.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -36,10 +39,20 @@ typedef struct {
     double    (*get_average)(void);           // average light reading
     long long (*get_total_samples)(void);     // total samples taken
     bool      (*set_console_output)(bool enabled); // Enable/disable console output
+    unsigned long long (*get_history_seq)(void); // changes whenever history does;
+                                            // lets replies reuse encoded history
+    void      (*get_frequency)(FreqEstimate *out); // measured LED frequency
+    bool      (*get_window_stats)(int windowMs, WindowStatsResult *out);
+                                            // false if that window isn't tracked
+    int       (*get_stats_windows)(int *windowMs, int max); // tracked windows (ms)
+    bool      (*set_filter)(const char *spec, char *err, int errLen); // history filter
+    void      (*describe_filter)(char *buf, int len);
 } UdpCallbacks;
 
 // ---------------------------------------------------------------------------
-// Starts the UDP listener thread.
+// Starts the UDP listener thread, or registers the socket with the reactor
+// instead when Reactor_init() has been called (see reactor.h); "stop" then
+// also stops the reactor.
 //   port — UDP port number (e.g., 12345).
 //   cb   — callbacks providing data access.
 // Returns 0 on success, -1 on failure.
@@ -47,7 +60,8 @@ typedef struct {
 int udp_start(uint16_t port, UdpCallbacks cb);
 
 // ---------------------------------------------------------------------------
-// Stops the UDP server thread gracefully, closes socket, frees resources.
+// Stops the UDP server thread (or detaches from the reactor), closes socket,
+// frees resources.
 // Safe to call even if server isn’t running.
 // ---------------------------------------------------------------------------
 void udp_stop(void);
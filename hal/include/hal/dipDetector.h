@@ -0,0 +1,30 @@
+// dipDetector.h
+// Light dip detector: exponential moving average of the light level plus a
+// threshold/hysteresis state machine that reports each dip once.
+//
+// This is the detection logic of the sampler thread, kept free of hardware,
+// timing and locking so the same code can be driven by the live sampler and
+// by offline replay (see replay.h) at any speed.
+
+#ifndef _DIP_DETECTOR_H_
+#define _DIP_DETECTOR_H_
+
+#include <stdbool.h>
+
+#define DIP_AVG_WEIGHT  0.999  // weight of the old average per sample
+#define DIP_THRESHOLD   0.1    // Must drop this far below average to trigger (volts)
+#define DIP_HYSTERESIS  0.03   // Must recover this much to re-arm
+
+typedef struct {
+    double avgExp;      // exponential average of the light level (volts)
+    bool   firstSample; // no average yet
+    bool   armed;       // ready to report the next dip
+} DipDetector;
+
+void DipDetector_init(DipDetector *d);
+
+// Feed one sample (volts). Returns true if this sample starts a new dip.
+// The average is updated after the dip decision, as the sampler always did.
+bool DipDetector_feed(DipDetector *d, double volts);
+
+#endif
@@ -0,0 +1,67 @@
+// filterChain.h
+// Filter-and-decimate stage between acquisition and storage.
+//
+// A low-pass FIR followed by decimation by M (only every M-th output is
+// computed, i.e. the polyphase form, so the cost is taps/M multiply-adds per
+// input sample), then up to FILTER_MAX_BIQUADS biquad IIR sections at the
+// output rate. The FIR dot product uses SSE2 or NEON where available.
+//
+// Configured from a spec string of comma-separated items, e.g.
+//   "decim=4"                 FIR low-pass at 0.4 x output rate, decimate by 4
+//   "decim=8,taps=63,cutoff=50,notch=60,lp=40"
+//   decim=M     decimation factor (1..FILTER_MAX_DECIM); 1 = no FIR
+//   taps=N      FIR length (odd, default 8*M+1, at most FILTER_MAX_TAPS)
+//   cutoff=HZ   FIR cut-off (default 0.4 x the output rate)
+//   q=Q         quality factor for the biquads that follow (default 0.707)
+//   lp=HZ hp=HZ notch=HZ   add a biquad section (RBJ cookbook designs)
+
+#ifndef _FILTER_CHAIN_H_
+#define _FILTER_CHAIN_H_
+
+#include <stdbool.h>
+
+#define FILTER_MAX_DECIM    32
+#define FILTER_MAX_TAPS     255
+#define FILTER_MAX_BIQUADS  4
+#define FILTER_SPEC_MAX     128
+
+typedef struct {
+    double b0, b1, b2, a1, a2;   // normalized coefficients (a0 = 1)
+    double z1, z2;               // transposed direct form II state
+} Biquad;
+
+typedef struct {
+    char   spec[FILTER_SPEC_MAX];
+    double inputRateHz;
+    int    decim;
+    int    numTaps;
+    double cutoffHz;
+    double taps[FILTER_MAX_TAPS];       // FIR impulse response
+    double history[2 * FILTER_MAX_TAPS];// input mirrored twice: a contiguous window
+    int    pos;                         // next write position in history
+    int    phase;                       // input samples since the last output
+    int    numBiquads;
+    Biquad biquads[FILTER_MAX_BIQUADS];
+} FilterChain;
+
+// Build a chain for samples arriving at `inputRateHz`. On failure returns
+// NULL and writes a reason to `err` (if given).
+FilterChain *FilterChain_create(const char *spec, double inputRateHz,
+                                char *err, int errLen);
+void FilterChain_destroy(FilterChain *fc);
+
+// As FilterChain_create(), into caller-provided storage (no allocation).
+bool FilterChain_init(FilterChain *fc, const char *spec, double inputRateHz,
+                      char *err, int errLen);
+
+// Push one input sample. Returns true and sets *out when an output sample
+// (at inputRate / decim) is ready.
+bool FilterChain_push(FilterChain *fc, double x, double *out);
+
+// Output sample rate in Hz.
+double FilterChain_outputRate(const FilterChain *fc);
+
+// Human-readable summary of the active configuration.
+void FilterChain_describe(const FilterChain *fc, char *buf, int len);
+
+#endif
@@ -0,0 +1,17 @@
+// fixedPoint.h
+// ENSC 351 Fall 2025
+// Integer-only number formatting for hot output paths (UDP history replies).
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+// Longest string FixedPoint_format3() writes, not counting the '\0'.
+#define FIXEDPOINT_MAX_LEN 24
+
+// Format `value` the same way as printf("%.3f") but without going through
+// the stdio formatter. Writes at most FIXEDPOINT_MAX_LEN characters plus a
+// terminating '\0' into `buf` and returns the number of characters written.
+// Values too large for the integer path fall back to snprintf().
+int FixedPoint_format3(char *buf, double value);
+
+#endif
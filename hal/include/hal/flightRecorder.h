@@ -0,0 +1,78 @@
+// flightRecorder.h
+// Optional crash-safe flight recorder for raw samples and dip events.
+//
+// Samples are copied from the shared-memory sample ring (see sampleRing.h)
+// by a background thread into a fixed-size, memory-mapped circular file,
+// so the sampler thread does no extra work and no file I/O at all.
+// Once a second the recorder msync()s the new records and only then
+// advances the header, so after a crash or power loss the header never
+// points at records that were not on disk.
+//
+// File layout:
+//   page 0      two header copies (A/B); each update goes to the older copy
+//               with seq+1 and a checksum, readers use the newest valid one
+//   page 1...   records, written round-robin
+// Every record carries its own stream index, so a reader can also recover
+// records written after the last header update and skip stale slots.
+
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECORDER_MAGIC        0x4C535243u   // 'LSRC'
+#define RECORDER_VERSION      1
+#define RECORDER_DATA_OFFSET  4096
+#define RECORDER_DEFAULT_MB   16            // ~11 minutes at 1 kHz
+
+#define RECORDER_FLAG_DIP     0x1
+
+typedef struct {
+    uint64_t index;           // position in the recorded stream + 1 (0 = empty)
+    int64_t  timestampNs;     // CLOCK_REALTIME of the sample (survives reboots)
+    float    volts;
+    uint32_t flags;           // RECORDER_FLAG_*
+} RecorderRecord;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seq;             // bumped on every header write
+    uint64_t capacity;        // number of record slots
+    uint64_t count;           // records durable on disk (stream length)
+    uint64_t lost;            // samples the recorder could not keep up with
+    uint64_t checksum;        // over all fields above
+} RecorderHeader;
+
+// ---- Recording (light_sampler) --------------------------------------------
+
+// Start recording into `path`, `sizeMb` MiB in total. An existing recording
+// of the same size is continued, so data from before a crash is kept.
+// Requires the sample ring to exist. Returns false on failure.
+bool Recorder_start(const char *path, int sizeMb);
+
+// Flush everything recorded so far and stop the recorder thread.
+void Recorder_stop(void);
+
+// ---- Reading (tools) -------------------------------------------------------
+
+typedef struct {
+    int fd;
+    const uint8_t *map;
+    size_t mapLen;
+    RecorderHeader hdr;       // newest valid header
+} RecorderFile;
+
+// Map a recording read-only. Returns false if missing or no valid header.
+bool Recorder_open(const char *path, RecorderFile *f);
+
+// Call `fn` for each valid record, oldest first, including any records
+// written after the last header update. Stops early if `fn` returns false.
+void Recorder_forEach(const RecorderFile *f,
+                      bool (*fn)(const RecorderRecord *rec, void *arg), void *arg);
+
+void Recorder_close(RecorderFile *f);
+
+#endif
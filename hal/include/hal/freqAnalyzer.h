@@ -0,0 +1,88 @@
+// freqAnalyzer.h
+// Streaming frequency analysis of the light level, to measure the LED's
+// actual flash frequency instead of inferring it from dip counts.
+//
+// Two estimators:
+//   - A bank of sliding DFT (sliding Goertzel) bins spread around the
+//     commanded LED frequency over a one-second window. Each sample costs
+//     O(number of bins), independent of the window length. The recursion
+//     is damped by FREQ_DAMPING per sample, so rounding error decays
+//     instead of piling up and the sums never need rebuilding for it.
+//   - A block FFT (Hann window, radix-2) over a whole second of history,
+//     run once per second outside the sampling path, which also finds
+//     the LED when it is far from the commanded frequency.
+// Peaks are refined by parabolic interpolation between neighbouring bins.
+
+#ifndef _FREQ_ANALYZER_H_
+#define _FREQ_ANALYZER_H_
+
+#include <stdbool.h>
+
+#define FREQ_NUM_BINS     9        // sliding bins around the target
+#define FREQ_SPAN         0.2      // bins cover target * (1 +/- FREQ_SPAN)
+#define FREQ_MIN_SPAN_HZ  2.0      // ...but at least +/- this many Hz
+#define FREQ_FFT_MAX      16384    // largest block FFT (power of 2)
+#define FREQ_DAMPING      0.999999 // r in S = x + r e^{jw} S - r^N e^{jwN} x[n-N]
+#define FREQ_RATE_TOLERANCE 0.01   // re-centre when the rate moves by more than 1%
+
+typedef struct {
+    double hz;          // dominant frequency (0 if none)
+    double volts;       // amplitude of that component (V)
+    double ratio;       // peak power relative to the mean of the other bins
+} FreqPeak;
+
+// What the sampler reports once a second
+typedef struct {
+    int      commandedHz;  // frequency the LED was told to flash at
+    FreqPeak tracked;      // sliding bins around commandedHz
+    FreqPeak fft;          // block FFT over the previous second
+} FreqEstimate;
+
+typedef struct {
+    int     windowLen;          // samples in the sliding window
+    double *window;             // circular buffer of the last windowLen samples
+    int     pos;                // next write position in window
+    int     filled;             // samples in window so far
+    double  sampleRateHz;
+    double  targetHz;
+    double  binHz[FREQ_NUM_BINS];
+    double  wRe[FREQ_NUM_BINS], wIm[FREQ_NUM_BINS];   // r e^{j w}
+    double  wNRe[FREQ_NUM_BINS], wNIm[FREQ_NUM_BINS]; // r^N e^{j w N}
+    double  sRe[FREQ_NUM_BINS], sIm[FREQ_NUM_BINS];   // sliding sums
+    long long fed;              // samples fed so far
+} FreqAnalyzer;
+
+// Allocate a sliding window of `windowLen` samples. Returns false on failure.
+bool FreqAnalyzer_init(FreqAnalyzer *fa, int windowLen);
+void FreqAnalyzer_cleanup(FreqAnalyzer *fa);
+
+// Centre the bins on `targetHz` for a stream sampled at `sampleRateHz`.
+// Recomputes the sliding sums from the window (O(window * bins)), so call it
+// when the target or the measured rate changes, not per sample.
+void FreqAnalyzer_setTarget(FreqAnalyzer *fa, double targetHz, double sampleRateHz);
+
+// True if the target differs or the rate moved by more than
+// FREQ_RATE_TOLERANCE; otherwise the current bins are good enough.
+bool FreqAnalyzer_needsTarget(const FreqAnalyzer *fa, double targetHz, double sampleRateHz);
+
+// Re-centre without holding up the feeder for the whole rebuild:
+//   FreqAnalyzer_copy(&scratch, &live);         under the feeder's lock
+//   FreqAnalyzer_setTarget(&scratch, ...);      lock released
+//   FreqAnalyzer_adopt(&live, &scratch);        under the lock again
+// `scratch` needs its own window of the same length (FreqAnalyzer_init).
+// adopt() feeds the scratch the samples that arrived in between (they are
+// still in the live window) and takes over its bins.
+void FreqAnalyzer_copy(FreqAnalyzer *dst, const FreqAnalyzer *src);
+void FreqAnalyzer_adopt(FreqAnalyzer *live, FreqAnalyzer *scratch);
+
+// Add one sample. O(FREQ_NUM_BINS).
+void FreqAnalyzer_feed(FreqAnalyzer *fa, double volts);
+
+// Strongest of the sliding bins (interpolated).
+FreqPeak FreqAnalyzer_peak(const FreqAnalyzer *fa);
+
+// Dominant non-DC frequency of `samples` by block FFT. Uses the largest
+// power-of-two prefix (up to FREQ_FFT_MAX). Not reentrant (static scratch).
+FreqPeak FreqAnalyzer_blockFft(const double *samples, int n, double sampleRateHz);
+
+#endif
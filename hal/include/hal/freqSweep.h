@@ -0,0 +1,54 @@
+// freqSweep.h
+// Automated LED frequency sweep: steps the PWM across a range of flash
+// rates and records how many dips per second the detector reports at each,
+// giving the detector's accuracy curve and the highest rate it tracks.
+//
+// Runs in the caller's thread and takes over the once-a-second work the
+// main loop normally does (Sampler_moveCurrentDataToHistory() and friends),
+// so the main loop must not run at the same time. Works the same on the
+// device and with the simulation backend.
+
+#ifndef _FREQ_SWEEP_H_
+#define _FREQ_SWEEP_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SWEEP_DEFAULT_SPEC  "1:500:x1.25"
+#define SWEEP_MAX_POINTS    512
+#define SWEEP_TOLERANCE     0.05    // dips within 5% of the flash rate count as tracking
+
+typedef struct {
+    double fromHz, toHz;
+    double step;            // Hz added per point, or factor if geometric
+    bool   geometric;
+    int    settleSec;       // seconds discarded after each change (default 1)
+    int    measureSec;      // seconds measured per point (default 3)
+} SweepConfig;
+
+typedef struct {
+    int    hz;              // commanded flash rate = expected dips per second
+    double dipsMean;        // per second over the measured seconds
+    int    dipsMin, dipsMax;
+    double accuracy;        // dipsMean / hz
+    double trackedHz;       // frequency analyzer's estimate (freqAnalyzer.h)
+    double samplesPerSec;
+} SweepPoint;
+
+typedef struct {
+    int        numPoints;
+    SweepPoint points[SWEEP_MAX_POINTS];
+    int        maxTrackedHz;  // highest rate before accuracy first leaves tolerance
+} SweepResult;
+
+// Parse "FROM:TO:STEP" (linear) or "FROM:TO:xFACTOR" (geometric).
+bool Sweep_parseSpec(const char *spec, SweepConfig *cfg);
+
+// Run the sweep. Prints progress to stderr. Leaves the LED at the last rate.
+bool Sweep_run(const SweepConfig *cfg, SweepResult *res);
+
+// Write the accuracy curve as CSV or JSON.
+void Sweep_writeCsv(const SweepResult *res, FILE *f);
+void Sweep_writeJson(const SweepResult *res, FILE *f);
+
+#endif
@@ -0,0 +1,58 @@
+// historyCache.h
+// Encoded copies of the sampler's previous-second history, shared by the
+// network servers (UDP command server and TCP bulk channel).
+//
+// Each encoding of a history snapshot is built at most once, lazily on the
+// first request, and then handed out as an immutable reference-counted blob.
+// A server may keep a blob (for example while a slow TCP client drains it)
+// after the sampler has moved on; the blob is freed on its last release.
+
+#ifndef _HISTORY_CACHE_H_
+#define _HISTORY_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HISTORY_PKT_MAX   1400        // keep datagrams below a typical MTU
+#define HISTORY_BIN_MAGIC 0x4842494E  // 'HBIN'
+#define HISTORY_BIN_HDR   8           // magic + uint32 sample count
+#define HISTORY_POOL_MAX  8           // preallocated blobs per encoding
+
+typedef enum {
+    HISTORY_TEXT,   // "1.234, 0.056, ..." 10 per line
+    HISTORY_BIN,    // 'HBIN' + uint32 N + N uint16 millivolts, network order
+    NUM_HISTORY_ENCODINGS
+} HistoryEncoding;
+
+typedef struct {
+    unsigned long long seq;  // history snapshot this was built from
+    int   len;               // bytes in data
+    int   numPkts;           // datagram split: packet i ends at pktEnd[i]
+    int  *pktEnd;
+    char *data;
+} HistoryBlob;
+
+// Where the history comes from (normally Sampler_getHistory and
+// Sampler_getHistorySeq). get_seq may be NULL, which disables caching.
+void HistoryCache_setSource(double* (*get_history)(int *size),
+                            unsigned long long (*get_seq)(void));
+
+// Get the encoding of the current history snapshot, or NULL if there is
+// no history. The caller must pass the result to HistoryCache_release().
+// Threadsafe.
+const HistoryBlob* HistoryCache_get(HistoryEncoding enc);
+void HistoryCache_release(const HistoryBlob *blob);
+
+// Allocation-free mode: preallocate `poolSize` blobs per encoding sized for
+// `maxSamples` samples, plus a copy buffer filled by `copy_history` (e.g.
+// Sampler_copyHistory) instead of the source's get_history. From then on the
+// cache never allocates; if every pooled blob is still referenced (clients
+// lagging by more than poolSize-1 seconds), HistoryCache_get() returns NULL.
+bool HistoryCache_preallocate(int maxSamples, int poolSize,
+                              int (*copy_history)(double *dst, int max));
+
+// Drop the cached blobs (outstanding references stay valid) and any
+// preallocated pool.
+void HistoryCache_cleanup(void);
+
+#endif
@@ -0,0 +1,46 @@
+// loopback.h
+// Optical loopback latency: time from a PWM command to the sampler seeing
+// the LED change.
+//
+// Drives the LED fully on and off with timestamped PWM duty-cycle writes and
+// locates each resulting light step in the timestamped sample stream from
+// the shared-memory ring (sampleRing.h). Each step is found by correlating
+// the samples around the command with a step template (the best two-level
+// least-squares fit), which is robust to noise and single-sample glitches.
+// The latency is the timestamp of the first sample at the new level minus
+// the time the PWM write started, so it includes the write, the LED, the
+// sensor and up to one sample period of the sampler.
+//
+// Works the same with the simulated optical loop (simulation.h, lag_us).
+// Needs the sampler running, and owns the PWM while it runs.
+
+#ifndef _LOOPBACK_H_
+#define _LOOPBACK_H_
+
+#include <stdbool.h>
+
+typedef struct {
+    int steps;             // PWM steps to apply (alternating on/off)
+    int holdMs;            // time to hold each level (also the search window)
+    double minStepVolts;   // smaller light changes count as missed steps
+} LoopbackConfig;
+
+typedef struct {
+    int        steps;          // steps applied
+    int        detected;       // steps found in the sample stream
+    long long *latencyNs;      // one per detected step (malloc'd)
+    double     meanNs;
+    long long  minNs, p50Ns, p90Ns, p99Ns, maxNs;
+    double     writeMeanNs;    // average cost of the PWM write itself
+    double     stepVolts;      // average light change per step
+} LoopbackResult;
+
+#define LOOPBACK_DEFAULT_HOLD_MS   50
+#define LOOPBACK_MIN_STEP_VOLTS    0.05
+
+// Run the measurement. Leaves the LED off. Release with Loopback_freeResult().
+bool Loopback_measure(const LoopbackConfig *cfg, LoopbackResult *res);
+
+void Loopback_freeResult(LoopbackResult *res);
+
+#endif
@@ -0,0 +1,50 @@
+// medianFilter.h
+// Streaming sliding-median prefilter for ADC spike rejection.
+//
+// Keeps the last `width` samples split between a max-heap (lower half) and a
+// min-heap (upper half), so each new sample costs O(log width): the oldest
+// sample is overwritten in place and re-heaped, then the two roots are
+// swapped if they cross.
+//
+// Two modes:
+//   - threshold 0: output is the median of the last `width` samples.
+//   - threshold > 0 (Hampel-style): a sample passes through unchanged
+//     unless it lies more than `threshold` volts from the window median, in
+//     which case the median replaces it. Real dips lasting more than half the
+//     window pass untouched; isolated glitches do not.
+// A window of w samples rejects spikes up to (w-1)/2 samples long, and also
+// rejects real dips that short: keep the width well under half the LED
+// period in samples.
+
+#ifndef _MEDIAN_FILTER_H_
+#define _MEDIAN_FILTER_H_
+
+#include <stdbool.h>
+
+#define MEDIAN_MAX_WIDTH 255   // odd widths from 3 to this
+
+typedef struct {
+    int    width;
+    double threshold;
+    int    count;                      // samples in the window so far
+    int    next;                       // slot of the oldest sample
+    double vals[MEDIAN_MAX_WIDTH];     // window, by slot
+    int    heapOf[MEDIAN_MAX_WIDTH];   // 0 = low (max) heap, 1 = high (min) heap
+    int    posOf[MEDIAN_MAX_WIDTH];    // index within that heap
+    int    heap[2][MEDIAN_MAX_WIDTH];  // slots
+    int    size[2];
+} MedianFilter;
+
+// `width` must be odd and in [3, MEDIAN_MAX_WIDTH]; `threshold` >= 0 volts.
+bool MedianFilter_init(MedianFilter *mf, int width, double threshold);
+
+// Feed one sample and return the filtered value.
+double MedianFilter_feed(MedianFilter *mf, double volts);
+
+// Median of the current window (0 if empty).
+double MedianFilter_median(const MedianFilter *mf);
+
+// Parse "W" or "W:THRESHOLD" (e.g. "5:0.2"). Returns false if invalid.
+bool MedianFilter_parseSpec(const char *spec, int *width, double *threshold);
+
+#endif
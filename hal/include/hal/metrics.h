@@ -0,0 +1,55 @@
+// metrics.h
+// Registry of counters, gauges and histograms, served over HTTP in the
+// Prometheus text format (GET /metrics).
+//
+// Modules register their metrics once at start-up and keep the returned
+// handle; recording is then a relaxed atomic add or store on that handle,
+// with no lock and no lookup, so it can sit in the sampler loop. Every
+// recording function accepts NULL (registry full, or the module was never
+// started) and does nothing.
+//
+// A name may carry a fixed label set, e.g.
+//   Metrics_counter("udp_requests_total{command=\"history\"}", "...")
+// Series of one family are printed together under one HELP/TYPE header.
+// Registering an existing name returns the existing handle.
+//
+// The endpoint runs on its own thread (THREAD_METRICS), or on the reactor
+// when Reactor_init() has been called; each scrape is formatted into a
+// preallocated per-connection buffer.
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define METRICS_DEFAULT_PORT   12347
+#define METRICS_MAX            96       // registered series
+#define METRICS_MAX_BUCKETS    16       // histogram buckets (plus +Inf)
+#define METRICS_NAME_MAX       96
+
+typedef struct Metric Metric;
+
+Metric* Metrics_counter(const char *name, const char *help);
+Metric* Metrics_gauge(const char *name, const char *help);
+// `bounds`: ascending upper bounds of the buckets (at most METRICS_MAX_BUCKETS).
+Metric* Metrics_histogram(const char *name, const char *help,
+                          const double *bounds, int numBounds);
+
+void Metrics_inc(Metric *m);
+void Metrics_add(Metric *m, uint64_t n);
+void Metrics_set(Metric *m, double value);
+void Metrics_observe(Metric *m, double value);
+
+// Current value of a counter or gauge (0 for NULL).
+double Metrics_value(const Metric *m);
+
+// Write the exposition text into buf (always NUL-terminated). Returns the
+// length, or -1 if it didn't fit.
+int Metrics_format(char *buf, int len);
+
+// Serve GET /metrics on `port`. Returns 0 on success, -1 on failure.
+int Metrics_startServer(uint16_t port);
+void Metrics_stopServer(void);
+
+#endif
@@ -0,0 +1,49 @@
+// overrun.h
+// Accounting for the ways the sampling path can lose or delay data.
+//
+// Each kind keeps a count and the time of its last occurrence
+// (getTimeInNs() timeline), recorded with relaxed atomics from whichever
+// thread notices it:
+//   late_sample      a sample came more than half a period after the last
+//   dropped_sample   the second's buffer was full and a sample was not stored
+//   adc_failure      Read_ADC_Values() failed
+//   late_second      a once-a-second boundary was more than
+//                    OVERRUN_LATE_SECOND_MS late
+//   period_overflow  the period timer had no room for a timestamp, so the
+//                    second's timing statistics are incomplete
+// Each kind is also exported as a counter on the metrics endpoint.
+
+#ifndef _OVERRUN_H_
+#define _OVERRUN_H_
+
+#include <stdbool.h>
+
+#define OVERRUN_LATE_SECOND_MS  50
+
+typedef enum {
+    OVERRUN_LATE_SAMPLE,
+    OVERRUN_DROPPED_SAMPLE,
+    OVERRUN_ADC_FAILURE,
+    OVERRUN_LATE_SECOND,
+    OVERRUN_PERIOD_OVERFLOW,
+    OVERRUN_KIND_COUNT
+} OverrunKind;
+
+typedef struct {
+    long long count;
+    long long lastNs;      // 0: never
+} OverrunInfo;
+
+// Clear the counts and register the metrics.
+void Overrun_init(void);
+
+void Overrun_record(OverrunKind kind);
+void Overrun_recordAt(OverrunKind kind, long long timeInNs);
+
+OverrunInfo Overrun_get(OverrunKind kind);
+const char* Overrun_name(OverrunKind kind);
+
+// Sum over all kinds.
+long long Overrun_total(void);
+
+#endif
@@ -16,7 +16,8 @@
 //     information to print to the screen.
 
 // Maximum number of timestamps to record for a given event.
-#define MAX_EVENT_TIMESTAMPS (1024*4)
+// Sized for one second of samples at up to ~15 kHz (simulated load tests).
+#define MAX_EVENT_TIMESTAMPS (1024*16)
 
 enum Period_whichEvent {
     PERIOD_EVENT_SAMPLE_LIGHT,
@@ -42,6 +43,10 @@ void Period_cleanup(void);
 // and compute the timing statistics for this periodic event.
 void Period_markEvent(enum Period_whichEvent whichEvent);
 
+// Same, with a timestamp the caller already took with getTimeInNs()
+// (saves reading the clock twice for one event).
+void Period_markEventAt(enum Period_whichEvent whichEvent, long long timeInNs);
+
 // Fill the `pStats` struct, which must be allocated by the calling
 // code, with the statistics about the periodic event `whichEvent`.
 // This function is threadsafe, and may be called by any thread.
@@ -0,0 +1,45 @@
+// pwmControl.h
+// Single owner of the LED's PWM output, fed through a latest-value mailbox.
+//
+// The rotary encoder and the UDP setfreq/setduty commands only post the
+// frequency or duty they want; posting is an atomic update of one word and
+// a wakeup, so it never blocks and may be called from any thread. The owner
+// thread takes whatever the mailbox holds and applies it with one
+// PWM_setFrequency(), at most once per interval: a fast turn of the knob
+// that posts twenty values in 20 ms costs one or two bursts of sysfs
+// writes, and always ends on the last value posted. Values superseded
+// before they were applied are counted as coalesced.
+//
+// The owner is the reactor thread when Reactor_init() has been called
+// (a wakeup plus a one-shot timer for the rate limit), otherwise a thread
+// of its own (THREAD_PWM).
+//
+// Each request carries the time of the input that caused it (the encoder
+// edge, the UDP datagram); the time from the first such input to the PWM
+// write landing is observed in pwm_control_latency_seconds.
+
+#ifndef _PWM_CONTROL_H_
+#define _PWM_CONTROL_H_
+
+#include <stdbool.h>
+
+#define PWM_CONTROL_DEFAULT_INTERVAL_MS 20
+
+// Apply `hz`/`dutyPct` (or whatever was already posted) on the calling
+// thread, then hand the PWM to the owner, which writes at most once every
+// `minIntervalMs` (0: no limit). Returns false if the owner couldn't start;
+// the PWM then keeps its initial setting.
+bool PwmControl_start(int hz, int dutyPct, int minIntervalMs);
+void PwmControl_stop(void);
+
+// Post a new frequency (1..PWM_MAX_HZ) or duty (0..100). `inputNs`
+// is getTimeInNs() when the input arrived (0: now). Returns false if out of
+// range. Thread-safe, non-blocking.
+bool PwmControl_requestFrequency(int hz, long long inputNs);
+bool PwmControl_requestDuty(int dutyPct, long long inputNs);
+
+// Values last written to the PWM.
+int PwmControl_getFrequency(void);
+int PwmControl_getDuty(void);
+
+#endif
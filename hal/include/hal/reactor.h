@@ -0,0 +1,80 @@
+// reactor.h
+// Single-threaded epoll event loop for everything except acquisition.
+//
+// Without a reactor every module runs its own thread: UDP blocks in
+// recvfrom(), the TCP server in its own epoll_wait(), the rotary encoder
+// polls every 2 ms and the main loop spins waiting for the next second.
+// When the application calls Reactor_init() first, those modules register
+// their file descriptors here instead and are all served from the one
+// thread that calls Reactor_run():
+//   - sockets and GPIO line-event fds      Reactor_addFd()
+//   - periodic / one-shot timers (timerfd) Reactor_addTimer(), Reactor_armTimer()
+//   - cross-thread wakeups (eventfd)       Reactor_addWakeup(), Reactor_wake()
+// The sampler keeps its dedicated thread.
+//
+// Handlers run on the reactor thread and must not block. Sources are added
+// and removed only before Reactor_run() or from a handler; Reactor_wake()
+// and Reactor_stop() may be called from any thread and from signal
+// handlers. Sources live in a fixed table, so nothing here allocates.
+//
+// Ownership: an fd passed to Reactor_addFd() stays the caller's, who
+// closes it after Reactor_removeFd(). Timer and wakeup fds are created by
+// the reactor and belong to it: Reactor_removeFd() and Reactor_cleanup()
+// close them, and callers must not.
+
+#ifndef _REACTOR_H_
+#define _REACTOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define REACTOR_MAX_SOURCES 16
+
+// Called with the fd that became ready and its epoll events.
+typedef void (*ReactorFdHandler)(int fd, uint32_t events, void *arg);
+
+// Called with the number of timer expirations (or eventfd counter value)
+// consumed since the last call.
+typedef void (*ReactorTickHandler)(uint64_t count, void *arg);
+
+// Create the epoll instance. Returns false on failure.
+bool Reactor_init(void);
+
+// True between Reactor_init() and Reactor_cleanup(); modules use this to
+// decide whether to attach here or start their own thread.
+bool Reactor_isActive(void);
+
+// Watch `fd` for `events` (EPOLLIN, ...). The caller keeps `fd`. Returns 0 or -1.
+int Reactor_addFd(int fd, uint32_t events, ReactorFdHandler handler, void *arg);
+
+// Stop watching `fd`. Closes it if it is a timer or wakeup fd (see
+// Ownership above); an fd from Reactor_addFd() is left open. Ignores
+// unknown fds.
+void Reactor_removeFd(int fd);
+
+// Create a timerfd firing every `periodNs` (first expiry after `periodNs`;
+// 0 makes a disarmed one-shot timer). Returns the timer fd or -1.
+int Reactor_addTimer(long long periodNs, ReactorTickHandler handler, void *arg);
+
+// Re-arm a timer: first expiry after `delayNs`, then every `periodNs`
+// (0 for one-shot). A delay of 0 disarms it.
+bool Reactor_armTimer(int timerFd, long long delayNs, long long periodNs);
+
+// Create an eventfd whose handler runs after Reactor_wake(). Returns the
+// eventfd or -1.
+int Reactor_addWakeup(ReactorTickHandler handler, void *arg);
+
+// Signal a wakeup eventfd. Async-signal-safe.
+void Reactor_wake(int wakeFd);
+
+// Dispatch events on the calling thread until Reactor_stop().
+void Reactor_run(void);
+
+// Make Reactor_run() return. Async-signal-safe.
+void Reactor_stop(void);
+
+// Unregister every source, closing the timer and wakeup fds, and close the
+// epoll instance. Fds from Reactor_addFd() are left open.
+void Reactor_cleanup(void);
+
+#endif
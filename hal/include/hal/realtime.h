@@ -0,0 +1,53 @@
+// realtime.h
+// Allocation-free, page-locked steady-state mode.
+//
+// In realtime mode the application preallocates every buffer during
+// start-up. Realtime_lockMemory() then stops glibc from returning memory to
+// the kernel, pre-faults a heap reserve and locks all current and future
+// pages (mlockall), and each HAL thread pre-faults its stack when it starts
+// (see ThreadConfig_applySelf). After Realtime_beginSteadyState() no heap
+// allocation is expected at all.
+//
+// Allocation check: Realtime_steadyStateAllocations() counts the heap
+// allocations made after Realtime_beginSteadyState() that the program
+// reports with Realtime_countAllocation(). The HAL leaves the allocator
+// alone; light_sampler hooks it in app/allocCounter.c, which also catches
+// the allocations libc makes for itself (fopen's FILE, stdio buffers,
+// getaddrinfo, ...). Other programs linking the HAL have no check.
+
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define REALTIME_STACK_PREFAULT   (64 * 1024)         // bytes per thread
+#define REALTIME_HEAP_PREFAULT    (8 * 1024 * 1024)   // heap reserve
+
+// Turn realtime mode on (before any HAL thread starts).
+void Realtime_enable(void);
+bool Realtime_isEnabled(void);
+
+// Keep freed heap in the process, pre-fault `heapBytes` of it and
+// mlockall(). Returns false if the lock was refused (e.g. RLIMIT_MEMLOCK);
+// the rest still applies.
+bool Realtime_lockMemory(size_t heapBytes);
+
+// Touch `bytes` of the calling thread's stack so it is resident.
+void Realtime_prefaultStack(size_t bytes);
+
+// Start counting allocations; everything after this is steady state.
+void Realtime_beginSteadyState(void);
+
+// Allocations (malloc/calloc/realloc) since Realtime_beginSteadyState().
+long long Realtime_steadyStateAllocations(void);
+
+// True if an allocator hook reports to Realtime_countAllocation().
+bool Realtime_allocCheckAvailable(void);
+
+// For the allocator hook: count one allocation (if in steady state), and
+// announce that allocations are being counted. Lock- and allocation-free.
+void Realtime_countAllocation(void);
+void Realtime_setAllocCheckAvailable(bool available);
+
+#endif
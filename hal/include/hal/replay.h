@@ -0,0 +1,60 @@
+// replay.h
+// Offline replay of sample streams through the dip detector.
+//
+// Feeds recorded or synthetic samples through the same averaging and dip
+// detection code as the live sampler (dipDetector.h), as fast as the CPU
+// allows: no ADC reads, no sleeps, no locks. Used to regression-test and
+// benchmark detector changes on a host machine with millions of samples.
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    size_t   count;
+    double  *volts;
+    int64_t *timestampNs;    // relative or absolute; only differences matter
+} ReplayData;
+
+typedef struct {
+    long long samples;
+    long long dips;
+    double    elapsedSec;     // wall time spent in the detector
+    double    samplesPerSec;  // replay throughput
+    int       numSeconds;     // of recorded time covered by the data
+    int      *dipsPerSecond;  // dips in each recorded second (malloc'd)
+    int      *samplesPerSecond;
+} ReplayResult;
+
+// Load samples from a flight recording (flightRecorder.h) or a text file.
+// Text lines are either "volts" or "time_s,volts[,...]" (recorder_dump CSV);
+// other lines (headers, comments) are skipped. Files without timestamps
+// are assumed to be sampled at `rateHz`.
+bool Replay_loadFile(const char *path, double rateHz, ReplayData *out);
+
+// Synthesize `seconds` of samples at `rateHz` of the LED flashing at
+// `ledHz` (50% duty) onto the sensor, with gaussian noise of `noiseV` volts.
+bool Replay_synthesize(double ledHz, double seconds, double rateHz,
+                       double noiseV, ReplayData *out);
+
+// Inject single-sample ADC dropouts (0 V) into `data`, each sample with
+// probability `probability`, as a bad SPI read would. Returns how many.
+long long Replay_addGlitches(ReplayData *data, double probability);
+
+void Replay_freeData(ReplayData *data);
+
+// Run `data` through a fresh dip detector. Fills `res`; release it with
+// Replay_freeResult().
+bool Replay_run(const ReplayData *data, ReplayResult *res);
+
+// As Replay_run(), with the sampler's median prefilter (medianFilter.h) of
+// `medianWidth` samples in front of the detector (0 = no prefilter).
+bool Replay_runFiltered(const ReplayData *data, int medianWidth,
+                        double medianThreshold, ReplayResult *res);
+
+void Replay_freeResult(ReplayResult *res);
+
+#endif
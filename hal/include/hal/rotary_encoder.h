@@ -12,12 +12,26 @@
 bool rotary_init(void);
 
 // Start the rotary encoder polling thread
-// This function creates a background thread that continuously monitors the encoder
+// This function creates a background thread that continuously monitors the encoder.
+// If Reactor_init() has been called, no thread is created: the reactor waits
+// on GPIO edge events instead (or polls from a 2 ms timer when simulated).
 void rotary_start(void);
 
+// Called with the new count whenever the encoder moves, on the thread that
+// monitors it (the rotary thread or the reactor). Set before rotary_start().
+// `stepNs` is when the step happened on the getTimeInNs() timeline (see
+// rotary_getLastStepNs()).
+typedef void (*RotaryListener)(int count, long long stepNs, void *arg);
+void rotary_setListener(RotaryListener fn, void *arg);
+
 // Get the current count from the rotary encoder
 // Returns the accumulated count (positive for clockwise, negative for counter-clockwise)
 int rotary_getCount(void);
 
+// Time of the last counted step (getTimeInNs() timeline, 0 if none yet).
+// With edge events this is the kernel's timestamp of the edge that made
+// the step; when polling, the time of the poll that saw it.
+long long rotary_getLastStepNs(void);
+
 // Clean up and release resources used by the rotary encoder
 void rotary_close(void);
\ No newline at end of file
@@ -0,0 +1,86 @@
+// sampleRing.h
+// Live sample ring in POSIX shared memory for local consumers.
+//
+// The sampler publishes every sample into a fixed-size ring in shared
+// memory. Other processes on the same machine (logger, local dashboard,
+// analysis tools) map it read-only and consume at full rate without any
+// syscall per sample and without adding load to the sampler thread.
+//
+// Each slot is guarded by its own sequence counter (a seqlock): the writer
+// makes it odd while the slot is being written and sets it to 2*index+2
+// when done. A reader copies the slot and checks the counter is unchanged
+// and matches the index it expected; otherwise the slot was overwritten
+// (the reader fell a whole ring behind) and the sample is counted as lost.
+// The writer never waits for readers.
+
+#ifndef _SAMPLE_RING_H_
+#define _SAMPLE_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define SAMPLE_RING_SHM_NAME  "/light_sampler_ring"
+#define SAMPLE_RING_MAGIC     0x4C535247u   // 'LSRG'
+#define SAMPLE_RING_VERSION   1
+#define SAMPLE_RING_CAPACITY  8192          // slots; must be a power of 2
+
+#define SAMPLE_RING_FLAG_DIP  0x1           // a dip was detected at this sample
+
+typedef struct {
+    _Atomic uint64_t seq;       // seqlock, see above
+    int64_t  timestampNs;       // CLOCK_MONOTONIC
+    double   volts;
+    uint32_t flags;
+    uint32_t reserved;
+} SampleRingSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slotSize;
+    _Atomic uint64_t head;      // number of samples ever published
+    SampleRingSlot slots[SAMPLE_RING_CAPACITY];
+} SampleRingShm;
+
+typedef struct {
+    uint64_t index;             // position in the stream since the writer started
+    int64_t  timestampNs;
+    double   volts;
+    uint32_t flags;
+} SampleRingEntry;
+
+// ---- Writer side (used by the sampler) ------------------------------------
+
+// Create (or recreate) the shared memory ring. Returns false if shared
+// memory is unavailable; SampleRing_publish() is then a no-op.
+bool SampleRing_create(void);
+
+// Publish one sample. Lock-free and syscall-free; safe to call from the
+// sampling loop. Only one thread may publish.
+void SampleRing_publish(int64_t timestampNs, double volts, uint32_t flags);
+
+// Unmap and remove the ring.
+void SampleRing_destroy(void);
+
+// ---- Reader side (other processes) ----------------------------------------
+
+typedef struct {
+    int fd;
+    const SampleRingShm *shm;
+    uint64_t next;              // next index this reader wants
+    uint64_t lost;              // samples overwritten before we got to them
+} SampleRingReader;
+
+// Map the ring read-only. The reader starts at the newest sample.
+bool SampleRing_openReader(SampleRingReader *r);
+
+// Copy up to `max` new samples into `out`, oldest first. Returns the number
+// copied (0 if nothing new). If the reader fell more than a ring behind it
+// skips ahead and adds the skipped samples to r->lost.
+int SampleRing_read(SampleRingReader *r, SampleRingEntry *out, int max);
+
+void SampleRing_closeReader(SampleRingReader *r);
+
+#endif
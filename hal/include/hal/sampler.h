@@ -27,6 +27,35 @@
 #include "hal/sampler.h"
 #include "hal/SPI.h"
 #include "hal/periodTimer.h"
+#include "hal/freqAnalyzer.h"
+#include "hal/windowStats.h"
+
+#define SAMPLER_MAX_STATS_WINDOWS 4
+
+// Set the sampling rate in Hz (default 1000, at most 15000). Must be called
+// before Sampler_init(). Returns false if the rate is out of range.
+bool Sampler_setSampleRate(int hz);
+
+// Set the sliding statistics windows in milliseconds (default 100, 1000 and
+// 10000; at most SAMPLER_MAX_STATS_WINDOWS). Must be called before
+// Sampler_init(). Returns false if the list is invalid.
+bool Sampler_setStatsWindows(const int *windowMs, int count);
+
+// Put a sliding-median prefilter of `width` samples (odd, 3..255; 0 = off)
+// in front of the dip detector to reject ADC glitches. With `threshold` > 0
+// only samples further than that from the median are replaced (Hampel-style).
+// Must be called before Sampler_init(). Returns false if invalid.
+bool Sampler_setPrefilter(int width, double threshold);
+
+// Filter and decimate the samples kept in the history (and so everything
+// served from it) with a FilterChain spec (see filterChain.h), or "off".
+// Dip detection, statistics and the shared-memory ring still see every raw
+// sample. May be called at any time, after Sampler_setSampleRate(). Returns
+// false and writes the reason to `err` if the spec is invalid.
+bool Sampler_setFilter(const char *spec, char *err, int errLen);
+
+// Describe the active history filter.
+void Sampler_describeFilter(char *buf, int len);
 
 // Begin/end the background thread which samples light levels.
 void Sampler_init(void);
@@ -48,6 +77,18 @@ int Sampler_getHistorySize(void);
 // Note: It provides both data and size to ensure consistency.
 double* Sampler_getHistory(int *size);
 
+// Copy up to `max` samples of the history into `dst` without allocating.
+// Returns the number copied.
+int Sampler_copyHistory(double *dst, int max);
+
+// Largest history Sampler_copyHistory() can return (valid after Sampler_init).
+int Sampler_getMaxHistorySize(void);
+
+// Get the sequence number of the current history snapshot. It changes every
+// time Sampler_moveCurrentDataToHistory() runs (it is never 0 once the first
+// second has completed), so callers can cache anything derived from a snapshot.
+unsigned long long Sampler_getHistorySeq(void);
+
 // Get statistics about the samples taken in the previous complete second.
 Period_statistics_t Sampler_getLastSecondStatistics(void);
 
@@ -60,4 +101,24 @@ long long Sampler_getNumSamplesTaken(void);
 // Get the number of dips detected in the previous complete second.
 int Sampler_getDipCount(void);
 
+// Tell the frequency analyzer what the LED is flashing at, so it can centre
+// its sliding bins there. Takes effect at the next second boundary.
+void Sampler_setLedFrequency(int hz);
+
+// Get the frequency estimate computed at the last second boundary.
+void Sampler_getFrequencyEstimate(FreqEstimate *out);
+
+// Copy up to `max` configured window lengths (ms) into `windowMs`.
+// Returns how many windows are configured.
+int Sampler_getStatsWindows(int *windowMs, int max);
+
+// Get mean/variance/min/max over the last `windowMs` milliseconds of
+// samples. Only configured windows are tracked; returns false otherwise.
+bool Sampler_getWindowStats(int windowMs, WindowStatsResult *out);
+
+// Process one light sample (volts) the way the sampler thread does.
+// Normally only the sampler thread calls this; it is exposed so benchmarks
+// can drive the per-sample path without an ADC.
+void Sampler_recordSample(double volts);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+// simulation.h
+// Host simulation backend for the HAL.
+//
+// When enabled (at run time, before any HAL module is initialized) the HAL
+// stops touching /dev/spidev0.0, /dev/gpiochip2 and /dev/hat/pwm:
+//   - SPI:    Read_ADC_Values() returns a simulated light level. The LED is
+//             modelled as aimed at the sensor (an optical loop): while the
+//             simulated PWM output is high the level rises by `led` volts,
+//             so the frequency set with PWM_setFrequency() produces dips.
+//             An extra waveform and gaussian noise can be added on top.
+//   - PWM:    period/duty/enable are kept in memory.
+//   - Rotary: A/B transitions follow a script of detent moves.
+// The whole light_sampler binary can then run and be load-tested on a
+// Linux host.
+//
+// Configuration is a comma-separated key=value list, e.g.
+//   "ambient=1.2,led=0.6,noise=0.01,wave=sine,wave_hz=3,wave_amp=0.1,
+//    rotary=+10@2;-5@8,glitch=0.001"
+//   ambient   light level with the LED off (V)                 [1.2]
+//   led       extra level while the LED is on (V)              [0.6]
+//   noise     gaussian noise, standard deviation (V)           [0.005]
+//   wave      none | sine | square  extra ambient waveform     [none]
+//   wave_hz   waveform frequency (Hz)                          [1]
+//   wave_amp  waveform amplitude (V)                           [0]
+//   glitch    probability per sample of a single-sample dropout [0]
+//   lag_us    optical/ADC delay from a PWM change to sensor (us) [0]
+//   rotary    detent moves "+N@T;-M@T2" (T in seconds after start)
+
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include <stdbool.h>
+
+// Enable the simulation backend with the given configuration (NULL or ""
+// for defaults). Returns false (and stays disabled) on a bad spec.
+bool Sim_enable(const char *spec);
+
+// True once Sim_enable() succeeded.
+bool Sim_isEnabled(void);
+
+// ---- Hooks used by the HAL modules ----------------------------------------
+
+// Simulated 12-bit ADC reading for `channel` (0..4095).
+int Sim_readAdc(int channel);
+
+// Simulated PWM sysfs attributes (nanoseconds / enable flag).
+void Sim_pwmSetDutyCycle(long long ns);
+void Sim_pwmSetPeriod(long long ns);
+void Sim_pwmSetEnable(bool enabled);
+
+// Is the simulated LED lit at monotonic time `timeNs`?
+bool Sim_ledIsOn(long long timeNs);
+
+// Current A/B level of the simulated rotary encoder as a 2-bit value (A<<1|B),
+// already decoded for active-low. Each call advances at most one Gray-code
+// step toward the scripted position, like a real knob seen by a poller.
+int Sim_readRotaryAB(void);
+
+#endif
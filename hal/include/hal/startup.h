@@ -0,0 +1,55 @@
+// startup.h
+// Start-up helpers: run independent initialization steps concurrently,
+// time every step, and wait for device files without sleep loops.
+//
+// Each step is a function returning false on failure. Startup_run() runs
+// one on the calling thread; Startup_runParallel() runs a group of steps
+// that don't depend on each other, one thread each, and returns once all
+// are done. Both record when each step started and how long it took, and
+// Startup_report() prints the breakdown:
+//   Startup took 41.3 ms
+//     pwm          0.0 ms +  38.9 ms
+//     rotary       0.0 ms +   0.4 ms
+//     sampler      0.0 ms +   6.2 ms
+//     network     39.0 ms +   2.3 ms
+// Steps of a parallel group share a start, so the total is the longest
+// step of each group rather than the sum.
+//
+// Steps must not touch the reactor when run in parallel: its sources may
+// only be added from one thread.
+
+#ifndef _STARTUP_H_
+#define _STARTUP_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define STARTUP_MAX_STEPS  16
+#define STARTUP_RECHECK_MS 50
+
+typedef bool (*StartupFn)(void *arg);
+
+typedef struct {
+    const char *name;      // shown in the report; keep it short
+    StartupFn   fn;
+    void       *arg;
+} StartupStep;
+
+// Run one step on the calling thread and record it. Returns its result.
+bool Startup_run(const char *name, StartupFn fn, void *arg);
+
+// Run `n` steps concurrently (the caller runs the first) and wait for all
+// of them. Returns true if every step succeeded.
+bool Startup_runParallel(const StartupStep *steps, int n);
+
+// Print every recorded step: start offset, duration, and FAILED if it did.
+void Startup_report(FILE *out);
+
+// Wait until `path` exists, for at most `timeoutMs`. Uses inotify on the
+// deepest directory of the path that already exists, so it returns as soon
+// as the entry appears. sysfs raises no events for entries the kernel
+// creates, so the path is also re-checked every STARTUP_RECHECK_MS.
+// Returns false on timeout.
+bool Startup_waitForPath(const char *path, int timeoutMs);
+
+#endif
@@ -0,0 +1,40 @@
+// statusWriter.h
+// Asynchronous console output for the once-a-second status lines.
+//
+// A slow terminal (serial console, ssh over a bad link) makes printf()
+// block, and the thread that prints the status also drives PWM updates.
+// Instead, the status is formatted into one of a fixed set of preallocated
+// line slots and handed to a low-priority writer thread (THREAD_CONSOLE,
+// SCHED_IDLE by default) through a single-producer, single-consumer
+// lock-free queue. When the writer falls behind and every slot is full, the
+// next line is dropped whole and counted, so the producer never waits.
+//
+// Only one thread may build and commit lines. Before StatusWriter_start()
+// (and after StatusWriter_stop()) committed lines are written directly.
+
+#ifndef _STATUS_WRITER_H_
+#define _STATUS_WRITER_H_
+
+#include <stdbool.h>
+
+#define STATUS_LINE_MAX   2048   // bytes per queued entry (may hold several lines)
+#define STATUS_QUEUE_LEN  16     // entries the writer can fall behind by
+
+// Start the writer thread on `fd` (e.g. STDOUT_FILENO). Returns false if
+// the thread could not be started; output is then written directly.
+bool StatusWriter_start(int fd);
+
+// Write out everything queued and stop the thread.
+void StatusWriter_stop(void);
+
+// Append to the entry being built (truncated at STATUS_LINE_MAX).
+void StatusWriter_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Queue the entry built so far. Returns false if it was dropped because the
+// queue was full.
+bool StatusWriter_commit(void);
+
+// Entries dropped so far.
+long long StatusWriter_dropped(void);
+
+#endif
@@ -0,0 +1,34 @@
+// tcpBulk.h
+// TCP bulk-transfer channel that runs next to the UDP command server.
+//
+// UDP history replies are a burst of unacknowledged datagrams, so large
+// replies can be lost or reordered without anyone noticing. This server
+// answers the same bulk commands over TCP instead:
+//   history      -- previous second as text ("1.234, 0.056, ..." 10 per line)
+//   history_bin  -- previous second as 'HBIN' + uint32 N + N uint16 mV
+//   help         -- list commands
+// Commands are newline terminated; any number may be pipelined.
+//
+// All clients are served from one epoll thread with non-blocking sockets;
+// when Reactor_init() has been called that epoll fd is registered with the
+// reactor instead and no thread is started (see tcpServer.h).
+// Replies are queued as references to the shared history cache and written
+// with gather writes; when a client's socket is full its queue stops
+// growing and the server stops reading its commands until it drains.
+
+#ifndef _TCP_BULK_H_
+#define _TCP_BULK_H_
+
+#include <stdint.h>
+#include "hal/UDP.h"
+
+#define TCP_BULK_DEFAULT_PORT 12346
+
+// Start the listener thread (or attach to the reactor). Only the history callbacks of `cb` are used.
+// Returns 0 on success, -1 on failure.
+int tcp_bulk_start(uint16_t port, UdpCallbacks cb);
+
+// Close every client and stop the thread. Safe to call if not running.
+void tcp_bulk_stop(void);
+
+#endif
@@ -0,0 +1,73 @@
+// tcpServer.h
+// Listening TCP socket served from one epoll instance, shared by the TCP
+// bulk channel (tcpBulk.h) and the metrics endpoint (metrics.h).
+//
+// The server owns the listen socket, the epoll fd and a wakeup eventfd, and
+// runs them either on a thread of its own or, when Reactor_init() has been
+// called, by registering its epoll fd with the reactor. The module using it
+// keeps its own connection table and supplies two callbacks:
+//   - onAccept: a new connection; take it with TcpServer_addClient() under
+//     a tag of your choice (e.g. the slot index) or refuse it
+//   - onEvents: epoll events for one of your connections, by tag
+// and adjusts or ends connections with TcpServer_setEvents() and
+// TcpServer_closeClient(). All callbacks run on the serving thread.
+
+#ifndef _TCP_SERVER_H_
+#define _TCP_SERVER_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal/threadConfig.h"
+
+#define TCP_SERVER_TAG_LISTEN  0xFFFFFFF0u   // tags from here up are the server's
+#define TCP_SERVER_TAG_WAKE    0xFFFFFFF1u
+
+typedef struct TcpServer TcpServer;
+
+typedef struct {
+    const char *name;       // prefix of error messages
+    HalThread   thread;     // settings for the serving thread
+    int         backlog;    // listen() backlog
+    // New connection `fd`: return true once it was taken with
+    // TcpServer_addClient(), false to have it closed.
+    bool (*onAccept)(TcpServer *s, int fd);
+    // EPOLLIN/EPOLLOUT/EPOLLERR/EPOLLHUP/EPOLLRDHUP for connection `tag`.
+    void (*onEvents)(TcpServer *s, uint32_t tag, uint32_t events);
+    // Serving has stopped and the sockets are about to close: drop every
+    // connection here. Only called if the server had started.
+    void (*onStop)(TcpServer *s);
+} TcpServerConfig;
+
+struct TcpServer {
+    TcpServerConfig cfg;
+    int             listenFd;
+    int             epollFd;
+    int             wakeFd;
+    pthread_t       thread;
+    atomic_bool     running;
+    bool            attached;       // served by the reactor, no thread
+};
+
+// Listen on `port` and start serving (thread or reactor). Returns 0, or -1
+// with everything closed again.
+int TcpServer_start(TcpServer *s, const TcpServerConfig *cfg, uint16_t port);
+
+bool TcpServer_isRunning(const TcpServer *s);
+
+// Stop serving, call onStop and close the sockets. Safe to call if not
+// running, or on a zeroed TcpServer.
+void TcpServer_stop(TcpServer *s);
+
+// Watch connection `fd` for input under `tag` (< TCP_SERVER_TAG_LISTEN).
+bool TcpServer_addClient(TcpServer *s, int fd, uint32_t tag);
+
+// Replace the events watched on a connection (EPOLLIN | EPOLLRDHUP, EPOLLOUT, ...).
+void TcpServer_setEvents(TcpServer *s, int fd, uint32_t tag, uint32_t events);
+
+// Stop watching a connection and close it.
+void TcpServer_closeClient(TcpServer *s, int fd);
+
+#endif
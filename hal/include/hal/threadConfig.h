@@ -0,0 +1,71 @@
+// threadConfig.h
+// Per-thread CPU affinity and scheduling policy for the HAL's threads.
+//
+// The application parses a spec once at start-up; each HAL thread then
+// calls ThreadConfig_applySelf() as its first action, which names the
+// thread and applies whatever was requested for it. Real-time policies and
+// affinity can be refused (no CAP_SYS_NICE, CPU offline, ...), so what was
+// actually applied is recorded per thread and printed when it differs from
+// the request.
+//
+// Spec: comma-separated "thread=setting[:setting...]", e.g.
+//   "sampler=cpu1:fifo80,rotary=fifo50,udp=cpu0,main=cpu0"
+//   threads:  sampler rotary udp tcp recorder main console metrics pwm
+//   settings: cpuN (pin to CPU N), fifoN / rrN (SCHED_FIFO / SCHED_RR at
+//             priority N, 1..99), other (SCHED_OTHER), idle (SCHED_IDLE)
+// Threads not named keep their defaults: any CPU and SCHED_OTHER, except
+// the console writer, which runs SCHED_IDLE.
+
+#ifndef _THREAD_CONFIG_H_
+#define _THREAD_CONFIG_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef enum {
+    THREAD_SAMPLER,
+    THREAD_ROTARY,
+    THREAD_UDP,
+    THREAD_TCP,
+    THREAD_RECORDER,
+    THREAD_MAIN,
+    THREAD_CONSOLE,
+    THREAD_METRICS,
+    THREAD_PWM,
+    THREAD_COUNT
+} HalThread;
+
+typedef struct {
+    int cpu;        // -1 = any CPU
+    int policy;     // SCHED_OTHER, SCHED_IDLE, SCHED_FIFO or SCHED_RR
+    int priority;   // 0 for SCHED_OTHER
+} ThreadSettings;
+
+typedef struct {
+    bool           started;     // the thread has called ThreadConfig_applySelf()
+    ThreadSettings requested;
+    ThreadSettings applied;     // what the kernel accepted
+    int            tid;         // kernel thread id
+} ThreadState;
+
+// Parse a spec (see above), replacing any previous one. Returns false and
+// leaves the configuration unchanged on error.
+bool ThreadConfig_parse(const char *spec);
+
+// Set the requested settings for one thread directly.
+void ThreadConfig_set(HalThread which, ThreadSettings settings);
+
+// Called by each HAL thread at start: names the calling thread, applies its
+// requested settings and records the outcome. Returns true if everything
+// requested was applied.
+bool ThreadConfig_applySelf(HalThread which);
+
+// Snapshot of one thread's state.
+ThreadState ThreadConfig_get(HalThread which);
+
+const char *ThreadConfig_name(HalThread which);
+
+// Print requested and applied settings for every started thread.
+void ThreadConfig_report(FILE *f);
+
+#endif
@@ -0,0 +1,55 @@
+// threadStats.h
+// Per-thread CPU time, context switches and run-queue latency of the named
+// HAL threads (the tids recorded by ThreadConfig_applySelf), read from
+//   /proc/self/task/TID/stat       user and system time
+//   /proc/self/task/TID/schedstat  time on CPU, time waiting to run, runs
+//   /proc/self/task/TID/status     voluntary / involuntary context switches
+//
+// A snapshot holds running totals; rates come from the difference of two
+// snapshots, so each consumer (the UDP "perf" command, the status line)
+// keeps its own previous snapshot and nothing is sampled in the background.
+// Reading uses plain open/read, no stdio, so it allocates nothing.
+
+#ifndef _THREAD_STATS_H_
+#define _THREAD_STATS_H_
+
+#include <stdbool.h>
+#include "hal/threadConfig.h"
+
+typedef struct {
+    bool valid;              // thread started and its /proc files were read
+    int tid;
+    long long userTicks;     // clock ticks (sysconf(_SC_CLK_TCK))
+    long long sysTicks;
+    long long cpuNs;         // schedstat; 0 where the kernel lacks schedstats
+    long long runDelayNs;    // runnable but waiting for a CPU
+    long long runs;          // times scheduled in
+    long long volSwitches;
+    long long involSwitches;
+} ThreadCounters;
+
+typedef struct {
+    long long timeNs;        // getTimeInNs() when taken
+    ThreadCounters t[THREAD_COUNT];
+} ThreadStatsSnapshot;
+
+typedef struct {
+    bool valid;              // present in both snapshots, same tid
+    double cpuPct;           // of one CPU
+    double userPct, sysPct;
+    double volPerSec, involPerSec;
+    double waitPct;          // of the interval spent runnable but not running
+    double avgWaitUs;        // per run
+} ThreadPerf;
+
+void ThreadStats_sample(ThreadStatsSnapshot *snap);
+
+// Rates for one thread between two snapshots.
+void ThreadStats_diff(const ThreadStatsSnapshot *prev, const ThreadStatsSnapshot *cur,
+                      HalThread which, ThreadPerf *out);
+
+// One table line per thread. Returns the length written.
+int ThreadStats_format(const ThreadStatsSnapshot *prev, const ThreadStatsSnapshot *cur,
+                       char *buf, int len);
+
+#endif
@@ -8,13 +8,43 @@
 #include <stdlib.h>  // exit, EXIT_FAILURE, EXIT_SUCCESS
 #include <stdbool.h>
 #include <time.h>
+#include <stdint.h>
 
-// Get the current time in milliseconds
+// Clock behind getTimeInNs(). The cycle counter (CNTVCT on aarch64, the
+// invariant TSC on x86) is read without a syscall or vDSO call and converted
+// to ns on the CLOCK_MONOTONIC timeline; CLOCK_MONOTONIC is the fallback.
+typedef enum {
+    TIMING_CLOCK_MONOTONIC,
+    TIMING_CLOCK_CYCLES
+} TimingClockSource;
+
+// Calibrate the cycle-counter clock. Called automatically on first use;
+// call it early to keep the ~20 ms x86 calibration off hot paths.
+// Threadsafe.
+void Timing_init(void);
+
+// Stop using the cycle counter (e.g. on VMs with an unreliable TSC).
+void Timing_useMonotonic(void);
+
+TimingClockSource Timing_getClockSource(void);
+const char* Timing_clockSourceName(void);
+
+// Raw cycle counter value (for benchmarks).
+uint64_t Timing_readCycles(void);
+
+// Get the current time in milliseconds (monotonic; for measuring intervals)
 long long getTimeInMs(void);
 
+// Get a monotonic timestamp in nanoseconds from the fastest calibrated clock.
+// Safe to call from any thread.
+long long getTimeInNs(void);
+
 // Sleep for the specified delay in milliseconds
 void sleepForMs(long long delayInMs);
 
+// Sleep for the specified delay in microseconds
+void sleepForUs(long long delayInUs);
+
 
 
 #endif
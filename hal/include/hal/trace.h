@@ -0,0 +1,43 @@
+// trace.h
+// Begin/end trace points kept in per-thread rings, dumped as Chrome trace
+// JSON (open in https://ui.perfetto.dev or chrome://tracing).
+//
+// Each thread that records an event claims one ring on its first event and
+// is its only writer: an event is a cycle-counter read (getTimeInNs) and
+// two stores plus a release of the ring's head, with no locks or syscalls. Rings overwrite
+// their oldest events, so a dump shows the last few seconds before it was
+// requested. Trace_dump() may run on any thread while the others keep
+// recording; events overwritten while it reads are skipped.
+//
+// Tracing is off until Trace_enable(); then every Trace_begin()/Trace_end()
+// is a single branch. Names must be string literals (only the pointer is
+// stored).
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdbool.h>
+
+#define TRACE_MAX_THREADS        16
+#define TRACE_DEFAULT_EVENTS     16384   // per thread; rounded up to a power of two
+#define TRACE_DEFAULT_PATH       "light_sampler.trace.json"
+
+// Reserve (and pre-fault) the rings and start recording. `path` is where
+// Trace_dump(NULL) writes. Call before the HAL threads start.
+bool Trace_enable(unsigned eventsPerThread, const char *path);
+bool Trace_isEnabled(void);
+
+void Trace_begin(const char *name);
+void Trace_end(const char *name);
+
+// Write every ring's events to `path` (NULL: the path given to
+// Trace_enable). Returns the number of events written, or -1 on error.
+long Trace_dump(const char *path);
+
+// Path used by Trace_dump(NULL).
+const char* Trace_defaultPath(void);
+
+// Release the rings; only once no thread records any more.
+void Trace_cleanup(void);
+
+#endif
@@ -0,0 +1,93 @@
+// uring.h
+// Minimal io_uring wrapper (raw syscalls, no liburing) and the global switch
+// for the optional io_uring I/O backend.
+//
+// With Uring_enable() (light_sampler --io-uring) modules that support it
+// set up their own ring when they start:
+//   - UDP.c: one multishot recvmsg for the command socket, receiving into a
+//     provided buffer ring, and history replies submitted as one batch of
+//     sendmsg operations on a registered socket.
+//   - PWM.c: duty=0 / period / duty / enable written as one linked chain
+//     from a registered buffer to registered sysfs fds.
+// Any step that fails (no io_uring in the kernel, seccomp, an op the kernel
+// doesn't know) leaves that module on its normal syscalls. SPI stays on
+// ioctl(): spidev has no io_uring command interface.
+//
+// A ring is used by one thread at a time; nothing here locks.
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+typedef struct {
+    int fd;
+    // submission queue
+    void *sqRing;
+    size_t sqRingSize;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned sqEntries;
+    unsigned sqLocalTail;          // SQEs handed out but not yet published
+    // completion queue (shares sqRing when the kernel allows)
+    void *cqRing;
+    size_t cqRingSize;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_cqe *cqes;
+    long long enterCalls;          // io_uring_enter() syscalls made
+} Uring;
+
+// Kernel-shared ring of buffers that multishot receives pick from.
+typedef struct {
+    struct io_uring_buf_ring *ring;
+    size_t ringSize;
+    char *base;
+    size_t baseSize;
+    unsigned count;                // power of two
+    unsigned bufSize;
+    uint16_t group;
+} UringBufRing;
+
+// Opt in to the io_uring backend (before the modules start).
+void Uring_enable(void);
+bool Uring_isEnabled(void);
+
+// Create a ring with `entries` submission slots and room for `cqEntries`
+// completions (0: the kernel default of 2 x entries). Returns false (with
+// errno set) if io_uring is unavailable.
+bool Uring_init(Uring *r, unsigned entries, unsigned cqEntries);
+void Uring_cleanup(Uring *r);
+
+// Next free submission slot, zeroed, or NULL if the queue is full.
+struct io_uring_sqe* Uring_getSqe(Uring *r);
+
+// Publish the prepared SQEs and enter the kernel once, waiting for at least
+// `waitFor` completions. Returns the number submitted or -errno. Only that
+// many will complete: SQEs the kernel did not take are dropped from the
+// queue, and the wait is skipped when it took fewer than were queued.
+int Uring_submit(Uring *r, unsigned waitFor);
+
+// Oldest unconsumed completion, or NULL. Uring_cqeSeen() consumes it.
+struct io_uring_cqe* Uring_peekCqe(Uring *r);
+void Uring_cqeSeen(Uring *r);
+
+// Register fds (used with IOSQE_FIXED_FILE, by index) and buffers (used by
+// the *_FIXED ops, by index). Return 0 or -errno.
+int Uring_registerFiles(Uring *r, const int *fds, unsigned count);
+int Uring_registerBuffers(Uring *r, const struct iovec *iov, unsigned count);
+
+// Create and register `count` buffers of `bufSize` bytes as buffer group
+// `group`. Returns false if the kernel lacks provided buffer rings.
+bool Uring_setupBufRing(Uring *r, UringBufRing *br, uint16_t group,
+                        unsigned count, unsigned bufSize);
+void Uring_freeBufRing(Uring *r, UringBufRing *br);
+
+// Address of buffer `bid`, and hand it back to the kernel once consumed.
+void* Uring_bufAddr(const UringBufRing *br, uint16_t bid);
+void Uring_recycleBuf(UringBufRing *br, uint16_t bid);
+
+#endif
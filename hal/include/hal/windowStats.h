@@ -0,0 +1,43 @@
+// windowStats.h
+// Sliding-window statistics of the light level: mean, variance, min and max
+// over the last N samples, updated in amortized O(1) per sample.
+//
+// Mean and variance come from running sums that are recomputed exactly once
+// per window length (so rounding error cannot build up); min and max come
+// from monotonic deques of sample indices, so no rescan is ever needed.
+
+#ifndef _WINDOW_STATS_H_
+#define _WINDOW_STATS_H_
+
+#include <stdbool.h>
+
+typedef struct {
+    int    count;       // samples in the window (less than full at startup)
+    double mean;        // volts
+    double variance;    // volts^2 (population)
+    double min;
+    double max;
+} WindowStatsResult;
+
+typedef struct {
+    int        len;         // window length in samples
+    double    *values;      // circular buffer, indexed by sample number % len
+    long long  n;           // samples fed so far
+    double     sum, sumSq;  // over the samples in the window
+    int        sinceRecompute;
+    long long *minQ, *maxQ; // deques of sample numbers (capacity len)
+    int        minHead, minCount;
+    int        maxHead, maxCount;
+} WindowStats;
+
+// Allocate a window of `len` samples. Returns false on failure.
+bool WindowStats_init(WindowStats *ws, int len);
+void WindowStats_cleanup(WindowStats *ws);
+
+// Add one sample.
+void WindowStats_feed(WindowStats *ws, double volts);
+
+// Statistics of the current window (all zero if empty).
+void WindowStats_get(const WindowStats *ws, WindowStatsResult *out);
+
+#endif
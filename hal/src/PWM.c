@@ -1,53 +1,220 @@
-#include <stdio.h> // fopen, fprintf, fclose, perror
+#include <stdio.h> // fprintf, perror
 #include <stdlib.h>  // exit, EXIT_FAILURE, EXIT_SUCCESS
 #include <stdbool.h>
 #include <time.h>
 #include "hal/timing.h"
 #include "hal/PWM.h"
+#include "hal/simulation.h"
+#include "hal/uring.h"
+#include "hal/trace.h"
+#include "hal/metrics.h"
+#include "hal/startup.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 //#define DEBUG 
 
 #define NANOSECONDS_IN_SECOND 1000000000
+#define PWM_PATH_MAX 256
+#define PWM_EXPORT_TIMEOUT_MS 2000
 
-// Helper function to write to a file
-bool PWM_export(void){
+extern char **environ;
+
+static char s_dutyCycleFile[PWM_PATH_MAX] = PWM_DUTY_CYCLE_FILE;
+static char s_periodFile[PWM_PATH_MAX] = PWM_PERIOD_FILE;
+static char s_enableFile[PWM_PATH_MAX] = PWM_ENABLE_FILE;
+
+// The three files stay open from PWM_export() on, in this order, so an
+// update is a few write() calls from a stack buffer: no stdio, no heap.
+// Before PWM_export() (or if an open failed) each write opens the file.
+enum { FD_DUTY, FD_PERIOD, FD_ENABLE, NUM_FDS };
+static int s_fds[NUM_FDS] = { -1, -1, -1 };
+
+static const char* file_path(int which)
+{
+    return which == FD_DUTY ? s_dutyCycleFile : which == FD_PERIOD ? s_periodFile : s_enableFile;
+}
+
+static void close_files(void)
+{
+    for (int i = 0; i < NUM_FDS; i++) {
+        if (s_fds[i] >= 0) close(s_fds[i]);
+        s_fds[i] = -1;
+    }
+}
+
+static void open_files(void)
+{
+    for (int i = 0; i < NUM_FDS; i++) {
+        if (s_fds[i] >= 0) continue;
+        s_fds[i] = open(file_path(i), O_WRONLY | O_CLOEXEC);
+        if (s_fds[i] < 0) {
+            fprintf(stderr, "PWM: cannot open '%s': %s\n", file_path(i), strerror(errno));
+        }
+    }
+}
+
+// io_uring backend (see uring.h): the open files are registered in the
+// order above and PWM_setFrequency() writes from one registered buffer.
+#define CHAIN_LEN 4
+static Uring s_ring;
+static bool s_useRing = false;
+static char s_chainText[CHAIN_LEN][24];
+
+static void close_ring(void)
+{
+    if (s_ring.sqRing) Uring_cleanup(&s_ring);   // never opened: all zero
+    s_useRing = false;
+}
+
+static void open_ring(void)
+{
+    if (s_useRing) return;
+    for (int i = 0; i < NUM_FDS; i++) {
+        if (s_fds[i] < 0) return;
+    }
+    struct iovec iov = { .iov_base = s_chainText, .iov_len = sizeof(s_chainText) };
+    if (!Uring_init(&s_ring, CHAIN_LEN, 0) ||
+        Uring_registerFiles(&s_ring, s_fds, NUM_FDS) < 0 ||
+        Uring_registerBuffers(&s_ring, &iov, 1) < 0) {
+        close_ring();
+        fprintf(stderr, "PWM: io_uring unavailable, using file writes\n");
+        return;
+    }
+    s_useRing = true;
+}
+
+// duty=0, period, duty, enable=1 as one linked chain in a single syscall; a
+// failed write cancels the rest, like the early returns of the file path.
+static bool write_chain(unsigned long long period, unsigned long long duty)
+{
+    static const int target[CHAIN_LEN] = { FD_DUTY, FD_PERIOD, FD_DUTY, FD_ENABLE };
+    snprintf(s_chainText[0], sizeof(s_chainText[0]), "0");
+    snprintf(s_chainText[1], sizeof(s_chainText[1]), "%llu", period);
+    snprintf(s_chainText[2], sizeof(s_chainText[2]), "%llu", duty);
+    snprintf(s_chainText[3], sizeof(s_chainText[3]), "1");
+
+    for (int i = 0; i < CHAIN_LEN; i++) {
+        struct io_uring_sqe *sqe = Uring_getSqe(&s_ring);
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = target[i];
+        sqe->flags = IOSQE_FIXED_FILE | (i + 1 < CHAIN_LEN ? IOSQE_IO_LINK : 0);
+        sqe->addr = (uintptr_t)s_chainText[i];
+        sqe->len = (unsigned)strlen(s_chainText[i]);
+        sqe->off = 0;
+        sqe->buf_index = 0;
+        sqe->user_data = (uint64_t)i;
+    }
+    // Only the writes the kernel took complete (Uring_submit() drops the rest)
+    int submitted = Uring_submit(&s_ring, CHAIN_LEN);
+    if (submitted <= 0) return false;
+
+    bool ok = submitted == CHAIN_LEN;
+    for (int done = 0; done < submitted; ) {
+        struct io_uring_cqe *cqe = Uring_peekCqe(&s_ring);
+        if (!cqe) {
+            if (Uring_submit(&s_ring, 1) < 0) return false;
+            continue;
+        }
+        if (cqe->res < 0 && ok) {
+            fprintf(stderr, "PWM: write of '%s' failed: %s\n",
+                    s_chainText[cqe->user_data], strerror(-cqe->res));
+            ok = false;
+        }
+        Uring_cqeSeen(&s_ring);
+        done++;
+    }
+    return ok;
+}
+
+void PWM_setDirectory(const char *dir){
+    if (!dir) dir = PWM_DIR;
+    close_ring();   // reopened on the new files by PWM_export()
+    close_files();
+    snprintf(s_dutyCycleFile, sizeof(s_dutyCycleFile), "%s/duty_cycle", dir);
+    snprintf(s_periodFile, sizeof(s_periodFile), "%s/period", dir);
+    snprintf(s_enableFile, sizeof(s_enableFile), "%s/enable", dir);
+}
+
+static bool export_pwm(void){
     // If the PWM sysfs already exists, consider it exported.
-    if (access(PWM_ENABLE_FILE, F_OK) == 0) return true;
+    if (access(s_enableFile, F_OK) == 0) return true;
 
     // Try to export the PWM using helper tool. Do not call `sudo` here;
     // the caller should run the program with appropriate privileges.
-    int rc = system("beagle-pwm-export --pin GPIO15");
-    if (rc != 0) {
-        fprintf(stderr, "PWM_export: beagle-pwm-export failed (rc=%d)\n", rc);
+    // Spawned directly (searched in PATH), without a shell in between.
+    char *const argv[] = { "beagle-pwm-export", "--pin", "GPIO15", NULL };
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+    if (err != 0) {
+        fprintf(stderr, "PWM_export: cannot run %s: %s\n", argv[0], strerror(err));
         return false;
     }
-
-    // Wait briefly for sysfs entries to appear
-    for (int i = 0; i < 20; ++i) {
-        if (access(PWM_ENABLE_FILE, F_OK) == 0) return true;
-        usleep(100000); // 100 ms
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            perror("PWM_export: waitpid");
+            return false;
+        }
     }
-    fprintf(stderr, "PWM_export: timeout waiting for %s\n", PWM_ENABLE_FILE);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "PWM_export: %s failed (status %d)\n", argv[0], status);
+        return false;
+    }
+
+    // The entries can appear after the helper returns; wake as soon as they do
+    if (Startup_waitForPath(s_enableFile, PWM_EXPORT_TIMEOUT_MS)) return true;
+    fprintf(stderr, "PWM_export: timeout waiting for %s\n", s_enableFile);
     return false;
 }
-static bool writeToFile(const char* filename, const char* value) {
-    FILE* file = fopen(filename, "w");
-    if (file == NULL) {
-        fprintf(stderr, "Error opening file '%s': ", filename);
-        perror(NULL);
-        return false;
+
+// Helper function to write to a file
+static Metric *s_mWrites, *s_mWriteErrors, *s_mWriteSeconds;
+
+static void register_metrics(void)
+{
+    static const double bounds[] = { 5e-6, 20e-6, 50e-6, 100e-6, 250e-6, 500e-6, 1e-3, 5e-3, 20e-3 };
+    s_mWrites = Metrics_counter("pwm_writes_total", "PWM frequency/duty updates.");
+    s_mWriteErrors = Metrics_counter("pwm_write_errors_total", "PWM updates that failed.");
+    s_mWriteSeconds = Metrics_histogram("pwm_write_seconds", "Time to apply one PWM update.",
+                                        bounds, (int)(sizeof(bounds) / sizeof(bounds[0])));
+}
+
+bool PWM_export(void){
+    register_metrics();
+    // Simulated PWM keeps its state in memory; nothing to export
+    if (Sim_isEnabled()) return true;
+
+    if (!export_pwm()) return false;
+    open_files();
+    if (Uring_isEnabled()) open_ring();
+    return true;
+}
+// Write `value` to one of the PWM files, from offset 0 like a fresh open
+static bool writeToFile(int which, const char* value) {
+    int fd = s_fds[which];
+    bool transient = fd < 0;
+    if (transient) {
+        fd = open(file_path(which), O_WRONLY | O_CLOEXEC);
+        if (fd < 0) {
+            fprintf(stderr, "Error opening file '%s': %s\n", file_path(which), strerror(errno));
+            return false;
+        }
     }
-    
-    if (fprintf(file, "%s", value) < 0) {
-        fprintf(stderr, "Error writing to file '%s': ", filename);
-        perror(NULL);
-        fclose(file);
-        return false;
+
+    size_t len = strlen(value);
+    ssize_t n = pwrite(fd, value, len, 0);
+    if (n != (ssize_t)len) {
+        fprintf(stderr, "Error writing to file '%s': %s\n", file_path(which),
+                n < 0 ? strerror(errno) : "short write");
     }
-    
-    fclose(file);
-    return true;
+    if (transient) close(fd);
+    return n == (ssize_t)len;
 }
 
 // PWM helper Functions
@@ -55,24 +222,48 @@ bool PWM_setDutyCycle(int dutyCycle){
     #ifdef DEBUG
     printf("Setting duty cycle to %d\n", dutyCycle);
     #endif
-    writeToFile(PWM_DUTY_CYCLE_FILE, "0"); // --- IGNORE ---
+    if (Sim_isEnabled()) {
+        Sim_pwmSetDutyCycle(dutyCycle);
+        return true;
+    }
+    writeToFile(FD_DUTY, "0"); // --- IGNORE ---
     char buf[32];
     int n = snprintf(buf, sizeof(buf), "%d", dutyCycle);
     if (n < 0) return false;
-    return writeToFile(PWM_DUTY_CYCLE_FILE, buf);
+    return writeToFile(FD_DUTY, buf);
 }
 
 bool PWM_setPeriod(int period){
     #ifdef DEBUG
     printf("Setting period to %d\n", period);
     #endif
+    if (Sim_isEnabled()) {
+        Sim_pwmSetPeriod(period);
+        return true;
+    }
     char buf[32];
     int n = snprintf(buf, sizeof(buf), "%d", period);
     if (n < 0) return false;
-    return writeToFile(PWM_PERIOD_FILE, buf);
+    return writeToFile(FD_PERIOD, buf);
 }
 
 
+static bool write_period_and_duty(unsigned long long period_ull, unsigned long long duty_ull)
+{
+    if (s_useRing && !Sim_isEnabled()) return write_chain(period_ull, duty_ull);
+
+    if (!PWM_setDutyCycle(0)) return false;
+
+    // cast to int because your helpers take int; safe in our range
+    if (!PWM_setPeriod((int)period_ull)) return false;
+
+    if (!PWM_setDutyCycle((int)duty_ull)) return false;
+
+    // ensure enabled
+    PWM_enable();
+    return true;
+}
+
 bool PWM_setFrequency(int Hz, int dutyCyclePercent)
 {
     if (dutyCyclePercent < 0 || dutyCyclePercent > 100) {
@@ -81,8 +272,10 @@ bool PWM_setFrequency(int Hz, int dutyCyclePercent)
     }
 
     // Assignment spec: support 0..500 Hz
-    if (Hz < 0)   Hz = 0;
-    if (Hz > 500) Hz = 500;
+    if (Hz < 0 || Hz > PWM_MAX_HZ) {
+        fprintf(stderr, "PWM_setFrequency: %d Hz out of range 0..%d\n", Hz, PWM_MAX_HZ);
+        return false;
+    }
 
     if (Hz == 0) {
         // 0 Hz -> LED off / stop PWM
@@ -102,16 +295,14 @@ bool PWM_setFrequency(int Hz, int dutyCyclePercent)
     // 1) duty=0  (so period can shrink safely)
     // 2) period=new
     // 3) duty=desired
-    if (!PWM_setDutyCycle(0)) return false;
-
-    // cast to int because your helpers take int; safe in our range
-    if (!PWM_setPeriod((int)period_ull)) return false;
-
-    if (!PWM_setDutyCycle((int)duty_ull)) return false;
-
-    // ensure enabled
-    PWM_enable();
-    return true;
+    Trace_begin("pwm_write");
+    long long startNs = getTimeInNs();
+    bool ok = write_period_and_duty(period_ull, duty_ull);
+    Metrics_observe(s_mWriteSeconds, (getTimeInNs() - startNs) * 1e-9);
+    Trace_end("pwm_write");
+    Metrics_inc(s_mWrites);
+    if (!ok) Metrics_inc(s_mWriteErrors);
+    return ok;
 }
 /*ORIGINAL CODE
 bool PWM_setFrequency(int Hz, int dutyCyclePercent){
@@ -141,12 +332,20 @@ bool PWM_enable(){
     #ifdef DEBUG
     printf("Enabling PWM\n");
     #endif
-    return writeToFile(PWM_ENABLE_FILE, "1");
+    if (Sim_isEnabled()) {
+        Sim_pwmSetEnable(true);
+        return true;
+    }
+    return writeToFile(FD_ENABLE, "1");
 }
 
 bool PWM_disable(){
     #ifdef DEBUG
     printf("Disabling PWM\n");
     #endif
-    return writeToFile(PWM_ENABLE_FILE, "0");
+    if (Sim_isEnabled()) {
+        Sim_pwmSetEnable(false);
+        return true;
+    }
+    return writeToFile(FD_ENABLE, "0");
 }
\ No newline at end of file
@@ -6,11 +6,19 @@
 #include "hal/led.h"
 #include "hal/timing.h"
 #include "hal/SPI.h"
+#include "hal/simulation.h"
+#include "hal/trace.h"
 #include <stdio.h> // fopen, fprintf, fclose, perror
 #include <stdlib.h>  // exit, EXIT_FAILURE, EXIT_SUCCESS
 #include <stdbool.h>
 #include <time.h>
 
+static const char *s_devPath = SPI_DEV_PATH;
+
+void SPI_setDevicePath(const char *path) {
+    s_devPath = path ? path : SPI_DEV_PATH;
+}
+
 // from SPI guide
 static int read_ch(int fd, int ch, uint32_t speed_hz) {
     // fd is the file descriptor for the SPI device
@@ -40,8 +48,10 @@ static int read_ch(int fd, int ch, uint32_t speed_hz) {
 
 
 // from SPI guide
-int Read_ADC_Values(int channel) {
-    const char* dev = SPI_DEV_PATH;
+static int read_adc(int channel) {
+    if (Sim_isEnabled()) return Sim_readAdc(channel);
+
+    const char* dev = s_devPath;
     uint8_t mode = 0;       // SPI mode 0
     uint8_t bits = 8;
     uint32_t speed = 250000;
@@ -56,4 +66,11 @@ int Read_ADC_Values(int channel) {
 
     close(fd);
     return channelRead;
-}
\ No newline at end of file
+}
+
+int Read_ADC_Values(int channel) {
+    Trace_begin("adc");
+    int value = read_adc(channel);
+    Trace_end("adc");
+    return value;
+}
@@ -14,15 +14,29 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <math.h>
 
 #include "hal/UDP.h"
+#include "hal/historyCache.h"
+#include "hal/reactor.h"
+#include "hal/threadConfig.h"
+#include "hal/trace.h"
+#include "hal/metrics.h"
+#include "hal/overrun.h"
+#include "hal/threadStats.h"
+#include "hal/timing.h"
+#include "hal/uring.h"
 
 static int                g_sock = -1;
 static pthread_t          g_thread;
+static bool               g_attached = false;   // served by the reactor, no thread
 volatile bool      g_running = false;
 // streaming target state
 static volatile bool g_streaming = false;
@@ -31,6 +45,56 @@ static pthread_mutex_t g_stream_lock = PTHREAD_MUTEX_INITIALIZER;
 static UdpCallbacks       g_cb = {0};
 static char               g_last_cmd[64] = {0};
 
+// io_uring backend (see uring.h): the socket is registered in both rings
+#define RX_BUFS      64       // datagrams the kernel can hold for us at once
+#define RX_BUF_SIZE  2048
+#define TX_BATCH     64       // history packets per submission
+#define TAG_RECV     1
+#define TAG_WAKE     2
+static Uring         g_rx, g_tx;
+static UringBufRing  g_rxBufs;
+static bool          g_rxUring = false;
+static bool          g_txUring = false;
+static int           g_rxWakeFd = -1;    // udp_stop() wakes the thread's ring wait
+static struct msghdr g_rxMsg;            // multishot template: name length only
+static struct msghdr g_txMsg[TX_BATCH];
+static struct iovec  g_txIov[TX_BATCH];
+
+// Metrics: requests by command (first word; the last slot counts the rest)
+static const char *const g_cmdNames[] = {
+    "help", "count", "length", "dips", "history", "history_bin", "freq", "stats",
+    "filter", "trace", "overruns", "perf", "stream", "stop", "setfreq", "setduty", "unknown"
+};
+#define NUM_CMD_NAMES ((int)(sizeof(g_cmdNames) / sizeof(g_cmdNames[0])))
+static Metric *g_mRequests[NUM_CMD_NAMES];
+static Metric *g_mBytesSent;
+
+static void register_metrics(void)
+{
+    for (int i = 0; i < NUM_CMD_NAMES; i++) {
+        char name[METRICS_NAME_MAX];
+        snprintf(name, sizeof(name), "udp_requests_total{command=\"%s\"}", g_cmdNames[i]);
+        g_mRequests[i] = Metrics_counter(name, "UDP commands received, by command.");
+    }
+    g_mBytesSent = Metrics_counter("udp_bytes_sent_total", "Bytes sent in UDP replies.");
+}
+
+static void count_request(const char *s)
+{
+    size_t len = strcspn(s, " ");
+    int i = 0;
+    if (len == 1 && s[0] == '?') len = 0;   // same as help
+    else while (i < NUM_CMD_NAMES - 1 &&
+                (strlen(g_cmdNames[i]) != len || strncmp(s, g_cmdNames[i], len))) i++;
+    Metrics_inc(g_mRequests[i]);
+}
+
+static void send_counted(int sock, const void *buf, int len, const struct sockaddr_in *cli)
+{
+    ssize_t n = sendto(sock, buf, (size_t)len, 0, (const struct sockaddr*)cli, sizeof(*cli));
+    if (n > 0) Metrics_add(g_mBytesSent, (uint64_t)n);
+}
+
 static void send_text(int sock, const struct sockaddr_in* cli, const char* fmt, ...)
 {
     char buf[1400];
@@ -39,7 +103,7 @@ static void send_text(int sock, const struct sockaddr_in* cli, const char* fmt,
     va_end(ap);
     if (n < 0) return;
     if (n > (int)sizeof(buf)) n = (int)sizeof(buf);
-    sendto(sock, buf, n, 0, (const struct sockaddr*)cli, sizeof(*cli));
+    send_counted(sock, buf, n, cli);
 }
 
 static void send_help(int sock, const struct sockaddr_in* cli)
@@ -51,44 +115,421 @@ static void send_help(int sock, const struct sockaddr_in* cli)
         "dips        -- get the number of dips in the previously completed second.\n"
         "history     -- get all the samples in the previously completed second.\n"
         "history_bin -- get all the samples as compact binary (16-bit millivolts).\n"
+        "freq        -- get the measured LED flash frequency.\n"
+        "stats <win> -- get mean/stddev/min/max over a window, e.g. stats 100ms, stats 10s.\n"
+        "filter      -- show the history filter; filter <spec> sets it (e.g. decim=4,notch=60, or off).\n"
+        "perf        -- CPU, context switches and run-queue wait per thread since the last perf.\n"
+        "overruns    -- late/dropped samples, ADC failures, late seconds and timer overflows.\n"
+        "trace       -- write the recent trace events as Chrome trace JSON (needs --trace).\n"
         "stop        -- cause the server program to end.\n"
         "<enter>     -- repeat last command.\n";
-    sendto(sock, h, (int)strlen(h), 0, (const struct sockaddr*)cli, sizeof(*cli));
+    send_counted(sock, h, (int)strlen(h), cli);
+}
+
+// Send the blob's datagrams as linked sendmsg operations (so they go out in
+// order), up to TX_BATCH per io_uring_enter(), and wait for them to finish.
+static void send_packets_uring(const HistoryBlob *h, const struct sockaddr_in *cli)
+{
+    int start = 0;
+    for (int p = 0; p < h->numPkts; ) {
+        int batch = 0;
+        for (; p < h->numPkts && batch < TX_BATCH; p++, batch++) {
+            struct io_uring_sqe *sqe = Uring_getSqe(&g_tx);
+            if (!sqe) break;
+            int end = h->pktEnd[p];
+            g_txIov[batch].iov_base = h->data + start;
+            g_txIov[batch].iov_len = (size_t)(end - start);
+            memset(&g_txMsg[batch], 0, sizeof(g_txMsg[batch]));
+            g_txMsg[batch].msg_name = (void *)cli;
+            g_txMsg[batch].msg_namelen = sizeof(*cli);
+            g_txMsg[batch].msg_iov = &g_txIov[batch];
+            g_txMsg[batch].msg_iovlen = 1;
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = 0;                      // registered socket
+            sqe->flags = IOSQE_FIXED_FILE;
+            if (p + 1 < h->numPkts && batch + 1 < TX_BATCH) sqe->flags |= IOSQE_IO_LINK;
+            sqe->addr = (uintptr_t)&g_txMsg[batch];
+            sqe->len = 1;
+            start = end;
+        }
+        if (batch == 0) return;
+
+        // Wait only for what the kernel took; Uring_submit() dropped the rest
+        int rc = Uring_submit(&g_tx, (unsigned)batch);
+        int submitted = rc > 0 ? rc : 0;
+        int failed = batch - submitted;
+        for (int done = 0; done < submitted; ) {
+            struct io_uring_cqe *cqe = Uring_peekCqe(&g_tx);
+            if (!cqe) {
+                if (Uring_submit(&g_tx, 1) < 0) return;
+                continue;
+            }
+            if (cqe->res < 0) failed++;
+            else Metrics_add(g_mBytesSent, (uint64_t)cqe->res);
+            Uring_cqeSeen(&g_tx);
+            done++;
+        }
+        if (failed > 0) {
+            fprintf(stderr, "udp: %d of %d history packets not sent\n", failed, batch);
+            return;
+        }
+    }
 }
 
-// Pack history as "1.234, 0.056, ..." 10 per line; keep packets <1400B.
-static void send_history(int sock, const struct sockaddr_in* cli, double* hist, int N)
+// Send one encoded history blob as its precomputed datagrams. Encodings are
+// built once per second by the history cache, so this is pure sends.
+static void send_history(int sock, const struct sockaddr_in* cli, HistoryEncoding enc)
 {
-    const int MAX = 1400;
-    char pkt[MAX];
-    int pos = 0, on_line = 0;
-
-    for (int i = 0; i < N; i++) {
-        char one[32];
-        int len = snprintf(one, sizeof(one), "%.3f%s", hist[i], (on_line == 9 || i == N-1) ? "\n" : ", ");
-        if (len < 0) len = 0;
-
-        if (pos + len >= MAX) { // flush
-            sendto(sock, pkt, pos, 0, (const struct sockaddr*)cli, sizeof(*cli));
-            pos = 0;
+    const HistoryBlob *h = HistoryCache_get(enc);
+    if (!h) {
+        send_text(sock, cli, "(no history)\n");
+        return;
+    }
+    Trace_begin("udp_history");
+    if (g_txUring && sock == g_sock) {
+        send_packets_uring(h, cli);
+    } else {
+        int start = 0;
+        for (int p = 0; p < h->numPkts; p++) {
+            int end = h->pktEnd[p];
+            send_counted(sock, h->data + start, end - start, cli);
+            start = end;
         }
-        memcpy(pkt + pos, one, len);
-        pos += len;
+    }
+    Trace_end("udp_history");
+    HistoryCache_release(h);
+}
+
+// Parse a window length such as "100ms", "10s" or "250" (ms). Returns -1 on error.
+static int parse_window_ms(const char *arg)
+{
+    char *end;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || v <= 0) return -1;
+    if (!strcmp(end, "s")) v *= 1000;
+    else if (*end != '\0' && strcmp(end, "ms")) return -1;
+    return v > 3600 * 1000 ? -1 : (int)v;
+}
+
+static void send_stats(int sock, const struct sockaddr_in* cli, const char *arg)
+{
+    if (!g_cb.get_window_stats) {
+        send_text(sock, cli, "stats not supported\n");
+        return;
+    }
+    int ms = *arg ? parse_window_ms(arg) : 1000;
+    WindowStatsResult r;
+    if (ms > 0 && g_cb.get_window_stats(ms, &r)) {
+        send_text(sock, cli, "# Stats %dms: n %d  mean %.3fV  stddev %.4fV  min %.3fV  max %.3fV\n",
+                  ms, r.count, r.mean, sqrt(r.variance), r.min, r.max);
+        return;
+    }
 
-        on_line = (on_line + 1) % 10;
+    // List what is available
+    char list[128] = "";
+    int wins[8];
+    int n = g_cb.get_stats_windows ? g_cb.get_stats_windows(wins, 8) : 0;
+    for (int i = 0, len = 0; i < n && i < 8 && len < (int)sizeof(list); i++) {
+        len += snprintf(list + len, sizeof(list) - len, " %dms", wins[i]);
     }
-    if (pos > 0) {
-        sendto(sock, pkt, pos, 0, (const struct sockaddr*)cli, sizeof(*cli));
+    send_text(sock, cli, "No stats window '%s'; tracked:%s\n", arg, list);
+}
+
+static void handle_filter(int sock, const struct sockaddr_in* cli, const char *spec)
+{
+    if (!g_cb.describe_filter || (*spec && !g_cb.set_filter)) {
+        send_text(sock, cli, "filter not supported\n");
+        return;
+    }
+    char msg[160];
+    if (*spec && !g_cb.set_filter(spec, msg, sizeof(msg))) {
+        send_text(sock, cli, "FAIL filter: %s\n", msg);
+        return;
+    }
+    g_cb.describe_filter(msg, sizeof(msg));
+    send_text(sock, cli, "# Filter %s\n", msg);
+}
+
+// Write the trace rings to the file named at start-up (never a path from
+// the network).
+static void handle_trace(int sock, const struct sockaddr_in* cli)
+{
+    if (!Trace_isEnabled()) {
+        send_text(sock, cli, "trace not enabled (start with --trace)\n");
+        return;
+    }
+    long n = Trace_dump(NULL);
+    if (n < 0) send_text(sock, cli, "FAIL trace: could not write %s\n", Trace_defaultPath());
+    else send_text(sock, cli, "# Trace: %ld events written to %s\n", n, Trace_defaultPath());
+}
+
+// Count and time since the last occurrence of each overrun kind.
+static void send_overruns(int sock, const struct sockaddr_in* cli)
+{
+    char msg[512];
+    int len = snprintf(msg, sizeof(msg), "# Overruns:");
+    long long now = getTimeInNs();
+    for (int k = 0; k < OVERRUN_KIND_COUNT && len < (int)sizeof(msg); k++) {
+        OverrunInfo info = Overrun_get(k);
+        if (info.count > 0) {
+            len += snprintf(msg + len, sizeof(msg) - len, " %s %lld (last %.1fs ago)%s",
+                            Overrun_name(k), info.count, (now - info.lastNs) / 1e9,
+                            k + 1 < OVERRUN_KIND_COUNT ? "," : "");
+        } else {
+            len += snprintf(msg + len, sizeof(msg) - len, " %s 0%s", Overrun_name(k),
+                            k + 1 < OVERRUN_KIND_COUNT ? "," : "");
+        }
+    }
+    send_text(sock, cli, "%s\n", msg);
+}
+
+// Per-thread rates since the previous "perf" (the first one sets the baseline)
+static ThreadStatsSnapshot g_perfPrev;
+static bool g_perfHavePrev = false;
+
+static void send_perf(int sock, const struct sockaddr_in* cli)
+{
+    ThreadStatsSnapshot cur;
+    ThreadStats_sample(&cur);
+    if (!g_perfHavePrev) {
+        g_perfPrev = cur;
+        g_perfHavePrev = true;
+        send_text(sock, cli, "# Perf: baseline taken; send perf again for rates since now\n");
+        return;
     }
+    char table[1200];
+    ThreadStats_format(&g_perfPrev, &cur, table, sizeof(table));
+    send_text(sock, cli, "# Perf over %.1fs:\n%s", (cur.timeNs - g_perfPrev.timeNs) / 1e9, table);
+    g_perfPrev = cur;
+}
+
+// Run one received command. Returns false after "stop".
+static bool run_command(char *buf, struct sockaddr_in cli)
+{
+    // Trim CR/LF and leading/trailing spaces:
+    char* s = buf;
+    while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+    for (ssize_t i = (ssize_t)strlen(s)-1; i >= 0 && (s[i]=='\r'||s[i]=='\n'||s[i]==' '||s[i]=='\t'); --i) s[i] = '\0';
+
+    // Blank line → repeat last command (if any)
+    if (s[0] == '\0') {
+        if (g_last_cmd[0] == '\0') {
+            send_text(g_sock, &cli, "Unknown command (no previous).\n");
+            return true;
+        }
+        s = g_last_cmd;
+    } else {
+        // save as last command (lower-cased)
+        size_t L = strlen(s); if (L >= sizeof(g_last_cmd)) L = sizeof(g_last_cmd)-1;
+        for (size_t i = 0; i < L; i++) g_last_cmd[i] = (char)tolower((unsigned char)s[i]);
+        g_last_cmd[L] = '\0';
+        s = g_last_cmd;
+    }
+
+    count_request(s);
+
+    // Dispatch
+    if (!strcmp(s, "help") || !strcmp(s, "?")) {
+        send_help(g_sock, &cli);
+    } else if (!strcmp(s, "count")) {
+        long long c = g_cb.get_count ? g_cb.get_count() : 0;
+        send_text(g_sock, &cli, "# samples taken total: %lld\n", c);
+    } else if (!strcmp(s, "length")) {
+        int L = g_cb.get_history_size ? g_cb.get_history_size() : 0;
+        send_text(g_sock, &cli, "# samples taken last second: %d\n", L);
+    } else if (!strcmp(s, "dips")) {
+        int d = g_cb.get_dips ? g_cb.get_dips() : 0;
+        send_text(g_sock, &cli, "# Dips: %d\n", d);
+    } else if (!strcmp(s, "history")) {
+        send_history(g_sock, &cli, HISTORY_TEXT);
+    } else if (!strcmp(s, "history_bin")) {
+        send_history(g_sock, &cli, HISTORY_BIN);
+    } else if (!strcmp(s, "freq")) {
+        if (g_cb.get_frequency) {
+            FreqEstimate e;
+            g_cb.get_frequency(&e);
+            send_text(g_sock, &cli,
+                      "# Freq: commanded %d Hz, tracked %.2f Hz (%.3fV, x%.1f), fft %.2f Hz (%.3fV)\n",
+                      e.commandedHz, e.tracked.hz, e.tracked.volts, e.tracked.ratio,
+                      e.fft.hz, e.fft.volts);
+        } else {
+            send_text(g_sock, &cli, "freq not supported\n");
+        }
+    } else if (!strcmp(s, "stats") || !strncmp(s, "stats ", 6)) {
+        send_stats(g_sock, &cli, s[5] ? s + 6 : "");
+    } else if (!strcmp(s, "perf")) {
+        send_perf(g_sock, &cli);
+    } else if (!strcmp(s, "overruns")) {
+        send_overruns(g_sock, &cli);
+    } else if (!strcmp(s, "trace")) {
+        handle_trace(g_sock, &cli);
+    } else if (!strcmp(s, "filter") || !strncmp(s, "filter ", 7)) {
+        handle_filter(g_sock, &cli, s[6] ? s + 7 : "");
+    } else if (!strncmp(s, "stream ", 7)) {
+        // stream start|stop
+        char *arg = s + 7;
+        if (!strcmp(arg, "start")) {
+            // register this client as the streaming target
+            pthread_mutex_lock(&g_stream_lock);
+            g_stream_cli = cli;
+            g_streaming = true;
+            pthread_mutex_unlock(&g_stream_lock);
+            send_text(g_sock, &cli, "OK stream started\n");
+        } else if (!strcmp(arg, "stop")) {
+            pthread_mutex_lock(&g_stream_lock);
+            g_streaming = false;
+            pthread_mutex_unlock(&g_stream_lock);
+            send_text(g_sock, &cli, "OK stream stopped\n");
+        } else {
+            send_text(g_sock, &cli, "Unknown stream command\n");
+        }
+    } else if (!strcmp(s, "stop")) {
+        send_text(g_sock, &cli, "Program terminating.\n");
+        g_running = false; // tell main to shut down
+        return false;
+    } else if (!strncmp(s, "setfreq ", 8)) {
+        if (g_cb.set_frequency) {
+            int hz = atoi(s + 8);
+            bool ok = g_cb.set_frequency(hz);
+            send_text(g_sock, &cli, ok ? "OK setfreq %d\n" : "FAIL setfreq %d\n", hz);
+        } else {
+            send_text(g_sock, &cli, "setfreq not supported\n");
+        }
+    } else if (!strncmp(s, "setduty ", 8)) {
+        if (g_cb.set_duty) {
+            int pct = atoi(s + 8);
+            bool ok = g_cb.set_duty(pct);
+            send_text(g_sock, &cli, ok ? "OK setduty %d\n" : "FAIL setduty %d\n", pct);
+        } else {
+            send_text(g_sock, &cli, "setduty not supported\n");
+        }
+    } else {
+        send_text(g_sock, &cli, "Unknown command: %s\n", s);
+    }
+    return true;
+}
+
+static bool handle_datagram(char *buf, struct sockaddr_in cli)
+{
+    Trace_begin("udp_cmd");
+    bool keepGoing = run_command(buf, cli);
+    Trace_end("udp_cmd");
+    return keepGoing;
+}
+
+// Arm one multishot recvmsg: it keeps completing, one datagram per provided
+// buffer, until it runs out of buffers or fails.
+static bool arm_recv_uring(void)
+{
+    struct io_uring_sqe *sqe = Uring_getSqe(&g_rx);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = 0;                              // registered socket
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->addr = (uintptr_t)&g_rxMsg;
+    sqe->len = 1;
+    sqe->buf_group = g_rxBufs.group;
+    sqe->user_data = TAG_RECV;
+    return Uring_submit(&g_rx, 0) == 1;
+}
+
+// Threaded mode: a poll on an eventfd so udp_stop() can end the ring wait
+static bool arm_wake_uring(void)
+{
+    g_rxWakeFd = eventfd(0, EFD_CLOEXEC);
+    struct io_uring_sqe *sqe = g_rxWakeFd >= 0 ? Uring_getSqe(&g_rx) : NULL;
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = g_rxWakeFd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = TAG_WAKE;
+    return Uring_submit(&g_rx, 0) == 1;
+}
+
+static void stop_recv_uring(void)
+{
+    Uring_freeBufRing(&g_rx, &g_rxBufs);
+    Uring_cleanup(&g_rx);
+    if (g_rxWakeFd >= 0) { close(g_rxWakeFd); g_rxWakeFd = -1; }
+    g_rxUring = false;
+}
+
+// Run the commands of all completed receives. Returns false after "stop".
+// If the kernel refuses multishot receive, g_rxUring is cleared and the
+// caller goes back to recvfrom().
+static bool serve_recv_uring(void)
+{
+    bool rearm = false;
+    struct io_uring_cqe *cqe;
+    while ((cqe = Uring_peekCqe(&g_rx)) != NULL) {
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+        uint64_t tag = cqe->user_data;
+        Uring_cqeSeen(&g_rx);
+        if (tag == TAG_WAKE) continue;
+        if (!(flags & IORING_CQE_F_MORE)) rearm = true;
+
+        if (res < 0) {
+            if (res == -ENOBUFS) continue;    // re-armed once buffers are back
+            fprintf(stderr, "udp: io_uring receive failed (%s), using recvfrom\n",
+                    strerror(-res));
+            stop_recv_uring();
+            return true;
+        }
+        if (!(flags & IORING_CQE_F_BUFFER)) continue;
+
+        // Buffer layout: io_uring_recvmsg_out, source address, payload
+        uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+        const char *p = Uring_bufAddr(&g_rxBufs, bid);
+        size_t off = sizeof(struct io_uring_recvmsg_out) + g_rxMsg.msg_namelen;
+        size_t len = (size_t)res > off ? (size_t)res - off : 0;
+        char buf[RX_BUF_SIZE];
+        struct sockaddr_in cli;
+        memcpy(&cli, p + sizeof(struct io_uring_recvmsg_out), sizeof(cli));
+        memcpy(buf, p + off, len);
+        buf[len] = '\0';
+        Uring_recycleBuf(&g_rxBufs, bid);
+
+        if (!handle_datagram(buf, cli)) return false;
+    }
+    if (rearm && g_running && !arm_recv_uring()) stop_recv_uring();
+    return true;
+}
+
+static void start_uring(void)
+{
+    if (Uring_init(&g_tx, TX_BATCH, 0)) {
+        g_txUring = Uring_registerFiles(&g_tx, &g_sock, 1) == 0;
+        if (!g_txUring) Uring_cleanup(&g_tx);
+    }
+    // Twice as many completion slots as buffers, so multishot can't overflow
+    if (Uring_init(&g_rx, 8, 2 * RX_BUFS)) {
+        memset(&g_rxMsg, 0, sizeof(g_rxMsg));
+        g_rxMsg.msg_namelen = sizeof(struct sockaddr_in);
+        g_rxUring = Uring_registerFiles(&g_rx, &g_sock, 1) == 0 &&
+                    Uring_setupBufRing(&g_rx, &g_rxBufs, 0, RX_BUFS, RX_BUF_SIZE) &&
+                    (Reactor_isActive() || arm_wake_uring()) &&
+                    arm_recv_uring();
+        if (!g_rxUring) stop_recv_uring();
+    }
+    printf("UDP io_uring: multishot receive %s, batched sends %s\n",
+           g_rxUring ? "on" : "unavailable", g_txUring ? "on" : "unavailable");
 }
 
 static void* udp_thread(void* arg)
 {
     (void)arg;
+    ThreadConfig_applySelf(THREAD_UDP);
     struct sockaddr_in cli;
     socklen_t slen = sizeof(cli);
     char buf[2048];
 
+    while (g_running && g_rxUring) {
+        if (Uring_submit(&g_rx, 1) < 0) break;   // wait for a completion
+        if (!serve_recv_uring()) return NULL;
+    }
+
     while (g_running) {
         ssize_t n = recvfrom(g_sock, buf, sizeof(buf)-1, 0, (struct sockaddr*)&cli, &slen);
         if (n < 0) {
@@ -97,127 +538,49 @@ static void* udp_thread(void* arg)
             break;
         }
         buf[n] = '\0';
+        if (!handle_datagram(buf, cli)) break;
+    }
+    return NULL;
+}
 
-        // Trim CR/LF and leading/trailing spaces:
-        char* s = buf;
-        while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
-        for (ssize_t i = (ssize_t)strlen(s)-1; i >= 0 && (s[i]=='\r'||s[i]=='\n'||s[i]==' '||s[i]=='\t'); --i) s[i] = '\0';
+// Reactor mode: drain the non-blocking socket each time it becomes readable.
+static void udp_on_readable(int fd, uint32_t events, void *arg)
+{
+    (void)events; (void)arg;
+    struct sockaddr_in cli;
+    socklen_t slen = sizeof(cli);
+    char buf[2048];
 
-        // Blank line → repeat last command (if any)
-        if (s[0] == '\0') {
-            if (g_last_cmd[0] == '\0') {
-                send_text(g_sock, &cli, "Unknown command (no previous).\n");
-                continue;
-            }
-            s = g_last_cmd;
-        } else {
-            // save as last command (lower-cased)
-            size_t L = strlen(s); if (L >= sizeof(g_last_cmd)) L = sizeof(g_last_cmd)-1;
-            for (size_t i = 0; i < L; i++) g_last_cmd[i] = (char)tolower((unsigned char)s[i]);
-            g_last_cmd[L] = '\0';
-            s = g_last_cmd;
+    while (g_running) {
+        ssize_t n = recvfrom(fd, buf, sizeof(buf)-1, 0, (struct sockaddr*)&cli, &slen);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("recvfrom");
+            return;
         }
-
-        // Dispatch
-        if (!strcmp(s, "help") || !strcmp(s, "?")) {
-            send_help(g_sock, &cli);
-        } else if (!strcmp(s, "count")) {
-            long long c = g_cb.get_count ? g_cb.get_count() : 0;
-            send_text(g_sock, &cli, "# samples taken total: %lld\n", c);
-        } else if (!strcmp(s, "length")) {
-            int L = g_cb.get_history_size ? g_cb.get_history_size() : 0;
-            send_text(g_sock, &cli, "# samples taken last second: %d\n", L);
-        } else if (!strcmp(s, "dips")) {
-            int d = g_cb.get_dips ? g_cb.get_dips() : 0;
-            send_text(g_sock, &cli, "# Dips: %d\n", d);
-        } else if (!strcmp(s, "history")) {
-            int N = 0;
-            double* H = g_cb.get_history ? g_cb.get_history(&N) : NULL;
-            if (!H || N <= 0) {
-                send_text(g_sock, &cli, "(no history)\n");
-            } else {
-                send_history(g_sock, &cli, H, N);
-                free(H);
-            }
-        } else if (!strcmp(s, "history_bin")) {
-            // Send compact binary history: header (magic 'HBIN' + uint32 N) then
-            // N samples as uint16_t millivolts (network order). Chunk packets <1400 bytes.
-            int N = 0;
-            double* H = g_cb.get_history ? g_cb.get_history(&N) : NULL;
-            if (!H || N <= 0) {
-                send_text(g_sock, &cli, "(no history)\n");
-            } else {
-                const int MAX = 1400;
-                // send 8-byte header: magic + N
-                uint32_t magic = htonl(0x4842494E); // 'HBIN'
-                uint32_t n_n = htonl((uint32_t)N);
-                char hdr[8];
-                memcpy(hdr, &magic, 4);
-                memcpy(hdr+4, &n_n, 4);
-                sendto(g_sock, hdr, sizeof(hdr), 0, (const struct sockaddr*)&cli, sizeof(cli));
-
-                char pkt[MAX];
-                int pos = 0;
-                for (int i = 0; i < N; ++i) {
-                    // convert volts (double) to millivolts uint16_t
-                    double v = H[i];
-                    int mv = (int)(v * 1000.0 + 0.5);
-                    if (mv < 0) mv = 0;
-                    if (mv > 0xFFFF) mv = 0xFFFF;
-                    uint16_t w = htons((uint16_t)mv);
-                    if (pos + 2 > MAX) {
-                        sendto(g_sock, pkt, pos, 0, (const struct sockaddr*)&cli, sizeof(cli));
-                        pos = 0;
-                    }
-                    memcpy(pkt + pos, &w, 2);
-                    pos += 2;
-                }
-                if (pos > 0) sendto(g_sock, pkt, pos, 0, (const struct sockaddr*)&cli, sizeof(cli));
-                free(H);
-            }
-        } else if (!strncmp(s, "stream ", 7)) {
-            // stream start|stop
-            char *arg = s + 7;
-            if (!strcmp(arg, "start")) {
-                // register this client as the streaming target
-                pthread_mutex_lock(&g_stream_lock);
-                g_stream_cli = cli;
-                g_streaming = true;
-                pthread_mutex_unlock(&g_stream_lock);
-                send_text(g_sock, &cli, "OK stream started\n");
-            } else if (!strcmp(arg, "stop")) {
-                pthread_mutex_lock(&g_stream_lock);
-                g_streaming = false;
-                pthread_mutex_unlock(&g_stream_lock);
-                send_text(g_sock, &cli, "OK stream stopped\n");
-            } else {
-                send_text(g_sock, &cli, "Unknown stream command\n");
-            }
-        } else if (!strcmp(s, "stop")) {
-            send_text(g_sock, &cli, "Program terminating.\n");
-            g_running = false; // tell main to shut down
-            break;
-        } else if (!strncmp(s, "setfreq ", 8)) {
-            if (g_cb.set_frequency) {
-                int hz = atoi(s + 8);
-                bool ok = g_cb.set_frequency(hz);
-                send_text(g_sock, &cli, ok ? "OK setfreq %d\n" : "FAIL setfreq %d\n", hz);
-            } else {
-                send_text(g_sock, &cli, "setfreq not supported\n");
-            }
-        } else if (!strncmp(s, "setduty ", 8)) {
-            if (g_cb.set_duty) {
-                int pct = atoi(s + 8);
-                bool ok = g_cb.set_duty(pct);
-                send_text(g_sock, &cli, ok ? "OK setduty %d\n" : "FAIL setduty %d\n", pct);
-            } else {
-                send_text(g_sock, &cli, "setduty not supported\n");
-            }
-        } else {
-            send_text(g_sock, &cli, "Unknown command: %s\n", s);
+        buf[n] = '\0';
+        if (!handle_datagram(buf, cli)) {
+            Reactor_removeFd(fd);
+            Reactor_stop();   // "stop" ends the program
+            return;
         }
     }
-    return NULL;
+}
+
+// Reactor mode with io_uring: the ring's fd is readable when completions wait
+static void udp_on_ring(int fd, uint32_t events, void *arg)
+{
+    (void)events; (void)arg;
+    if (!serve_recv_uring()) {
+        Reactor_removeFd(fd);
+        Reactor_stop();   // "stop" ends the program
+        return;
+    }
+    if (!g_rxUring) {
+        // Fell back: wait on the socket itself from now on
+        Reactor_removeFd(fd);
+        Reactor_addFd(g_sock, EPOLLIN, udp_on_readable, NULL);
+    }
 }
 
 // Public API:
@@ -225,6 +588,8 @@ int udp_start(uint16_t port, UdpCallbacks cb)
 {
     if (g_running) return 0;
     g_cb = cb;
+    register_metrics();
+    HistoryCache_setSource(cb.get_history, cb.get_history_seq);
 
     g_sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (g_sock < 0) { perror("socket"); return -1; }
@@ -240,6 +605,19 @@ int udp_start(uint16_t port, UdpCallbacks cb)
     }
 
     g_running = true;
+    if (Uring_isEnabled()) start_uring();
+    if (Reactor_isActive()) {
+        g_attached = true;
+        int flags = fcntl(g_sock, F_GETFL, 0);
+        bool ok = fcntl(g_sock, F_SETFL, flags | O_NONBLOCK) == 0;
+        if (ok && g_rxUring) ok = Reactor_addFd(g_rx.fd, EPOLLIN, udp_on_ring, NULL) == 0;
+        else if (ok) ok = Reactor_addFd(g_sock, EPOLLIN, udp_on_readable, NULL) == 0;
+        if (!ok) {
+            perror("udp: reactor");
+            close(g_sock); g_sock = -1; g_running = false; g_attached = false; return -1;
+        }
+        return 0;
+    }
     if (pthread_create(&g_thread, NULL, udp_thread, NULL) != 0) {
         perror("pthread_create");
         close(g_sock); g_sock = -1; g_running = false; return -1;
@@ -249,12 +627,25 @@ int udp_start(uint16_t port, UdpCallbacks cb)
 
 void udp_stop(void)
 {
-    if (!g_running) return;
+    if (g_sock < 0) return;
     g_running = false;
-    shutdown(g_sock, SHUT_RDWR);
-    pthread_join(g_thread, NULL);
+    if (g_attached) {
+        if (g_rxUring) Reactor_removeFd(g_rx.fd);
+        Reactor_removeFd(g_sock);
+        g_attached = false;
+    } else {
+        shutdown(g_sock, SHUT_RDWR);
+        if (g_rxWakeFd >= 0) {
+            uint64_t one = 1;
+            if (write(g_rxWakeFd, &one, sizeof(one)) < 0) perror("udp: wake");
+        }
+        pthread_join(g_thread, NULL);
+    }
+    if (g_rxUring) stop_recv_uring();
+    if (g_txUring) { Uring_cleanup(&g_tx); g_txUring = false; }
     close(g_sock);
     g_sock = -1;
+    HistoryCache_cleanup();
 }
 
 void udp_send_stream_text(const char *fmt, ...)
@@ -272,7 +663,7 @@ void udp_send_stream_text(const char *fmt, ...)
     pthread_mutex_unlock(&g_stream_lock);
 
     if (!sendit) return;
-    sendto(g_sock, buf, n, 0, (const struct sockaddr*)&cli, sizeof(cli));
+    send_counted(g_sock, buf, n, &cli);
 }
 
 /* ------------------------- DEMO MAIN (remove in your app) ------------------ */
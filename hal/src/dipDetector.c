@@ -0,0 +1,35 @@
+// dipDetector.c
+// Light dip detector shared by the live sampler and offline replay.
+
+#include "hal/dipDetector.h"
+
+void DipDetector_init(DipDetector *d)
+{
+    d->avgExp = 0.0;
+    d->firstSample = true;
+    d->armed = true;
+}
+
+bool DipDetector_feed(DipDetector *d, double volts)
+{
+    bool dip = false;
+
+    // Detect a dip as a transition from above-average to below-average.
+    // Once a dip is reported the detector stays disarmed until the level
+    // recovers to within DIP_HYSTERESIS of the average, so multiple sampled
+    // points inside the same physical dip aren't counted more than once.
+    if (d->firstSample) {
+        d->avgExp = volts;
+        d->firstSample = false;
+        return false;
+    }
+    if (!d->armed && volts > (d->avgExp - DIP_HYSTERESIS)) {
+        d->armed = true;
+    } else if (d->armed && volts < (d->avgExp - DIP_THRESHOLD)) {
+        d->armed = false;
+        dip = true;
+    }
+
+    d->avgExp = DIP_AVG_WEIGHT * d->avgExp + (1.0 - DIP_AVG_WEIGHT) * volts;
+    return dip;
+}
@@ -0,0 +1,209 @@
+// filterChain.c
+// FIR decimator + biquad chain (see filterChain.h).
+
+#include "hal/filterChain.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Sum of a[i] * b[i]
+static double dot(const double *a, const double *b, int n)
+{
+    int i = 0;
+    double sum = 0;
+#if defined(__SSE2__)
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    sum = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float64x2_t acc0 = vdupq_n_f64(0), acc1 = vdupq_n_f64(0);
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(a + i), vld1q_f64(b + i));
+        acc1 = vfmaq_f64(acc1, vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+    }
+    sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+#endif
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+// Hamming-windowed sinc low-pass, unity gain at DC
+static void design_lowpass(FilterChain *fc)
+{
+    int n = fc->numTaps, mid = n / 2;
+    double fc_norm = fc->cutoffHz / fc->inputRateHz;   // cycles per sample
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        int k = i - mid;
+        double sinc = k == 0 ? 2 * fc_norm : sin(2 * M_PI * fc_norm * k) / (M_PI * k);
+        double win = 0.54 - 0.46 * cos(2 * M_PI * i / (n - 1));
+        fc->taps[i] = sinc * win;
+        sum += sinc * win;
+    }
+    for (int i = 0; i < n; i++) fc->taps[i] /= sum;
+}
+
+typedef enum { BQ_LOWPASS, BQ_HIGHPASS, BQ_NOTCH } BiquadType;
+
+static void design_biquad(Biquad *bq, BiquadType type, double hz, double q, double rate)
+{
+    double w0 = 2 * M_PI * hz / rate;
+    double cw = cos(w0), alpha = sin(w0) / (2 * q);
+    double b0, b1, b2, a0 = 1 + alpha, a1 = -2 * cw, a2 = 1 - alpha;
+    switch (type) {
+    case BQ_LOWPASS:  b0 = (1 - cw) / 2; b1 = 1 - cw;    b2 = b0; break;
+    case BQ_HIGHPASS: b0 = (1 + cw) / 2; b1 = -(1 + cw); b2 = b0; break;
+    default:          b0 = 1;            b1 = -2 * cw;   b2 = 1;  break;
+    }
+    *bq = (Biquad){ b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0, 0, 0 };
+}
+
+static bool fail(char *err, int errLen, const char *why)
+{
+    if (err && errLen > 0) snprintf(err, errLen, "%s", why);
+    return false;
+}
+
+bool FilterChain_init(FilterChain *fc, const char *spec, double inputRateHz,
+                      char *err, int errLen)
+{
+    memset(fc, 0, sizeof(*fc));
+    if (inputRateHz <= 0) return fail(err, errLen, "bad input rate");
+    if (strlen(spec) >= sizeof(fc->spec)) return fail(err, errLen, "spec too long");
+    snprintf(fc->spec, sizeof(fc->spec), "%s", spec);
+    fc->inputRateHz = inputRateHz;
+    fc->decim = 1;
+
+    // First pass: FIR settings; biquads are designed once the output rate is known
+    char buf[FILTER_SPEC_MAX];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    struct { BiquadType type; double hz, q; } sections[FILTER_MAX_BIQUADS];
+    double q = M_SQRT1_2;
+    for (char *save, *item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(item, '=');
+        if (!eq) return fail(err, errLen, "expected key=value");
+        *eq = '\0';
+        char *end;
+        double v = strtod(eq + 1, &end);
+        if (end == eq + 1 || *end != '\0' || v <= 0) return fail(err, errLen, "bad value");
+
+        if (!strcmp(item, "decim")) {
+            if (v > FILTER_MAX_DECIM || v != (int)v) return fail(err, errLen, "decim must be 1..32");
+            fc->decim = (int)v;
+        } else if (!strcmp(item, "taps")) {
+            if (v < 3 || v > FILTER_MAX_TAPS || (int)v % 2 == 0) {
+                return fail(err, errLen, "taps must be odd, 3..255");
+            }
+            fc->numTaps = (int)v;
+        } else if (!strcmp(item, "cutoff")) {
+            fc->cutoffHz = v;
+        } else if (!strcmp(item, "q")) {
+            q = v;
+        } else if (!strcmp(item, "lp") || !strcmp(item, "hp") || !strcmp(item, "notch")) {
+            if (fc->numBiquads == FILTER_MAX_BIQUADS) return fail(err, errLen, "too many biquads");
+            sections[fc->numBiquads].type = item[0] == 'l' ? BQ_LOWPASS
+                                          : item[0] == 'h' ? BQ_HIGHPASS : BQ_NOTCH;
+            sections[fc->numBiquads].hz = v;
+            sections[fc->numBiquads].q = q;
+            fc->numBiquads++;
+        } else {
+            return fail(err, errLen, "unknown filter setting");
+        }
+    }
+
+    double outRate = FilterChain_outputRate(fc);
+    if (fc->decim > 1 || fc->numTaps > 0 || fc->cutoffHz > 0) {
+        if (fc->numTaps == 0) {
+            fc->numTaps = 8 * fc->decim + 1;
+            if (fc->numTaps > FILTER_MAX_TAPS) fc->numTaps = FILTER_MAX_TAPS;
+        }
+        if (fc->cutoffHz == 0) fc->cutoffHz = 0.4 * outRate;
+        if (fc->cutoffHz >= inputRateHz / 2) return fail(err, errLen, "cutoff above Nyquist");
+        design_lowpass(fc);
+    }
+    for (int i = 0; i < fc->numBiquads; i++) {
+        if (sections[i].hz >= outRate / 2) return fail(err, errLen, "biquad above Nyquist");
+        design_biquad(&fc->biquads[i], sections[i].type, sections[i].hz, sections[i].q, outRate);
+    }
+    return true;
+}
+
+FilterChain *FilterChain_create(const char *spec, double inputRateHz,
+                                char *err, int errLen)
+{
+    FilterChain *fc = malloc(sizeof(*fc));
+    if (!fc) {
+        fail(err, errLen, "out of memory");
+        return NULL;
+    }
+    if (!FilterChain_init(fc, spec, inputRateHz, err, errLen)) {
+        free(fc);
+        return NULL;
+    }
+    return fc;
+}
+
+void FilterChain_destroy(FilterChain *fc)
+{
+    free(fc);
+}
+
+double FilterChain_outputRate(const FilterChain *fc)
+{
+    return fc->inputRateHz / fc->decim;
+}
+
+bool FilterChain_push(FilterChain *fc, double x, double *out)
+{
+    double y = x;
+    if (fc->numTaps > 0) {
+        // Each input is stored twice, numTaps apart, so the newest numTaps
+        // samples are always contiguous at history[pos+1 .. pos+numTaps].
+        int n = fc->numTaps;
+        fc->history[fc->pos] = fc->history[fc->pos + n] = x;
+        fc->pos = fc->pos == 0 ? n - 1 : fc->pos - 1;
+        if (++fc->phase < fc->decim) return false;
+        fc->phase = 0;
+        // Newest first: taps[j] multiplies the input j samples ago
+        y = dot(fc->history + fc->pos + 1, fc->taps, n);
+    } else if (++fc->phase < fc->decim) {
+        return false;
+    } else {
+        fc->phase = 0;
+    }
+
+    for (int i = 0; i < fc->numBiquads; i++) {
+        Biquad *b = &fc->biquads[i];
+        double o = b->b0 * y + b->z1;
+        b->z1 = b->b1 * y - b->a1 * o + b->z2;
+        b->z2 = b->b2 * y - b->a2 * o;
+        y = o;
+    }
+    *out = y;
+    return true;
+}
+
+void FilterChain_describe(const FilterChain *fc, char *buf, int len)
+{
+    int n = snprintf(buf, len, "%s: %.0f Hz -> %.1f Hz", fc->spec,
+                     fc->inputRateHz, FilterChain_outputRate(fc));
+    if (n >= 0 && n < len && fc->numTaps > 0) {
+        snprintf(buf + n, len - n, ", FIR %d taps @ %.1f Hz, %d biquads",
+                 fc->numTaps, fc->cutoffHz, fc->numBiquads);
+    } else if (n >= 0 && n < len) {
+        snprintf(buf + n, len - n, ", %d biquads", fc->numBiquads);
+    }
+}
@@ -0,0 +1,43 @@
+// fixedPoint.c
+// ENSC 351 Fall 2025
+// Integer-only number formatting for hot output paths (UDP history replies).
+
+#include "hal/fixedPoint.h"
+#include <stdio.h>
+#include <math.h>
+
+// Largest magnitude (in thousandths) handled without snprintf; keeps the
+// scaled value well inside a long long and the output under the max length.
+#define MAX_SCALED 1000000000000000000.0
+
+int FixedPoint_format3(char *buf, double value)
+{
+    double scaled = fabs(value) * 1000.0 + 0.5;
+    if (!(scaled < MAX_SCALED)) {
+        // NaN, inf or huge: let the C library deal with it
+        int n = snprintf(buf, FIXEDPOINT_MAX_LEN + 1, "%.3f", value);
+        return (n > FIXEDPOINT_MAX_LEN) ? FIXEDPOINT_MAX_LEN : n;
+    }
+
+    unsigned long long milli = (unsigned long long)scaled;
+    unsigned long long whole = milli / 1000;
+    unsigned int frac = (unsigned int)(milli % 1000);
+
+    // Integer part is built backwards into a scratch buffer
+    char digits[20];
+    int nd = 0;
+    do {
+        digits[nd++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+
+    int pos = 0;
+    if (signbit(value)) buf[pos++] = '-';
+    while (nd > 0) buf[pos++] = digits[--nd];
+    buf[pos++] = '.';
+    buf[pos++] = (char)('0' + frac / 100);
+    buf[pos++] = (char)('0' + (frac / 10) % 10);
+    buf[pos++] = (char)('0' + frac % 10);
+    buf[pos] = '\0';
+    return pos;
+}
@@ -0,0 +1,261 @@
+// flightRecorder.c
+// Crash-safe flight recorder (see flightRecorder.h).
+
+#include "hal/flightRecorder.h"
+#include "hal/sampleRing.h"
+#include "hal/timing.h"
+#include "hal/threadConfig.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define POLL_MS   20       // how often the recorder drains the sample ring
+#define SYNC_MS   1000     // how often records are made durable
+#define PAGE      4096
+
+static int             s_fd = -1;
+static uint8_t        *s_map = NULL;
+static size_t          s_mapLen = 0;
+static RecorderHeader  s_hdr;
+static uint64_t        s_next = 0;        // records written (maybe not synced)
+static SampleRingReader s_reader;
+static pthread_t       s_thread;
+static volatile bool   s_running = false;
+
+static uint64_t header_checksum(const RecorderHeader *h)
+{
+    // FNV-1a over everything before the checksum field
+    const uint8_t *p = (const uint8_t*)h;
+    uint64_t x = 1469598103934665603ULL;
+    for (size_t i = 0; i < offsetof(RecorderHeader, checksum); i++) {
+        x = (x ^ p[i]) * 1099511628211ULL;
+    }
+    return x;
+}
+
+static RecorderRecord* slot_at(const uint8_t *map, uint64_t capacity, uint64_t pos)
+{
+    return (RecorderRecord*)(map + RECORDER_DATA_OFFSET) + (pos % capacity);
+}
+
+// Newest valid header of the two copies, or false if neither is valid.
+static bool read_header(const uint8_t *map, RecorderHeader *out)
+{
+    const RecorderHeader *h = (const RecorderHeader*)map;
+    bool found = false;
+    for (int i = 0; i < 2; i++) {
+        if (h[i].magic != RECORDER_MAGIC || h[i].version != RECORDER_VERSION) continue;
+        if (h[i].checksum != header_checksum(&h[i])) continue;
+        if (!found || h[i].seq > out->seq) {
+            *out = h[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+// End of the stream: the header count plus any records that made it to
+// disk after the last header update.
+static uint64_t recover_end(const uint8_t *map, const RecorderHeader *h)
+{
+    uint64_t end = h->count;
+    while (end < h->count + h->capacity &&
+           slot_at(map, h->capacity, end)->index == end + 1) {
+        end++;
+    }
+    return end;
+}
+
+static void sync_slots(uint64_t from, uint64_t to)
+{
+    uint64_t cap = s_hdr.capacity;
+    if (to - from > cap) from = to - cap;
+    while (from < to) {
+        uint64_t first = from % cap;
+        uint64_t n = to - from;
+        if (first + n > cap) n = cap - first;
+
+        uintptr_t start = (uintptr_t)slot_at(s_map, cap, from);
+        uintptr_t end = start + n * sizeof(RecorderRecord);
+        start &= ~(uintptr_t)(PAGE - 1);
+        if (msync((void*)start, end - start, MS_SYNC) < 0) perror("Recorder: msync");
+        from += n;
+    }
+}
+
+// Make the records written so far durable, then point the header at them.
+static void commit(void)
+{
+    if (s_next == s_hdr.count) return;
+    sync_slots(s_hdr.count, s_next);
+
+    s_hdr.seq++;
+    s_hdr.count = s_next;
+    s_hdr.lost = s_reader.lost;
+    s_hdr.checksum = header_checksum(&s_hdr);
+    RecorderHeader *copies = (RecorderHeader*)s_map;
+    copies[s_hdr.seq % 2] = s_hdr;     // never overwrite the newest valid copy
+    if (msync(s_map, PAGE, MS_SYNC) < 0) perror("Recorder: msync header");
+}
+
+static void* recorder_thread(void *arg)
+{
+    (void)arg;
+    ThreadConfig_applySelf(THREAD_RECORDER);
+    // Ring timestamps are monotonic; records store wall time so recordings
+    // stay meaningful across reboots.
+    struct timespec rt, mono;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    int64_t wallOffsetNs = (rt.tv_sec - mono.tv_sec) * 1000000000LL + (rt.tv_nsec - mono.tv_nsec);
+
+    long long lastSync = getTimeInMs();
+    SampleRingEntry batch[256];
+    while (s_running) {
+        sleepForMs(POLL_MS);
+        int n;
+        while ((n = SampleRing_read(&s_reader, batch, 256)) > 0) {
+            for (int i = 0; i < n; i++) {
+                RecorderRecord *r = slot_at(s_map, s_hdr.capacity, s_next);
+                r->timestampNs = batch[i].timestampNs + wallOffsetNs;
+                r->volts = (float)batch[i].volts;
+                r->flags = (batch[i].flags & SAMPLE_RING_FLAG_DIP) ? RECORDER_FLAG_DIP : 0;
+                r->index = s_next + 1;     // last, so a torn slot stays invalid
+                s_next++;
+            }
+        }
+        if (getTimeInMs() - lastSync >= SYNC_MS) {
+            commit();
+            lastSync = getTimeInMs();
+        }
+    }
+    commit();
+    return NULL;
+}
+
+bool Recorder_start(const char *path, int sizeMb)
+{
+    if (s_running) return true;
+    if (sizeMb <= 0) sizeMb = RECORDER_DEFAULT_MB;
+    size_t len = (size_t)sizeMb * 1024 * 1024;
+    uint64_t capacity = (len - RECORDER_DATA_OFFSET) / sizeof(RecorderRecord);
+
+    if (!SampleRing_openReader(&s_reader)) {
+        fprintf(stderr, "Recorder_start: sample ring not available\n");
+        return false;
+    }
+
+    s_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (s_fd < 0 || ftruncate(s_fd, (off_t)len) < 0) {
+        perror("Recorder_start: open");
+        goto fail;
+    }
+    s_map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, s_fd, 0);
+    if (s_map == MAP_FAILED) {
+        perror("Recorder_start: mmap");
+        s_map = NULL;
+        goto fail;
+    }
+    s_mapLen = len;
+
+    // Continue an existing recording of the same geometry, else start over
+    if (read_header(s_map, &s_hdr) && s_hdr.capacity == capacity) {
+        s_next = recover_end(s_map, &s_hdr);
+        s_hdr.count = s_next;
+        printf("Flight recorder: continuing %s at record %llu\n",
+               path, (unsigned long long)s_next);
+    } else {
+        memset(s_map, 0, RECORDER_DATA_OFFSET);
+        memset(&s_hdr, 0, sizeof(s_hdr));
+        s_hdr.magic = RECORDER_MAGIC;
+        s_hdr.version = RECORDER_VERSION;
+        s_hdr.capacity = capacity;
+        s_next = 0;
+        // Write a valid empty header right away
+        s_hdr.checksum = header_checksum(&s_hdr);
+        ((RecorderHeader*)s_map)[0] = s_hdr;
+        msync(s_map, PAGE, MS_SYNC);
+        printf("Flight recorder: new %d MiB recording in %s\n", sizeMb, path);
+    }
+
+    s_running = true;
+    if (pthread_create(&s_thread, NULL, recorder_thread, NULL) != 0) {
+        perror("Recorder_start: pthread_create");
+        s_running = false;
+        goto fail;
+    }
+    return true;
+
+fail:
+    if (s_map) munmap(s_map, len);
+    if (s_fd >= 0) close(s_fd);
+    s_map = NULL;
+    s_fd = -1;
+    SampleRing_closeReader(&s_reader);
+    return false;
+}
+
+void Recorder_stop(void)
+{
+    if (!s_running) return;
+    s_running = false;
+    pthread_join(s_thread, NULL);   // the thread commits what it has
+    munmap(s_map, s_mapLen);
+    close(s_fd);
+    s_map = NULL;
+    s_fd = -1;
+    SampleRing_closeReader(&s_reader);
+}
+
+bool Recorder_open(const char *path, RecorderFile *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (f->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(f->fd, &st) < 0 || st.st_size < RECORDER_DATA_OFFSET) {
+        close(f->fd);
+        return false;
+    }
+    f->mapLen = (size_t)st.st_size;
+    void *p = mmap(NULL, f->mapLen, PROT_READ, MAP_SHARED, f->fd, 0);
+    if (p == MAP_FAILED) {
+        close(f->fd);
+        return false;
+    }
+    f->map = p;
+
+    uint64_t maxCapacity = (f->mapLen - RECORDER_DATA_OFFSET) / sizeof(RecorderRecord);
+    if (!read_header(f->map, &f->hdr) || f->hdr.capacity == 0 || f->hdr.capacity > maxCapacity) {
+        Recorder_close(f);
+        return false;
+    }
+    return true;
+}
+
+void Recorder_forEach(const RecorderFile *f,
+                      bool (*fn)(const RecorderRecord *rec, void *arg), void *arg)
+{
+    uint64_t end = recover_end(f->map, &f->hdr);
+    uint64_t start = end > f->hdr.capacity ? end - f->hdr.capacity : 0;
+    for (uint64_t i = start; i < end; i++) {
+        const RecorderRecord *r = slot_at(f->map, f->hdr.capacity, i);
+        if (r->index != i + 1) continue;   // overwritten slot
+        if (!fn(r, arg)) return;
+    }
+}
+
+void Recorder_close(RecorderFile *f)
+{
+    if (f->map) munmap((void*)f->map, f->mapLen);
+    if (f->fd >= 0) close(f->fd);
+    f->map = NULL;
+    f->fd = -1;
+}
@@ -0,0 +1,219 @@
+// freqAnalyzer.c
+// Streaming frequency analysis of the light level (see freqAnalyzer.h).
+
+#include "hal/freqAnalyzer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool FreqAnalyzer_init(FreqAnalyzer *fa, int windowLen)
+{
+    memset(fa, 0, sizeof(*fa));
+    fa->window = calloc(windowLen, sizeof(double));
+    if (!fa->window) return false;
+    fa->windowLen = windowLen;
+    fa->sampleRateHz = windowLen;   // until told otherwise: a 1 s window
+    FreqAnalyzer_setTarget(fa, 10.0, fa->sampleRateHz);
+    return true;
+}
+
+void FreqAnalyzer_cleanup(FreqAnalyzer *fa)
+{
+    free(fa->window);
+    memset(fa, 0, sizeof(*fa));
+}
+
+void FreqAnalyzer_setTarget(FreqAnalyzer *fa, double targetHz, double sampleRateHz)
+{
+    if (targetHz <= 0) targetHz = 1.0;
+    if (sampleRateHz <= 0) sampleRateHz = fa->sampleRateHz;
+    fa->targetHz = targetHz;
+    fa->sampleRateHz = sampleRateHz;
+
+    double span = targetHz * FREQ_SPAN;
+    if (span < FREQ_MIN_SPAN_HZ) span = FREQ_MIN_SPAN_HZ;
+    double lo = targetHz - span, step = 2.0 * span / (FREQ_NUM_BINS - 1);
+    if (lo < step) lo = step;
+
+    // Rebuild S = sum r^m x[n-m] e^{j w m} from the window, oldest sample
+    // first (Horner form: S = S r e^{jw} + x)
+    int N = fa->filled;
+    int start = (fa->pos - N + fa->windowLen) % fa->windowLen;
+    double rN = pow(FREQ_DAMPING, fa->windowLen);
+    for (int k = 0; k < FREQ_NUM_BINS; k++) {
+        double hz = lo + k * step;
+        double w = 2.0 * M_PI * hz / sampleRateHz;
+        fa->binHz[k] = hz;
+        fa->wRe[k] = FREQ_DAMPING * cos(w);
+        fa->wIm[k] = FREQ_DAMPING * sin(w);
+        fa->wNRe[k] = rN * cos(w * fa->windowLen);
+        fa->wNIm[k] = rN * sin(w * fa->windowLen);
+
+        double re = 0, im = 0;
+        for (int m = 0, idx = start; m < N; m++) {
+            double t = fa->wRe[k] * re - fa->wIm[k] * im + fa->window[idx];
+            im = fa->wRe[k] * im + fa->wIm[k] * re;
+            re = t;
+            if (++idx == fa->windowLen) idx = 0;
+        }
+        fa->sRe[k] = re;
+        fa->sIm[k] = im;
+    }
+}
+
+bool FreqAnalyzer_needsTarget(const FreqAnalyzer *fa, double targetHz, double sampleRateHz)
+{
+    if (targetHz <= 0) targetHz = 1.0;
+    if (targetHz != fa->targetHz) return true;
+    return sampleRateHz > 0 &&
+           fabs(sampleRateHz - fa->sampleRateHz) > FREQ_RATE_TOLERANCE * fa->sampleRateHz;
+}
+
+void FreqAnalyzer_copy(FreqAnalyzer *dst, const FreqAnalyzer *src)
+{
+    double *window = dst->window;
+    int len = dst->windowLen < src->windowLen ? dst->windowLen : src->windowLen;
+    memcpy(window, src->window, sizeof(double) * len);
+    *dst = *src;
+    dst->window = window;
+    dst->windowLen = len;
+}
+
+void FreqAnalyzer_adopt(FreqAnalyzer *live, FreqAnalyzer *scratch)
+{
+    // Samples fed since the copy sit in the live window, from scratch->pos on
+    long long missed = live->fed - scratch->fed;
+    if (missed > live->windowLen) missed = live->windowLen;
+    for (long long i = 0; i < missed; i++) {
+        FreqAnalyzer_feed(scratch, live->window[scratch->pos]);
+    }
+    live->targetHz = scratch->targetHz;
+    live->sampleRateHz = scratch->sampleRateHz;
+    memcpy(live->binHz, scratch->binHz, sizeof(live->binHz));
+    memcpy(live->wRe, scratch->wRe, sizeof(live->wRe));
+    memcpy(live->wIm, scratch->wIm, sizeof(live->wIm));
+    memcpy(live->wNRe, scratch->wNRe, sizeof(live->wNRe));
+    memcpy(live->wNIm, scratch->wNIm, sizeof(live->wNIm));
+    memcpy(live->sRe, scratch->sRe, sizeof(live->sRe));
+    memcpy(live->sIm, scratch->sIm, sizeof(live->sIm));
+}
+
+void FreqAnalyzer_feed(FreqAnalyzer *fa, double x)
+{
+    // Sample leaving the window (zero until the window has filled)
+    double old = fa->window[fa->pos];
+    fa->window[fa->pos] = x;
+    fa->pos = (fa->pos + 1) % fa->windowLen;
+    if (fa->filled < fa->windowLen) fa->filled++;
+    fa->fed++;
+
+    // S(n) = x[n] + r e^{jw} S(n-1) - r^N e^{jwN} x[n-N]
+    for (int k = 0; k < FREQ_NUM_BINS; k++) {
+        double re = fa->wRe[k] * fa->sRe[k] - fa->wIm[k] * fa->sIm[k];
+        double im = fa->wRe[k] * fa->sIm[k] + fa->wIm[k] * fa->sRe[k];
+        fa->sRe[k] = re + x - fa->wNRe[k] * old;
+        fa->sIm[k] = im - fa->wNIm[k] * old;
+    }
+}
+
+// Peak of `power[0..n)` (bin spacing `binHz`, first bin at `firstHz`),
+// refined by a parabola through the peak and its neighbours.
+static FreqPeak find_peak(const double *power, int n, double firstHz, double binHz,
+                          double ampScale)
+{
+    FreqPeak p = {0};
+    int best = 0;
+    double total = 0;
+    for (int i = 0; i < n; i++) {
+        total += power[i];
+        if (power[i] > power[best]) best = i;
+    }
+    if (n == 0 || power[best] <= 0) return p;
+
+    double offset = 0;
+    if (best > 0 && best < n - 1) {
+        double a = power[best - 1], b = power[best], c = power[best + 1];
+        double denom = a - 2 * b + c;
+        if (denom != 0) offset = 0.5 * (a - c) / denom;
+    }
+    p.hz = firstHz + (best + offset) * binHz;
+    p.volts = sqrt(power[best]) * ampScale;
+    double others = (total - power[best]) / (n > 1 ? n - 1 : 1);
+    p.ratio = others > 0 ? power[best] / others : 0;
+    return p;
+}
+
+FreqPeak FreqAnalyzer_peak(const FreqAnalyzer *fa)
+{
+    double power[FREQ_NUM_BINS];
+    for (int k = 0; k < FREQ_NUM_BINS; k++) {
+        power[k] = fa->sRe[k] * fa->sRe[k] + fa->sIm[k] * fa->sIm[k];
+    }
+    double binHz = fa->binHz[1] - fa->binHz[0];
+    // The damped window weighs the samples sum r^m = (1 - r^filled) / (1 - r)
+    double gain = (1.0 - pow(FREQ_DAMPING, fa->filled)) / (1.0 - FREQ_DAMPING);
+    double scale = gain > 0 ? 2.0 / gain : 0;
+    return find_peak(power, FREQ_NUM_BINS, fa->binHz[0], binHz, scale);
+}
+
+// In-place iterative radix-2 FFT; n must be a power of two.
+static void fft(double *re, double *im, int n)
+{
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        double ang = -2.0 * M_PI / len;
+        double wlRe = cos(ang), wlIm = sin(ang);
+        for (int i = 0; i < n; i += len) {
+            double wRe = 1, wIm = 0;
+            for (int j = 0; j < len / 2; j++) {
+                int a = i + j, b = i + j + len / 2;
+                double uRe = re[a], uIm = im[a];
+                double vRe = re[b] * wRe - im[b] * wIm;
+                double vIm = re[b] * wIm + im[b] * wRe;
+                re[a] = uRe + vRe; im[a] = uIm + vIm;
+                re[b] = uRe - vRe; im[b] = uIm - vIm;
+                double nRe = wRe * wlRe - wIm * wlIm;
+                wIm = wRe * wlIm + wIm * wlRe;
+                wRe = nRe;
+            }
+        }
+    }
+}
+
+FreqPeak FreqAnalyzer_blockFft(const double *samples, int n, double sampleRateHz)
+{
+    static double re[FREQ_FFT_MAX], im[FREQ_FFT_MAX], power[FREQ_FFT_MAX / 2];
+    FreqPeak none = {0};
+    if (n > FREQ_FFT_MAX) n = FREQ_FFT_MAX;
+    int len = 1;
+    while (len * 2 <= n) len *= 2;
+    if (len < 16) return none;
+
+    // Remove DC and apply a Hann window (coherent gain 0.5)
+    double mean = 0;
+    for (int i = 0; i < len; i++) mean += samples[i];
+    mean /= len;
+    for (int i = 0; i < len; i++) {
+        double hann = 0.5 - 0.5 * cos(2.0 * M_PI * i / (len - 1));
+        re[i] = (samples[i] - mean) * hann;
+        im[i] = 0;
+    }
+    fft(re, im, len);
+
+    int half = len / 2;
+    power[0] = 0;   // DC
+    for (int i = 1; i < half; i++) power[i] = re[i] * re[i] + im[i] * im[i];
+    // Skip DC when searching: start at bin 1
+    FreqPeak p = find_peak(power + 1, half - 1, sampleRateHz / len,
+                           sampleRateHz / len, 4.0 / len);
+    return p;
+}
@@ -0,0 +1,125 @@
+// freqSweep.c
+// Automated LED frequency sweep (see freqSweep.h).
+
+#include "hal/freqSweep.h"
+#include "hal/PWM.h"
+#include "hal/sampler.h"
+#include "hal/timing.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool Sweep_parseSpec(const char *spec, SweepConfig *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->settleSec = 1;
+    cfg->measureSec = 3;
+
+    char *end;
+    cfg->fromHz = strtod(spec, &end);
+    if (*end != ':') return false;
+    cfg->toHz = strtod(end + 1, &end);
+    if (*end != ':') return false;
+    const char *step = end + 1;
+    if (*step == 'x') {
+        cfg->geometric = true;
+        step++;
+    }
+    cfg->step = strtod(step, &end);
+    if (end == step || *end != '\0') return false;
+
+    return cfg->fromHz >= 1 && cfg->toHz >= cfg->fromHz && cfg->toHz <= PWM_MAX_HZ &&
+           (cfg->geometric ? cfg->step > 1.0 : cfg->step > 0);
+}
+
+// Sleep until `deadlineMs`, then do the main loop's once-a-second work.
+// Returns the dips counted in the second that just ended.
+static int finish_second(long long deadlineMs, int *samples)
+{
+    long long now = getTimeInMs();
+    if (deadlineMs > now) sleepForMs(deadlineMs - now);
+    Sampler_moveCurrentDataToHistory();
+    Period_statistics_t st = Sampler_getLastSecondStatistics();
+    *samples = st.numSamples;
+    return Sampler_getDipCount();
+}
+
+bool Sweep_run(const SweepConfig *cfg, SweepResult *res)
+{
+    memset(res, 0, sizeof(*res));
+    int lastHz = 0;
+    long long nextSecondMs = getTimeInMs() + 1000;
+    bool tracking = true;
+
+    for (double f = cfg->fromHz; f <= cfg->toHz + 1e-9 && res->numPoints < SWEEP_MAX_POINTS;
+         f = cfg->geometric ? f * cfg->step : f + cfg->step) {
+        int hz = (int)lround(f);
+        if (hz == lastHz) continue;    // geometric steps round to the same Hz at first
+        lastHz = hz;
+
+        if (!PWM_setFrequency(hz, 50)) return false;
+        Sampler_setLedFrequency(hz);
+
+        int samples;
+        for (int s = 0; s < cfg->settleSec; s++) {
+            finish_second(nextSecondMs, &samples);
+            nextSecondMs += 1000;
+        }
+
+        SweepPoint *p = &res->points[res->numPoints++];
+        p->hz = hz;
+        p->dipsMin = INT_MAX;
+        long long dipSum = 0, sampleSum = 0;
+        for (int s = 0; s < cfg->measureSec; s++) {
+            int dips = finish_second(nextSecondMs, &samples);
+            nextSecondMs += 1000;
+            dipSum += dips;
+            sampleSum += samples;
+            if (dips < p->dipsMin) p->dipsMin = dips;
+            if (dips > p->dipsMax) p->dipsMax = dips;
+        }
+        int n = cfg->measureSec > 0 ? cfg->measureSec : 1;
+        p->dipsMean = (double)dipSum / n;
+        p->samplesPerSec = (double)sampleSum / n;
+        p->accuracy = p->dipsMean / hz;
+        FreqEstimate est;
+        Sampler_getFrequencyEstimate(&est);
+        p->trackedHz = est.tracked.hz;
+
+        if (tracking && fabs(p->accuracy - 1.0) <= SWEEP_TOLERANCE) {
+            res->maxTrackedHz = hz;
+        } else {
+            tracking = false;
+        }
+        fprintf(stderr, "sweep %3d Hz: %6.1f dips/s (%.0f%%), analyzer %.1f Hz\n",
+                hz, p->dipsMean, p->accuracy * 100, p->trackedHz);
+    }
+    return true;
+}
+
+void Sweep_writeCsv(const SweepResult *res, FILE *f)
+{
+    fprintf(f, "hz,dips_mean,dips_min,dips_max,accuracy,tracked_hz,samples_per_s\n");
+    for (int i = 0; i < res->numPoints; i++) {
+        const SweepPoint *p = &res->points[i];
+        fprintf(f, "%d,%.2f,%d,%d,%.4f,%.2f,%.0f\n", p->hz, p->dipsMean, p->dipsMin,
+                p->dipsMax, p->accuracy, p->trackedHz, p->samplesPerSec);
+    }
+    fprintf(f, "# max tracked rate: %d Hz\n", res->maxTrackedHz);
+}
+
+void Sweep_writeJson(const SweepResult *res, FILE *f)
+{
+    fprintf(f, "{\n  \"max_tracked_hz\": %d,\n  \"tolerance\": %.2f,\n  \"points\": [\n",
+            res->maxTrackedHz, SWEEP_TOLERANCE);
+    for (int i = 0; i < res->numPoints; i++) {
+        const SweepPoint *p = &res->points[i];
+        fprintf(f, "    { \"hz\": %d, \"dips_mean\": %.2f, \"dips_min\": %d, \"dips_max\": %d, "
+                   "\"accuracy\": %.4f, \"tracked_hz\": %.2f, \"samples_per_s\": %.0f }%s\n",
+                p->hz, p->dipsMean, p->dipsMin, p->dipsMax, p->accuracy, p->trackedHz,
+                p->samplesPerSec, i + 1 < res->numPoints ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
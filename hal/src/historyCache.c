@@ -0,0 +1,255 @@
+// historyCache.c
+// Encoded copies of the sampler's previous-second history, shared by the
+// network servers. See historyCache.h.
+
+#include "hal/historyCache.h"
+#include "hal/fixedPoint.h"
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    HistoryBlob pub;        // must be first: handed out as HistoryBlob*
+    atomic_int  refs;
+    bool        pooled;     // owned by the preallocated pool, never freed on release
+} Blob;
+
+static double* (*s_getHistory)(int *size) = NULL;
+static unsigned long long (*s_getSeq)(void) = NULL;
+
+// Preallocated mode (HistoryCache_preallocate)
+static int (*s_copyHistory)(double *dst, int max) = NULL;
+static double *s_scratch = NULL;
+static int s_scratchCap = 0;
+static Blob *s_pool[NUM_HISTORY_ENCODINGS][HISTORY_POOL_MAX];
+static int s_poolSize = 0;
+
+static Blob *s_cached[NUM_HISTORY_ENCODINGS];
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void HistoryCache_setSource(double* (*get_history)(int *size),
+                            unsigned long long (*get_seq)(void))
+{
+    pthread_mutex_lock(&s_lock);
+    s_getHistory = get_history;
+    s_getSeq = get_seq;
+    pthread_mutex_unlock(&s_lock);
+}
+
+// One allocation holds the header, the packet table and the bytes.
+static Blob* blob_alloc(int maxBytes, int maxPkts)
+{
+    Blob *b = malloc(sizeof(Blob) + sizeof(int) * maxPkts + maxBytes);
+    if (!b) return NULL;
+    memset(b, 0, sizeof(Blob));
+    b->pub.pktEnd = (int*)(b + 1);
+    b->pub.data = (char*)(b->pub.pktEnd + maxPkts);
+    atomic_init(&b->refs, 1);
+    return b;
+}
+
+// Worst-case sizes of an encoding of N samples
+static void blob_size(HistoryEncoding enc, int N, int *maxBytes, int *maxPkts)
+{
+    if (enc == HISTORY_TEXT) {
+        *maxBytes = N * (FIXEDPOINT_MAX_LEN + 2);
+        *maxPkts = N + 1;
+    } else {
+        *maxBytes = HISTORY_BIN_HDR + 2 * N;
+        *maxPkts = 2 + *maxBytes / HISTORY_PKT_MAX;
+    }
+}
+
+// A blob for N samples: a free pooled one in preallocated mode (NULL if all
+// are still referenced), otherwise a fresh allocation. Called with s_lock held.
+static Blob* blob_get(HistoryEncoding enc, int N)
+{
+    if (s_poolSize == 0) {
+        int maxBytes, maxPkts;
+        blob_size(enc, N, &maxBytes, &maxPkts);
+        return blob_alloc(maxBytes, maxPkts);
+    }
+    for (int i = 0; i < s_poolSize; i++) {
+        Blob *b = s_pool[enc][i];
+        // Nothing can take a reference to an unreferenced blob without s_lock
+        if (atomic_load(&b->refs) == 0) {
+            b->pub.seq = 0;
+            b->pub.len = 0;
+            b->pub.numPkts = 0;
+            atomic_store(&b->refs, 1);
+            return b;
+        }
+    }
+    return NULL;
+}
+
+// Pack history as "1.234, 0.056, ..." 10 per line; packets stay <1400B and
+// never split a value.
+static Blob* encode_text(const double *hist, int N)
+{
+    Blob *b = blob_get(HISTORY_TEXT, N);
+    if (!b) return NULL;
+    HistoryBlob *e = &b->pub;
+
+    int pos = 0, pktStart = 0, on_line = 0;
+    for (int i = 0; i < N; i++) {
+        char one[FIXEDPOINT_MAX_LEN + 3];
+        int len = FixedPoint_format3(one, hist[i]);
+        if (on_line == 9 || i == N-1) {
+            one[len++] = '\n';
+        } else {
+            one[len++] = ',';
+            one[len++] = ' ';
+        }
+
+        if (pos - pktStart + len >= HISTORY_PKT_MAX) { // start a new datagram
+            e->pktEnd[e->numPkts++] = pos;
+            pktStart = pos;
+        }
+        memcpy(e->data + pos, one, len);
+        pos += len;
+
+        on_line = (on_line + 1) % 10;
+    }
+    if (pos > pktStart) e->pktEnd[e->numPkts++] = pos;
+    e->len = pos;
+    return b;
+}
+
+// Compact binary history: header (magic 'HBIN' + uint32 N) then N samples as
+// uint16_t millivolts, all in network order. The header travels in its own
+// datagram, the samples in <=1400B chunks.
+static Blob* encode_bin(const double *hist, int N)
+{
+    int len = HISTORY_BIN_HDR + 2 * N;
+    Blob *b = blob_get(HISTORY_BIN, N);
+    if (!b) return NULL;
+    HistoryBlob *e = &b->pub;
+
+    uint32_t magic = htonl(HISTORY_BIN_MAGIC);
+    uint32_t n_n = htonl((uint32_t)N);
+    memcpy(e->data, &magic, 4);
+    memcpy(e->data + 4, &n_n, 4);
+    for (int i = 0; i < N; ++i) {
+        // convert volts (double) to millivolts uint16_t
+        int mv = (int)(hist[i] * 1000.0 + 0.5);
+        if (mv < 0) mv = 0;
+        if (mv > 0xFFFF) mv = 0xFFFF;
+        uint16_t w = htons((uint16_t)mv);
+        memcpy(e->data + HISTORY_BIN_HDR + 2 * i, &w, 2);
+    }
+    e->len = len;
+
+    e->pktEnd[e->numPkts++] = HISTORY_BIN_HDR;
+    for (int pos = HISTORY_BIN_HDR; pos < len; pos += HISTORY_PKT_MAX) {
+        int end = pos + HISTORY_PKT_MAX;
+        e->pktEnd[e->numPkts++] = end < len ? end : len;
+    }
+    return b;
+}
+
+const HistoryBlob* HistoryCache_get(HistoryEncoding enc)
+{
+    if (enc < 0 || enc >= NUM_HISTORY_ENCODINGS) return NULL;
+
+    pthread_mutex_lock(&s_lock);
+    unsigned long long seq = s_getSeq ? s_getSeq() : 0;
+    Blob *b = s_cached[enc];
+    if (b && seq != 0 && b->pub.seq == seq) {
+        atomic_fetch_add(&b->refs, 1);
+        pthread_mutex_unlock(&s_lock);
+        return &b->pub;
+    }
+
+    // Encode while holding the lock so concurrent requests for a new
+    // second don't all format it; the copy comes from the sampler's lock.
+    int N = 0;
+    double *H = NULL;
+    if (s_copyHistory) {
+        N = s_copyHistory(s_scratch, s_scratchCap);
+        H = s_scratch;
+    } else if (s_getHistory) {
+        H = s_getHistory(&N);
+    }
+    b = NULL;
+    if (H && N > 0) {
+        b = (enc == HISTORY_TEXT) ? encode_text(H, N) : encode_bin(H, N);
+    }
+    if (H != s_scratch) free(H);
+
+    if (b) {
+        b->pub.seq = seq;
+        // Only cache it if the snapshot didn't roll over while we copied it
+        if (seq != 0 && s_getSeq() == seq) {
+            HistoryCache_release(s_cached[enc] ? &s_cached[enc]->pub : NULL);
+            atomic_fetch_add(&b->refs, 1);
+            s_cached[enc] = b;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return b ? &b->pub : NULL;
+}
+
+void HistoryCache_release(const HistoryBlob *blob)
+{
+    if (!blob) return;
+    Blob *b = (Blob*)blob;
+    if (atomic_fetch_sub(&b->refs, 1) == 1 && !b->pooled) free(b);
+}
+
+bool HistoryCache_preallocate(int maxSamples, int poolSize,
+                              int (*copy_history)(double *dst, int max))
+{
+    if (poolSize < 2 || poolSize > HISTORY_POOL_MAX || maxSamples <= 0) return false;
+    pthread_mutex_lock(&s_lock);
+    bool ok = s_poolSize == 0;
+    s_scratch = ok ? malloc(sizeof(double) * maxSamples) : NULL;
+    ok = ok && s_scratch;
+    for (int enc = 0; ok && enc < NUM_HISTORY_ENCODINGS; enc++) {
+        int maxBytes, maxPkts;
+        blob_size(enc, maxSamples, &maxBytes, &maxPkts);
+        for (int i = 0; ok && i < poolSize; i++) {
+            Blob *b = blob_alloc(maxBytes, maxPkts);
+            ok = b != NULL;
+            if (ok) {
+                memset(b->pub.data, 0, maxBytes);   // fault the pages in now
+                b->pooled = true;
+                atomic_store(&b->refs, 0);
+                s_pool[enc][i] = b;
+            }
+        }
+    }
+    if (ok) {
+        s_scratchCap = maxSamples;
+        s_copyHistory = copy_history;
+        s_poolSize = poolSize;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ok;
+}
+
+void HistoryCache_cleanup(void)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < NUM_HISTORY_ENCODINGS; i++) {
+        HistoryCache_release(s_cached[i] ? &s_cached[i]->pub : NULL);
+        s_cached[i] = NULL;
+    }
+    // Pooled blobs still referenced elsewhere are left alone (leaked)
+    for (int enc = 0; enc < NUM_HISTORY_ENCODINGS; enc++) {
+        for (int i = 0; i < HISTORY_POOL_MAX; i++) {
+            Blob *b = s_pool[enc][i];
+            if (b && atomic_load(&b->refs) == 0) free(b);
+            s_pool[enc][i] = NULL;
+        }
+    }
+    free(s_scratch);
+    s_scratch = NULL;
+    s_scratchCap = 0;
+    s_copyHistory = NULL;
+    s_poolSize = 0;
+    pthread_mutex_unlock(&s_lock);
+}
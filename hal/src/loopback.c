@@ -0,0 +1,129 @@
+// loopback.c
+// Optical loopback latency measurement (see loopback.h).
+
+#include "hal/loopback.h"
+#include "hal/PWM.h"
+#include "hal/sampleRing.h"
+#include "hal/timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOOPBACK_PERIOD_NS 2000000   // 500 Hz carrier; steps are 0% <-> 100% duty
+#define LOOPBACK_MAX_SAMPLES 8192    // one ring's worth per step
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Index of the first sample of the second level in the best two-level fit
+// of v[0..n), i.e. the peak of the correlation with a step. Sets *delta to
+// (after - before). Returns -1 if n < 2.
+static int find_step(const SampleRingEntry *e, int n, double *delta)
+{
+    if (n < 2) return -1;
+    double total = 0;
+    for (int i = 0; i < n; i++) total += e[i].volts;
+
+    int best = -1;
+    double bestScore = -1, left = 0;
+    for (int k = 1; k < n; k++) {
+        left += e[k - 1].volts;
+        double mL = left / k, mR = (total - left) / (n - k);
+        double score = (double)k * (n - k) * (mL - mR) * (mL - mR);
+        if (score > bestScore) {
+            bestScore = score;
+            best = k;
+            *delta = mR - mL;
+        }
+    }
+    return best;
+}
+
+bool Loopback_measure(const LoopbackConfig *cfg, LoopbackResult *res)
+{
+    memset(res, 0, sizeof(*res));
+    int hold = cfg->holdMs > 0 ? cfg->holdMs : LOOPBACK_DEFAULT_HOLD_MS;
+    double minStep = cfg->minStepVolts > 0 ? cfg->minStepVolts : LOOPBACK_MIN_STEP_VOLTS;
+
+    SampleRingReader reader;
+    if (!SampleRing_openReader(&reader)) {
+        fprintf(stderr, "Loopback_measure: sample ring not available\n");
+        return false;
+    }
+    SampleRingEntry *buf = malloc(sizeof(*buf) * LOOPBACK_MAX_SAMPLES);
+    res->latencyNs = malloc(sizeof(long long) * (cfg->steps > 0 ? cfg->steps : 1));
+    if (!buf || !res->latencyNs) {
+        free(buf);
+        SampleRing_closeReader(&reader);
+        Loopback_freeResult(res);
+        return false;
+    }
+
+    // Constant LED levels: 100% or 0% duty on a fixed period
+    PWM_setDutyCycle(0);
+    PWM_setPeriod(LOOPBACK_PERIOD_NS);
+    PWM_enable();
+    sleepForMs(hold);
+
+    double writeNs = 0, stepSum = 0;
+    for (int i = 0; i < cfg->steps; i++) {
+        bool on = (i % 2) == 0;
+
+        // Settle, then collect half a hold of samples at the old level.
+        // Jitter the timing so steps don't lock to the sample clock.
+        while (SampleRing_read(&reader, buf, LOOPBACK_MAX_SAMPLES) > 0) {}
+        sleepForUs(hold * 500 + rand() % 1000);
+
+        long long tCmd = getTimeInNs();
+        PWM_setDutyCycle(on ? LOOPBACK_PERIOD_NS : 0);
+        writeNs += getTimeInNs() - tCmd;
+        res->steps++;
+
+        sleepForMs(hold);
+        int n = 0, got;
+        while (n < LOOPBACK_MAX_SAMPLES &&
+               (got = SampleRing_read(&reader, buf + n, LOOPBACK_MAX_SAMPLES - n)) > 0) {
+            n += got;
+        }
+
+        double delta = 0;
+        int k = find_step(buf, n, &delta);
+        bool rightWay = on ? delta >= minStep : delta <= -minStep;
+        if (k < 0 || !rightWay || buf[k].timestampNs < tCmd) continue;   // missed
+        res->latencyNs[res->detected++] = buf[k].timestampNs - tCmd;
+        stepSum += delta < 0 ? -delta : delta;
+    }
+    PWM_setDutyCycle(0);
+    free(buf);
+    SampleRing_closeReader(&reader);
+
+    res->writeMeanNs = res->steps ? writeNs / res->steps : 0;
+    int n = res->detected;
+    if (n == 0) return true;
+    res->stepVolts = stepSum / n;
+
+    long long *sorted = malloc(sizeof(long long) * n);
+    if (!sorted) return true;
+    memcpy(sorted, res->latencyNs, sizeof(long long) * n);
+    qsort(sorted, n, sizeof(long long), cmp_ll);
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += sorted[i];
+    res->meanNs = sum / n;
+    res->minNs = sorted[0];
+    res->p50Ns = sorted[(n - 1) * 50 / 100];
+    res->p90Ns = sorted[(n - 1) * 90 / 100];
+    res->p99Ns = sorted[(n - 1) * 99 / 100];
+    res->maxNs = sorted[n - 1];
+    free(sorted);
+    return true;
+}
+
+void Loopback_freeResult(LoopbackResult *res)
+{
+    free(res->latencyNs);
+    memset(res, 0, sizeof(*res));
+}
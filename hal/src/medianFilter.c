@@ -0,0 +1,130 @@
+// medianFilter.c
+// Streaming sliding-median prefilter (see medianFilter.h).
+
+#include "hal/medianFilter.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { LOW = 0, HIGH = 1 };
+
+// Heap order: LOW is a max-heap, HIGH a min-heap. True if slot a belongs
+// above slot b in heap h.
+static bool above(const MedianFilter *mf, int h, int a, int b)
+{
+    return h == LOW ? mf->vals[a] > mf->vals[b] : mf->vals[a] < mf->vals[b];
+}
+
+static void place(MedianFilter *mf, int h, int pos, int slot)
+{
+    mf->heap[h][pos] = slot;
+    mf->heapOf[slot] = h;
+    mf->posOf[slot] = pos;
+}
+
+static void sift_up(MedianFilter *mf, int h, int pos)
+{
+    int slot = mf->heap[h][pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!above(mf, h, slot, mf->heap[h][parent])) break;
+        place(mf, h, pos, mf->heap[h][parent]);
+        pos = parent;
+    }
+    place(mf, h, pos, slot);
+}
+
+static void sift_down(MedianFilter *mf, int h, int pos)
+{
+    int slot = mf->heap[h][pos];
+    int n = mf->size[h];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= n) break;
+        if (child + 1 < n && above(mf, h, mf->heap[h][child + 1], mf->heap[h][child])) {
+            child++;
+        }
+        if (!above(mf, h, mf->heap[h][child], slot)) break;
+        place(mf, h, pos, mf->heap[h][child]);
+        pos = child;
+    }
+    place(mf, h, pos, slot);
+}
+
+// Restore max(LOW) <= min(HIGH). Only one element can be out of place after
+// an insert or in-place replace, so a single root swap is enough.
+static void balance_roots(MedianFilter *mf)
+{
+    if (mf->size[LOW] == 0 || mf->size[HIGH] == 0) return;
+    int lo = mf->heap[LOW][0], hi = mf->heap[HIGH][0];
+    if (mf->vals[lo] <= mf->vals[hi]) return;
+    place(mf, LOW, 0, hi);
+    place(mf, HIGH, 0, lo);
+    sift_down(mf, LOW, 0);
+    sift_down(mf, HIGH, 0);
+}
+
+bool MedianFilter_init(MedianFilter *mf, int width, double threshold)
+{
+    memset(mf, 0, sizeof(*mf));
+    if (width < 3 || width > MEDIAN_MAX_WIDTH || width % 2 == 0 || threshold < 0) {
+        return false;
+    }
+    mf->width = width;
+    mf->threshold = threshold;
+    return true;
+}
+
+double MedianFilter_median(const MedianFilter *mf)
+{
+    // LOW holds the extra element when the count is odd
+    return mf->size[LOW] ? mf->vals[mf->heap[LOW][0]] : 0.0;
+}
+
+double MedianFilter_feed(MedianFilter *mf, double x)
+{
+    int slot = mf->next;
+    mf->next = (mf->next + 1) % mf->width;
+
+    if (mf->count < mf->width) {
+        // Filling up: append to the smaller half
+        int h = mf->size[LOW] <= mf->size[HIGH] ? LOW : HIGH;
+        mf->vals[slot] = x;
+        place(mf, h, mf->size[h]++, slot);
+        sift_up(mf, h, mf->posOf[slot]);
+        mf->count++;
+    } else {
+        // Overwrite the oldest sample in place, then fix its heap
+        int h = mf->heapOf[slot];
+        mf->vals[slot] = x;
+        sift_up(mf, h, mf->posOf[slot]);
+        sift_down(mf, h, mf->posOf[slot]);
+    }
+    balance_roots(mf);
+
+    double median = MedianFilter_median(mf);
+    if (mf->threshold > 0 && fabs(x - median) <= mf->threshold) {
+        return x;
+    }
+    return median;
+}
+
+bool MedianFilter_parseSpec(const char *spec, int *width, double *threshold)
+{
+    char *end;
+    long w = strtol(spec, &end, 10);
+    double t = 0;
+    if (end == spec) return false;
+    if (*end == ':') {
+        char *tend;
+        t = strtod(end + 1, &tend);
+        if (tend == end + 1 || *tend != '\0') return false;
+    } else if (*end != '\0') {
+        return false;
+    }
+    if (w < 3 || w > MEDIAN_MAX_WIDTH || w % 2 == 0 || t < 0) return false;
+    *width = (int)w;
+    *threshold = t;
+    return true;
+}
@@ -0,0 +1,350 @@
+// metrics.c
+// Metrics registry and Prometheus text endpoint (see metrics.h).
+
+#define _GNU_SOURCE
+#include "hal/metrics.h"
+#include "hal/tcpServer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+typedef enum { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM } MetricType;
+
+struct Metric {
+    MetricType type;
+    char name[METRICS_NAME_MAX];
+    int familyLen;                 // name up to the label set
+    const char *help;
+    atomic_ullong value;           // counter, or gauge as double bits
+    // histogram
+    double bounds[METRICS_MAX_BUCKETS];
+    int numBounds;
+    atomic_ullong buckets[METRICS_MAX_BUCKETS + 1];   // last one is +Inf
+    atomic_ullong count;
+    atomic_ullong sumBits;
+};
+
+static Metric s_metrics[METRICS_MAX];
+static atomic_int s_numMetrics;
+static pthread_mutex_t s_regLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t double_bits(double d)
+{
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+static double bits_double(uint64_t u)
+{
+    double d;
+    memcpy(&d, &u, sizeof(d));
+    return d;
+}
+
+static Metric* register_metric(MetricType type, const char *name, const char *help)
+{
+    if (strlen(name) >= METRICS_NAME_MAX) {
+        fprintf(stderr, "metrics: name too long: %s\n", name);
+        return NULL;
+    }
+    pthread_mutex_lock(&s_regLock);
+    int n = atomic_load(&s_numMetrics);
+    for (int i = 0; i < n; i++) {
+        if (!strcmp(s_metrics[i].name, name)) {
+            pthread_mutex_unlock(&s_regLock);
+            return s_metrics[i].type == type ? &s_metrics[i] : NULL;
+        }
+    }
+    if (n == METRICS_MAX) {
+        pthread_mutex_unlock(&s_regLock);
+        fprintf(stderr, "metrics: registry full, %s not recorded\n", name);
+        return NULL;
+    }
+    Metric *m = &s_metrics[n];
+    memset(m, 0, sizeof(*m));
+    m->type = type;
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->familyLen = (int)strcspn(name, "{");
+    m->help = help;
+    atomic_store_explicit(&s_numMetrics, n + 1, memory_order_release);
+    pthread_mutex_unlock(&s_regLock);
+    return m;
+}
+
+Metric* Metrics_counter(const char *name, const char *help)
+{
+    return register_metric(METRIC_COUNTER, name, help);
+}
+
+Metric* Metrics_gauge(const char *name, const char *help)
+{
+    return register_metric(METRIC_GAUGE, name, help);
+}
+
+Metric* Metrics_histogram(const char *name, const char *help,
+                          const double *bounds, int numBounds)
+{
+    if (numBounds < 1 || numBounds > METRICS_MAX_BUCKETS) return NULL;
+    Metric *m = register_metric(METRIC_HISTOGRAM, name, help);
+    if (m && m->numBounds == 0) {
+        memcpy(m->bounds, bounds, sizeof(double) * numBounds);
+        m->numBounds = numBounds;
+    }
+    return m;
+}
+
+void Metrics_inc(Metric *m)
+{
+    if (m) atomic_fetch_add_explicit(&m->value, 1, memory_order_relaxed);
+}
+
+void Metrics_add(Metric *m, uint64_t n)
+{
+    if (m) atomic_fetch_add_explicit(&m->value, n, memory_order_relaxed);
+}
+
+void Metrics_set(Metric *m, double value)
+{
+    if (m) atomic_store_explicit(&m->value, double_bits(value), memory_order_relaxed);
+}
+
+void Metrics_observe(Metric *m, double value)
+{
+    if (!m) return;
+    int b = 0;
+    while (b < m->numBounds && value > m->bounds[b]) b++;
+    atomic_fetch_add_explicit(&m->buckets[b], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->count, 1, memory_order_relaxed);
+    uint64_t old = atomic_load_explicit(&m->sumBits, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&m->sumBits, &old,
+                                                  double_bits(bits_double(old) + value),
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+double Metrics_value(const Metric *m)
+{
+    if (!m) return 0;
+    uint64_t v = atomic_load_explicit(&m->value, memory_order_relaxed);
+    return m->type == METRIC_GAUGE ? bits_double(v) : (double)v;
+}
+
+// ---------------------------------------------------------------------------
+// Exposition
+// ---------------------------------------------------------------------------
+typedef struct {
+    char *buf;
+    int len, used;
+    bool full;
+} Out;
+
+static void out_printf(Out *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void out_printf(Out *o, const char *fmt, ...)
+{
+    if (o->full) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->used, (size_t)(o->len - o->used), fmt, ap);
+    va_end(ap);
+    if (n < 0 || n >= o->len - o->used) {
+        o->full = true;
+        return;
+    }
+    o->used += n;
+}
+
+static void format_histogram(Out *o, const Metric *m)
+{
+    // Labels of the series without braces, to merge with "le"
+    const char *labels = m->name + m->familyLen;
+    int labelsLen = *labels ? (int)strlen(labels) - 2 : 0;
+    const char *sep = labelsLen > 0 ? "," : "";
+    unsigned long long cumulative = 0;
+    for (int b = 0; b <= m->numBounds; b++) {
+        cumulative += atomic_load_explicit(&m->buckets[b], memory_order_relaxed);
+        if (b < m->numBounds) {
+            out_printf(o, "%.*s_bucket{%.*s%sle=\"%g\"} %llu\n", m->familyLen, m->name,
+                       labelsLen, labels + 1, sep, m->bounds[b], cumulative);
+        } else {
+            out_printf(o, "%.*s_bucket{%.*s%sle=\"+Inf\"} %llu\n", m->familyLen, m->name,
+                       labelsLen, labels + 1, sep, cumulative);
+        }
+    }
+    out_printf(o, "%.*s_sum%s %.9g\n", m->familyLen, m->name, labels,
+               bits_double(atomic_load_explicit(&m->sumBits, memory_order_relaxed)));
+    out_printf(o, "%.*s_count%s %llu\n", m->familyLen, m->name, labels,
+               (unsigned long long)atomic_load_explicit(&m->count, memory_order_relaxed));
+}
+
+int Metrics_format(char *buf, int len)
+{
+    static const char *typeNames[] = { "counter", "gauge", "histogram" };
+    Out o = { .buf = buf, .len = len };
+    buf[0] = '\0';
+    int n = atomic_load_explicit(&s_numMetrics, memory_order_acquire);
+    bool printed[METRICS_MAX] = { false };
+    for (int i = 0; i < n; i++) {
+        if (printed[i]) continue;
+        const Metric *first = &s_metrics[i];
+        out_printf(&o, "# HELP %.*s %s\n# TYPE %.*s %s\n",
+                   first->familyLen, first->name, first->help ? first->help : "",
+                   first->familyLen, first->name, typeNames[first->type]);
+        for (int j = i; j < n; j++) {
+            const Metric *m = &s_metrics[j];
+            if (printed[j] || m->familyLen != first->familyLen ||
+                strncmp(m->name, first->name, first->familyLen) != 0) continue;
+            printed[j] = true;
+            if (m->type == METRIC_HISTOGRAM) {
+                format_histogram(&o, m);
+            } else if (m->type == METRIC_GAUGE) {
+                out_printf(&o, "%s %.9g\n", m->name, Metrics_value(m));
+            } else {
+                out_printf(&o, "%s %llu\n", m->name,
+                           (unsigned long long)atomic_load_explicit(&m->value, memory_order_relaxed));
+            }
+        }
+    }
+    return o.full ? -1 : o.used;
+}
+
+// ---------------------------------------------------------------------------
+// HTTP endpoint: a request is read up to its blank line, answered and the
+// connection closed. Listening and serving are tcpServer.h's.
+// ---------------------------------------------------------------------------
+#define MAX_CONNS     4
+#define REQUEST_MAX   2048
+#define RESPONSE_MAX  32768
+
+typedef struct {
+    int fd;                        // -1 when the slot is free
+    char in[REQUEST_MAX];
+    int inLen;
+    char out[RESPONSE_MAX];
+    int outLen, outSent;           // outLen > 0: response ready
+} Conn;
+
+static Conn      s_conns[MAX_CONNS];
+static char      s_body[RESPONSE_MAX];
+static TcpServer s_server;
+
+static void close_conn(Conn *c)
+{
+    if (c->fd < 0) return;
+    TcpServer_closeClient(&s_server, c->fd);
+    c->fd = -1;
+}
+
+static void prepare_response(Conn *c)
+{
+    const char *status = "200 OK";
+    int bodyLen;
+    bool scrape = !strncmp(c->in, "GET /metrics ", 13) || !strncmp(c->in, "GET / ", 6);
+    if (!scrape) {
+        status = "404 Not Found";
+        bodyLen = snprintf(s_body, sizeof(s_body), "Try GET /metrics\n");
+    } else if ((bodyLen = Metrics_format(s_body, sizeof(s_body))) < 0) {
+        status = "500 Internal Server Error";
+        bodyLen = snprintf(s_body, sizeof(s_body), "metrics exceed %d bytes\n", RESPONSE_MAX);
+    }
+    int head = snprintf(c->out, sizeof(c->out),
+                        "HTTP/1.1 %s\r\n"
+                        "Content-Type: text/plain; version=0.0.4\r\n"
+                        "Content-Length: %d\r\n"
+                        "Connection: close\r\n\r\n", status, bodyLen);
+    if (head + bodyLen > (int)sizeof(c->out)) bodyLen = (int)sizeof(c->out) - head;
+    memcpy(c->out + head, s_body, (size_t)bodyLen);
+    c->outLen = head + bodyLen;
+    c->outSent = 0;
+}
+
+// Returns false once the connection is done with.
+static bool write_conn(Conn *c, int idx)
+{
+    while (c->outSent < c->outLen) {
+        ssize_t n = send(c->fd, c->out + c->outSent, (size_t)(c->outLen - c->outSent),
+                         MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                TcpServer_setEvents(&s_server, c->fd, (uint32_t)idx, EPOLLOUT);
+                return true;
+            }
+            return false;
+        }
+        c->outSent += (int)n;
+    }
+    return false;
+}
+
+// Returns false once the connection is done with.
+static bool read_conn(Conn *c, int idx)
+{
+    for (;;) {
+        ssize_t n = recv(c->fd, c->in + c->inLen, sizeof(c->in) - 1 - (size_t)c->inLen, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (n == 0) return false;
+        c->inLen += (int)n;
+        c->in[c->inLen] = '\0';
+        if (strstr(c->in, "\r\n\r\n") || strstr(c->in, "\n\n")) {
+            prepare_response(c);
+            return write_conn(c, idx);
+        }
+        if (c->inLen == (int)sizeof(c->in) - 1) return false;   // oversized request
+    }
+}
+
+static bool on_accept(TcpServer *srv, int fd)
+{
+    int idx = -1;
+    for (int i = 0; i < MAX_CONNS && idx < 0; i++) {
+        if (s_conns[i].fd < 0) idx = i;
+    }
+    if (idx < 0 || !TcpServer_addClient(srv, fd, (uint32_t)idx)) return false;   // busy: the scraper retries
+    Conn *c = &s_conns[idx];
+    c->fd = fd;
+    c->inLen = 0;
+    c->outLen = 0;
+    return true;
+}
+
+static void on_events(TcpServer *srv, uint32_t tag, uint32_t events)
+{
+    (void)srv; (void)events;
+    Conn *c = &s_conns[tag];
+    if (c->fd < 0) return;
+    bool keep = c->outLen > 0 ? write_conn(c, (int)tag) : read_conn(c, (int)tag);
+    if (!keep) close_conn(c);
+}
+
+static void on_stop(TcpServer *srv)
+{
+    (void)srv;
+    for (int i = 0; i < MAX_CONNS; i++) close_conn(&s_conns[i]);
+}
+
+int Metrics_startServer(uint16_t port)
+{
+    if (TcpServer_isRunning(&s_server)) return 0;
+    for (int i = 0; i < MAX_CONNS; i++) s_conns[i].fd = -1;
+
+    static const TcpServerConfig cfg = {
+        .name = "metrics", .thread = THREAD_METRICS, .backlog = 8,
+        .onAccept = on_accept, .onEvents = on_events, .onStop = on_stop,
+    };
+    return TcpServer_start(&s_server, &cfg, port);
+}
+
+void Metrics_stopServer(void)
+{
+    TcpServer_stop(&s_server);
+}
@@ -0,0 +1,77 @@
+// overrun.c
+// Overrun accounting (see overrun.h).
+
+#include "hal/overrun.h"
+#include "hal/metrics.h"
+#include "hal/timing.h"
+
+#include <stdatomic.h>
+
+static const char *s_names[OVERRUN_KIND_COUNT] = {
+    "late_sample", "dropped_sample", "adc_failure", "late_second", "period_overflow"
+};
+
+// The deadline-miss and SPI error names predate this module
+static const char *s_metricNames[OVERRUN_KIND_COUNT] = {
+    "light_sample_deadline_misses_total",
+    "light_samples_dropped_total",
+    "spi_errors_total",
+    "late_second_boundaries_total",
+    "period_timer_overflows_total",
+};
+static const char *s_metricHelp[OVERRUN_KIND_COUNT] = {
+    "Samples taken more than half a period late.",
+    "Samples not stored because the second's buffer was full.",
+    "Failed ADC reads over SPI.",
+    "Once-a-second boundaries handled late.",
+    "Timestamps the period timer had no room for.",
+};
+
+static atomic_llong s_count[OVERRUN_KIND_COUNT];
+static atomic_llong s_lastNs[OVERRUN_KIND_COUNT];
+static Metric *s_metrics[OVERRUN_KIND_COUNT];
+
+void Overrun_init(void)
+{
+    for (int i = 0; i < OVERRUN_KIND_COUNT; i++) {
+        atomic_store(&s_count[i], 0);
+        atomic_store(&s_lastNs[i], 0);
+        s_metrics[i] = Metrics_counter(s_metricNames[i], s_metricHelp[i]);
+    }
+}
+
+void Overrun_record(OverrunKind kind)
+{
+    Overrun_recordAt(kind, getTimeInNs());
+}
+
+void Overrun_recordAt(OverrunKind kind, long long timeInNs)
+{
+    if (kind < 0 || kind >= OVERRUN_KIND_COUNT) return;
+    atomic_fetch_add_explicit(&s_count[kind], 1, memory_order_relaxed);
+    atomic_store_explicit(&s_lastNs[kind], timeInNs, memory_order_relaxed);
+    Metrics_inc(s_metrics[kind]);
+}
+
+OverrunInfo Overrun_get(OverrunKind kind)
+{
+    OverrunInfo info = { 0, 0 };
+    if (kind < 0 || kind >= OVERRUN_KIND_COUNT) return info;
+    info.count = atomic_load_explicit(&s_count[kind], memory_order_relaxed);
+    info.lastNs = atomic_load_explicit(&s_lastNs[kind], memory_order_relaxed);
+    return info;
+}
+
+const char* Overrun_name(OverrunKind kind)
+{
+    return kind >= 0 && kind < OVERRUN_KIND_COUNT ? s_names[kind] : "?";
+}
+
+long long Overrun_total(void)
+{
+    long long total = 0;
+    for (int i = 0; i < OVERRUN_KIND_COUNT; i++) {
+        total += atomic_load_explicit(&s_count[i], memory_order_relaxed);
+    }
+    return total;
+}
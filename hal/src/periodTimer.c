@@ -5,6 +5,8 @@
 #include <string.h>
 
 #include "hal/periodTimer.h"
+#include "hal/timing.h"
+#include "hal/overrun.h"
 
 // Written by Brian Fraser
 
@@ -30,7 +32,6 @@ static void updateStats(
     timestamps_t *pData, 
     Period_statistics_t *pStats
 );
-static long long getTimeInNanoS(void);
 
 
 void Period_init(void)
@@ -45,6 +46,11 @@ void Period_cleanup(void)
 }
 
 void Period_markEvent(enum Period_whichEvent whichEvent)
+{
+    Period_markEventAt(whichEvent, getTimeInNs());
+}
+
+void Period_markEventAt(enum Period_whichEvent whichEvent, long long timeInNs)
 {
     assert (whichEvent >= 0 && whichEvent < NUM_PERIOD_EVENTS);
     assert (s_initialized);
@@ -53,10 +59,11 @@ void Period_markEvent(enum Period_whichEvent whichEvent)
     pthread_mutex_lock(&s_lock);
     {
         if (pData->timestampCount < MAX_EVENT_TIMESTAMPS) {
-            pData->timestampsInNs[pData->timestampCount] = getTimeInNanoS();
+            pData->timestampsInNs[pData->timestampCount] = timeInNs;
             pData->timestampCount++;
         } else {
-            printf("WARNING: No sample space for event collection on %d\n", whichEvent);
+            // Counted rather than printed: this runs on the sampler thread
+            Overrun_recordAt(OVERRUN_PERIOD_OVERFLOW, timeInNs);
         }
     }
     pthread_mutex_unlock(&s_lock);
@@ -129,23 +136,3 @@ static void updateStats(
     pStats->avgPeriodInMs = avgNs / MS_PER_NS;
     pStats->numSamples = pData->timestampCount;
 }
-
-
-
-
-
-// Timing function
-static long long getTimeInNanoS(void) 
-{
-    struct timespec spec;
-    clock_gettime(CLOCK_BOOTTIME, &spec);
-    long long seconds = spec.tv_sec;
-    long long nanoSeconds = spec.tv_nsec + seconds * 1000*1000*1000;
-	assert(nanoSeconds > 0);
-    
-    static long long lastTimeHack = 0;
-    assert(nanoSeconds > lastTimeHack);
-    lastTimeHack = nanoSeconds;
-
-    return nanoSeconds;
-}
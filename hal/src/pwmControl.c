@@ -0,0 +1,233 @@
+// pwmControl.c
+// Coalescing owner of the PWM output (see pwmControl.h).
+
+#define _GNU_SOURCE
+#include "hal/pwmControl.h"
+#include "hal/PWM.h"
+#include "hal/metrics.h"
+#include "hal/reactor.h"
+#include "hal/sampler.h"
+#include "hal/threadConfig.h"
+#include "hal/timing.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// Mailbox word: frequency in bits 0-15, duty in bits 16-23, bit 24 set once
+// a duty was posted, and a sequence number in the top 32 bits that every
+// post increments.
+#define BOX_HZ_MASK    0xFFFFULL
+#define BOX_DUTY_MASK  (0xFFULL << 16)
+#define BOX_DUTY_SET   (1ULL << 24)
+#define BOX_SEQ_ONE    (1ULL << 32)
+#define BOX_HZ(w)      ((int)((w) & BOX_HZ_MASK))
+#define BOX_DUTY(w)    ((int)(((w) & BOX_DUTY_MASK) >> 16))
+#define BOX_SEQ(w)     ((uint32_t)((w) >> 32))
+
+static atomic_ullong s_box;
+static atomic_llong s_firstInputNs;   // oldest input not yet applied, 0 if none
+
+// Owner-side state
+static uint32_t s_appliedSeq;
+static long long s_nextAllowedNs;
+static long long s_intervalNs;
+static atomic_int s_hz = -1;
+static atomic_int s_duty = -1;
+
+static int s_wakeFd = -1;
+static int s_timerFd = -1;
+static bool s_timerArmed;
+static bool s_onReactor;
+static pthread_t s_thread;
+static atomic_bool s_running;
+static sem_t s_started;
+
+static Metric *s_mRequests, *s_mCoalesced, *s_mLatency;
+
+static void register_metrics(void)
+{
+    static const double bounds[] = { 100e-6, 500e-6, 1e-3, 2e-3, 5e-3, 10e-3, 20e-3, 50e-3,
+                                     100e-3, 250e-3 };
+    s_mRequests = Metrics_counter("pwm_control_requests_total",
+                                  "Frequency/duty values posted to the PWM owner.");
+    s_mCoalesced = Metrics_counter("pwm_control_coalesced_total",
+                                   "Posted values replaced by a newer one before being applied.");
+    s_mLatency = Metrics_histogram("pwm_control_latency_seconds",
+                                   "Time from an input (encoder edge, UDP command) to its PWM write.",
+                                   bounds, (int)(sizeof(bounds) / sizeof(bounds[0])));
+}
+
+// Apply the mailbox if it changed and the interval allows. Returns how long
+// to wait before trying again, or 0 if nothing is pending.
+static long long service(void)
+{
+    long long now = getTimeInNs();
+    if (now < s_nextAllowedNs) return s_nextAllowedNs - now;
+
+    // Take the input time before the values: a post stores its value first,
+    // so the values read below include every post whose time was taken
+    long long firstInputNs = atomic_exchange(&s_firstInputNs, 0);
+    uint64_t box = atomic_load(&s_box);
+    uint32_t seq = BOX_SEQ(box);
+    if (seq == s_appliedSeq) return 0;
+    Metrics_add(s_mCoalesced, seq - s_appliedSeq - 1);
+    s_appliedSeq = seq;
+
+    int hz = BOX_HZ(box), duty = BOX_DUTY(box);
+    if (hz == atomic_load(&s_hz) && duty == atomic_load(&s_duty)) return 0;
+    if (PWM_setFrequency(hz, duty)) {
+        atomic_store(&s_hz, hz);
+        atomic_store(&s_duty, duty);
+        Sampler_setLedFrequency(hz);
+    }
+    if (firstInputNs > 0) Metrics_observe(s_mLatency, (getTimeInNs() - firstInputNs) / 1e9);
+    s_nextAllowedNs = now + s_intervalNs;
+    return 0;
+}
+
+// Reactor owner: the wakeup and the rate-limit timer both land here
+static void on_reactor_event(uint64_t count, void *arg)
+{
+    (void)count;
+    if (arg) s_timerArmed = false;   // the timer passes a non-NULL arg
+    long long waitNs = service();
+    if (waitNs > 0 && !s_timerArmed) {
+        s_timerArmed = Reactor_armTimer(s_timerFd, waitNs, 0);
+    }
+}
+
+static void* owner_thread(void *arg)
+{
+    (void)arg;
+    ThreadConfig_applySelf(THREAD_PWM);
+    sem_post(&s_started);
+    while (atomic_load(&s_running)) {
+        long long waitNs = service();
+        if (waitNs > 0) {
+            struct timespec ts = { waitNs / 1000000000LL, waitNs % 1000000000LL };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        uint64_t n;
+        if (read(s_wakeFd, &n, sizeof(n)) < 0 && errno != EINTR) break;
+    }
+    return NULL;
+}
+
+static void wake(void)
+{
+    if (s_wakeFd < 0) return;
+    uint64_t one = 1;
+    if (write(s_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) perror("pwm control: wake");
+}
+
+// Update the mailbox; `hz` or `duty` < 0 leaves that field as it is
+static void post(int hz, int duty, long long inputNs)
+{
+    uint64_t old = atomic_load(&s_box), next;
+    do {
+        next = old;
+        if (hz >= 0) next = (next & ~BOX_HZ_MASK) | (uint64_t)hz;
+        if (duty >= 0) next = (next & ~BOX_DUTY_MASK) | (uint64_t)duty << 16 | BOX_DUTY_SET;
+        next += BOX_SEQ_ONE;
+    } while (!atomic_compare_exchange_weak(&s_box, &old, next));
+
+    long long none = 0;
+    atomic_compare_exchange_strong(&s_firstInputNs, &none, inputNs > 0 ? inputNs : getTimeInNs());
+    Metrics_inc(s_mRequests);
+    wake();
+}
+
+bool PwmControl_requestFrequency(int hz, long long inputNs)
+{
+    if (hz < 1 || hz > PWM_MAX_HZ) return false;
+    post(hz, -1, inputNs);
+    return true;
+}
+
+bool PwmControl_requestDuty(int dutyPct, long long inputNs)
+{
+    if (dutyPct < 0 || dutyPct > 100) return false;
+    post(-1, dutyPct, inputNs);
+    return true;
+}
+
+int PwmControl_getFrequency(void)
+{
+    return atomic_load(&s_hz);
+}
+
+int PwmControl_getDuty(void)
+{
+    return atomic_load(&s_duty);
+}
+
+bool PwmControl_start(int hz, int dutyPct, int minIntervalMs)
+{
+    if (s_wakeFd >= 0) return true;
+    register_metrics();
+    s_intervalNs = minIntervalMs > 0 ? minIntervalMs * 1000000LL : 0;
+
+    // Fill in whatever wasn't posted yet and apply it here
+    uint64_t old = atomic_load(&s_box), next;
+    do {
+        next = old;
+        if (BOX_HZ(next) == 0) next |= (uint64_t)hz;
+        if (!(next & BOX_DUTY_SET)) next |= (uint64_t)dutyPct << 16 | BOX_DUTY_SET;
+        next += BOX_SEQ_ONE;
+    } while (!atomic_compare_exchange_weak(&s_box, &old, next));
+    atomic_store(&s_firstInputNs, 0);
+    service();
+
+    s_onReactor = Reactor_isActive();
+    if (s_onReactor) {
+        s_wakeFd = Reactor_addWakeup(on_reactor_event, NULL);
+        s_timerFd = Reactor_addTimer(0, on_reactor_event, &s_timerFd);
+        if (s_wakeFd < 0 || s_timerFd < 0) {
+            fprintf(stderr, "pwm control: reactor sources unavailable\n");
+            return false;
+        }
+        wake();   // catch posts made while starting
+        return true;
+    }
+
+    s_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (s_wakeFd < 0) {
+        perror("pwm control: eventfd");
+        return false;
+    }
+    atomic_store(&s_running, true);
+    sem_init(&s_started, 0, 0);
+    if (pthread_create(&s_thread, NULL, owner_thread, NULL) != 0) {
+        perror("pwm control: pthread_create");
+        atomic_store(&s_running, false);
+        close(s_wakeFd);
+        s_wakeFd = -1;
+        return false;
+    }
+    while (sem_wait(&s_started) != 0 && errno == EINTR) {}   // as in StatusWriter_start()
+    return true;
+}
+
+void PwmControl_stop(void)
+{
+    if (s_onReactor) {
+        // The reactor closes its own fds
+        s_wakeFd = s_timerFd = -1;
+        s_onReactor = false;
+        return;
+    }
+    if (!atomic_load(&s_running)) return;
+    atomic_store(&s_running, false);
+    wake();
+    pthread_join(s_thread, NULL);
+    close(s_wakeFd);
+    s_wakeFd = -1;
+}
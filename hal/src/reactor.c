@@ -0,0 +1,200 @@
+// reactor.c
+// Single-threaded epoll event loop (see reactor.h).
+
+#define _GNU_SOURCE
+#include "hal/reactor.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define TAG_STOP   0xFFFFFFFFu
+#define MAX_EVENTS 16
+
+typedef enum { SRC_FREE, SRC_FD, SRC_TIMER, SRC_WAKE } SourceKind;
+
+typedef struct {
+    SourceKind kind;
+    int fd;
+    ReactorFdHandler onFd;
+    ReactorTickHandler onTick;
+    void *arg;
+} Source;
+
+static int s_epollFd = -1;
+static int s_stopFd = -1;
+static volatile sig_atomic_t s_stopping = 0;
+static Source s_sources[REACTOR_MAX_SOURCES];
+
+bool Reactor_init(void)
+{
+    if (s_epollFd >= 0) return true;
+    memset(s_sources, 0, sizeof(s_sources));
+    s_stopping = 0;
+
+    s_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    s_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = TAG_STOP };
+    if (s_epollFd < 0 || s_stopFd < 0 ||
+        epoll_ctl(s_epollFd, EPOLL_CTL_ADD, s_stopFd, &ev) < 0) {
+        perror("reactor: init");
+        Reactor_cleanup();
+        return false;
+    }
+    return true;
+}
+
+bool Reactor_isActive(void)
+{
+    return s_epollFd >= 0;
+}
+
+static int add_source(SourceKind kind, int fd, uint32_t events,
+                      ReactorFdHandler onFd, ReactorTickHandler onTick, void *arg)
+{
+    if (s_epollFd < 0 || fd < 0) return -1;
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (s_sources[i].kind != SRC_FREE) continue;
+        struct epoll_event ev = { .events = events, .data.u32 = (uint32_t)i };
+        if (epoll_ctl(s_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("reactor: epoll_ctl");
+            return -1;
+        }
+        s_sources[i] = (Source){ kind, fd, onFd, onTick, arg };
+        return 0;
+    }
+    fprintf(stderr, "reactor: more than %d sources\n", REACTOR_MAX_SOURCES);
+    return -1;
+}
+
+static Source* find_source(int fd)
+{
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (s_sources[i].kind != SRC_FREE && s_sources[i].fd == fd) return &s_sources[i];
+    }
+    return NULL;
+}
+
+int Reactor_addFd(int fd, uint32_t events, ReactorFdHandler handler, void *arg)
+{
+    if (!handler) return -1;
+    return add_source(SRC_FD, fd, events, handler, NULL, arg);
+}
+
+void Reactor_removeFd(int fd)
+{
+    Source *src = find_source(fd);
+    if (!src) return;
+    epoll_ctl(s_epollFd, EPOLL_CTL_DEL, fd, NULL);
+    // Timer and wakeup fds belong to the reactor
+    if (src->kind != SRC_FD) close(fd);
+    src->kind = SRC_FREE;   // events already fetched for it are skipped
+    src->fd = -1;
+}
+
+static struct timespec to_timespec(long long ns)
+{
+    return (struct timespec){ .tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL };
+}
+
+bool Reactor_armTimer(int timerFd, long long delayNs, long long periodNs)
+{
+    struct itimerspec its = {
+        .it_interval = to_timespec(periodNs > 0 ? periodNs : 0),
+        .it_value = to_timespec(delayNs > 0 ? delayNs : 0),
+    };
+    if (timerfd_settime(timerFd, 0, &its, NULL) < 0) {
+        perror("reactor: timerfd_settime");
+        return false;
+    }
+    return true;
+}
+
+int Reactor_addTimer(long long periodNs, ReactorTickHandler handler, void *arg)
+{
+    if (!handler || periodNs < 0) return -1;
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        perror("reactor: timerfd_create");
+        return -1;
+    }
+    if ((periodNs > 0 && !Reactor_armTimer(fd, periodNs, periodNs)) ||
+        add_source(SRC_TIMER, fd, EPOLLIN, NULL, handler, arg) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int Reactor_addWakeup(ReactorTickHandler handler, void *arg)
+{
+    if (!handler) return -1;
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        perror("reactor: eventfd");
+        return -1;
+    }
+    if (add_source(SRC_WAKE, fd, EPOLLIN, NULL, handler, arg) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void Reactor_wake(int wakeFd)
+{
+    uint64_t one = 1;
+    // Only fails if the counter would overflow; the wakeup is pending anyway
+    if (write(wakeFd, &one, sizeof(one)) < 0) return;
+}
+
+void Reactor_stop(void)
+{
+    s_stopping = 1;
+    if (s_stopFd >= 0) Reactor_wake(s_stopFd);
+}
+
+static void dispatch(Source *src, uint32_t events)
+{
+    if (src->kind == SRC_FD) {
+        src->onFd(src->fd, events, src->arg);
+        return;
+    }
+    // timerfd and eventfd both hand back a uint64_t count
+    uint64_t count = 0;
+    if (read(src->fd, &count, sizeof(count)) != sizeof(count)) return;
+    src->onTick(count, src->arg);
+}
+
+void Reactor_run(void)
+{
+    struct epoll_event events[MAX_EVENTS];
+    while (!s_stopping) {
+        int n = epoll_wait(s_epollFd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("reactor: epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n && !s_stopping; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == TAG_STOP || tag >= REACTOR_MAX_SOURCES) continue;
+            Source *src = &s_sources[tag];
+            if (src->kind != SRC_FREE) dispatch(src, events[i].events);
+        }
+    }
+}
+
+void Reactor_cleanup(void)
+{
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (s_sources[i].kind != SRC_FREE) Reactor_removeFd(s_sources[i].fd);
+    }
+    if (s_stopFd >= 0)  { close(s_stopFd);  s_stopFd = -1; }
+    if (s_epollFd >= 0) { close(s_epollFd); s_epollFd = -1; }
+}
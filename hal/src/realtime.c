@@ -0,0 +1,84 @@
+// realtime.c
+// Allocation-free, page-locked steady-state mode (see realtime.h).
+
+#include "hal/realtime.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static atomic_bool s_enabled = false;
+static atomic_bool s_steady = false;
+static atomic_llong s_steadyAllocs = 0;
+static atomic_bool s_counting = false;  // an allocator reports to us
+
+void Realtime_enable(void)
+{
+    atomic_store(&s_enabled, true);
+}
+
+bool Realtime_isEnabled(void)
+{
+    return atomic_load(&s_enabled);
+}
+
+bool Realtime_lockMemory(size_t heapBytes)
+{
+    // Freed memory stays in the heap, and large blocks come from the heap
+    // too, so nothing is handed back to (and re-faulted from) the kernel.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (heapBytes > 0) {
+        char *reserve = malloc(heapBytes);
+        if (reserve) {
+            memset(reserve, 0, heapBytes);
+            free(reserve);
+        }
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "realtime: mlockall failed: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void Realtime_prefaultStack(size_t bytes)
+{
+    if (bytes > REALTIME_STACK_PREFAULT) bytes = REALTIME_STACK_PREFAULT;
+    char stack[REALTIME_STACK_PREFAULT];
+    memset(stack, 0, bytes);
+    __asm__ volatile("" : : "r"(stack) : "memory");   // keep the writes
+}
+
+void Realtime_beginSteadyState(void)
+{
+    atomic_store(&s_steadyAllocs, 0);
+    atomic_store(&s_steady, true);
+}
+
+long long Realtime_steadyStateAllocations(void)
+{
+    return atomic_load(&s_steadyAllocs);
+}
+
+bool Realtime_allocCheckAvailable(void)
+{
+    return atomic_load(&s_counting);
+}
+
+void Realtime_countAllocation(void)
+{
+    if (atomic_load_explicit(&s_steady, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&s_steadyAllocs, 1, memory_order_relaxed);
+    }
+}
+
+void Realtime_setAllocCheckAvailable(bool available)
+{
+    atomic_store(&s_counting, available);
+}
@@ -0,0 +1,199 @@
+// replay.c
+// Offline replay of sample streams through the dip detector (see replay.h).
+
+#include "hal/replay.h"
+#include "hal/dipDetector.h"
+#include "hal/flightRecorder.h"
+#include "hal/medianFilter.h"
+#include "hal/timing.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NS_PER_S 1000000000LL
+
+static bool data_reserve(ReplayData *d, size_t *cap, size_t want)
+{
+    if (want <= *cap) return true;
+    size_t n = *cap ? *cap * 2 : 4096;
+    while (n < want) n *= 2;
+    double *v = realloc(d->volts, n * sizeof(double));
+    if (!v) return false;
+    d->volts = v;
+    int64_t *t = realloc(d->timestampNs, n * sizeof(int64_t));
+    if (!t) return false;
+    d->timestampNs = t;
+    *cap = n;
+    return true;
+}
+
+typedef struct {
+    ReplayData *d;
+    size_t cap;
+    bool ok;
+} LoadCtx;
+
+static bool add_record(const RecorderRecord *rec, void *arg)
+{
+    LoadCtx *c = arg;
+    if (!data_reserve(c->d, &c->cap, c->d->count + 1)) {
+        c->ok = false;
+        return false;
+    }
+    c->d->volts[c->d->count] = rec->volts;
+    c->d->timestampNs[c->d->count] = rec->timestampNs;
+    c->d->count++;
+    return true;
+}
+
+bool Replay_loadFile(const char *path, double rateHz, ReplayData *out)
+{
+    memset(out, 0, sizeof(*out));
+    LoadCtx ctx = { .d = out, .cap = 0, .ok = true };
+
+    RecorderFile rf;
+    if (Recorder_open(path, &rf)) {
+        Recorder_forEach(&rf, add_record, &ctx);
+        Recorder_close(&rf);
+        if (!ctx.ok) Replay_freeData(out);
+        return ctx.ok;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("Replay_loadFile");
+        return false;
+    }
+    if (rateHz <= 0) rateHz = 1000.0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (!(isdigit((unsigned char)*p) || *p == '-' || *p == '.')) continue;
+
+        char *end;
+        double first = strtod(p, &end);
+        double volts = first;
+        int64_t t = (int64_t)(out->count * (NS_PER_S / rateHz));
+        if (*end == ',') {
+            volts = strtod(end + 1, NULL);
+            t = (int64_t)llround(first * NS_PER_S);
+        }
+        if (!data_reserve(out, &ctx.cap, out->count + 1)) {
+            ctx.ok = false;
+            break;
+        }
+        out->volts[out->count] = volts;
+        out->timestampNs[out->count] = t;
+        out->count++;
+    }
+    fclose(f);
+    if (!ctx.ok) Replay_freeData(out);
+    return ctx.ok;
+}
+
+// Standard normal deviate (Box-Muller); rand() is fine for test signals.
+static double gaussian(void)
+{
+    double u1 = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+bool Replay_synthesize(double ledHz, double seconds, double rateHz,
+                       double noiseV, ReplayData *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (rateHz <= 0 || seconds <= 0) return false;
+    size_t n = (size_t)(seconds * rateHz);
+    size_t cap = 0;
+    if (!data_reserve(out, &cap, n)) {
+        Replay_freeData(out);
+        return false;
+    }
+
+    // LED aimed at the sensor: bright while on, ambient level while off
+    const double ambient = 1.2, lit = 1.8;
+    for (size_t i = 0; i < n; i++) {
+        double t = i / rateHz;
+        bool on = ledHz > 0 && fmod(t * ledHz, 1.0) < 0.5;
+        out->volts[i] = (on ? lit : ambient) + noiseV * gaussian();
+        out->timestampNs[i] = (int64_t)(t * NS_PER_S);
+    }
+    out->count = n;
+    return true;
+}
+
+long long Replay_addGlitches(ReplayData *data, double probability)
+{
+    long long n = 0;
+    for (size_t i = 0; i < data->count; i++) {
+        if ((double)rand() / RAND_MAX < probability) {
+            data->volts[i] = 0.0;
+            n++;
+        }
+    }
+    return n;
+}
+
+void Replay_freeData(ReplayData *data)
+{
+    free(data->volts);
+    free(data->timestampNs);
+    memset(data, 0, sizeof(*data));
+}
+
+bool Replay_run(const ReplayData *data, ReplayResult *res)
+{
+    return Replay_runFiltered(data, 0, 0, res);
+}
+
+bool Replay_runFiltered(const ReplayData *data, int medianWidth,
+                        double medianThreshold, ReplayResult *res)
+{
+    memset(res, 0, sizeof(*res));
+    if (data->count == 0) return false;
+    MedianFilter mf;
+    if (medianWidth > 0 && !MedianFilter_init(&mf, medianWidth, medianThreshold)) {
+        return false;
+    }
+
+    int64_t t0 = data->timestampNs[0];
+    int64_t span = data->timestampNs[data->count - 1] - t0;
+    res->numSeconds = (int)(span / NS_PER_S) + 1;
+    res->dipsPerSecond = calloc(res->numSeconds, sizeof(int));
+    res->samplesPerSecond = calloc(res->numSeconds, sizeof(int));
+    if (!res->dipsPerSecond || !res->samplesPerSecond) {
+        Replay_freeResult(res);
+        return false;
+    }
+
+    DipDetector det;
+    DipDetector_init(&det);
+    long long start = getTimeInNs();
+    for (size_t i = 0; i < data->count; i++) {
+        int64_t sec = (data->timestampNs[i] - t0) / NS_PER_S;
+        if (sec < 0) sec = 0;                      // out-of-order timestamps
+        if (sec >= res->numSeconds) sec = res->numSeconds - 1;
+        double v = medianWidth > 0 ? MedianFilter_feed(&mf, data->volts[i])
+                                   : data->volts[i];
+        bool dip = DipDetector_feed(&det, v);
+        res->dipsPerSecond[sec] += dip;
+        res->samplesPerSecond[sec]++;
+        res->dips += dip;
+    }
+    res->elapsedSec = (getTimeInNs() - start) / 1e9;
+    res->samples = (long long)data->count;
+    res->samplesPerSec = res->elapsedSec > 0 ? res->samples / res->elapsedSec : 0;
+    return true;
+}
+
+void Replay_freeResult(ReplayResult *res)
+{
+    free(res->dipsPerSecond);
+    free(res->samplesPerSecond);
+    memset(res, 0, sizeof(*res));
+}
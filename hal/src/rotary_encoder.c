@@ -5,10 +5,13 @@
 #define _GNU_SOURCE
 #include "hal/rotary_encoder.h"
 #include "hal/periodTimer.h"  // <-- we will mark steps here
+#include "hal/reactor.h"
+#include "hal/simulation.h"
+#include "hal/threadConfig.h"
+#include "hal/timing.h"
 
 #include <stdbool.h>
 #include <fcntl.h>
-#include <gpiod.h>
 #include <pthread.h>
 #include <stdatomic.h>
 #include <time.h>
@@ -16,6 +19,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <linux/gpio.h>
 
@@ -25,8 +29,10 @@
 #define ACTIVE_LOW 1      // pressed pulls line LOW (typical with pull-up)
 
 static int line_fd = -1;
+static int event_fd[2] = { -1, -1 };   // reactor mode: one line-event fd per input
 
-bool rotary_init(void) {
+// Request both lines as one input handle for level reads (line_fd)
+static bool request_line_handle(void) {
     int chip_fd = open(GPIOCHIP_PATH, O_RDONLY | O_CLOEXEC);
     if (chip_fd < 0) { perror("open gpiochip"); return false; }
 
@@ -48,23 +54,52 @@ bool rotary_init(void) {
     close(chip_fd);
 
     line_fd = req.fd; // handle used for reads
+    return true;
+}
+
+bool rotary_init(void) {
+    if (Sim_isEnabled()) {
+        printf("Rotary encoder simulated\n");
+        return true;
+    }
+    if (!request_line_handle()) return false;
     printf("Rotary encoder ready (A=%d, B=%d)\n", OUTPUT_A, OUTPUT_B);
     return true;
 }
 
-static int AB_read(void)
+// Value of one line requested for events (the event fd doubles as a handle)
+static int event_line_read(int fd)
 {
-    if (line_fd < 0) return -1;
-
     struct gpiohandle_data data;
     memset(&data, 0, sizeof(data));
-    if (ioctl(line_fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+    if (ioctl(fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
         perror("GPIOHANDLE_GET_LINE_VALUES_IOCTL");
         return -1;
     }
+    return data.values[0];
+}
+
+static int AB_read(void)
+{
+    if (Sim_isEnabled()) return Sim_readRotaryAB();
 
-    int A = data.values[0];
-    int B = data.values[1];
+    int A, B;
+    if (event_fd[0] >= 0) {
+        A = event_line_read(event_fd[0]);
+        B = event_line_read(event_fd[1]);
+        if (A < 0 || B < 0) return -1;
+    } else {
+        if (line_fd < 0) return -1;
+
+        struct gpiohandle_data data;
+        memset(&data, 0, sizeof(data));
+        if (ioctl(line_fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+            perror("GPIOHANDLE_GET_LINE_VALUES_IOCTL");
+            return -1;
+        }
+        A = data.values[0];
+        B = data.values[1];
+    }
 #if ACTIVE_LOW
     A = !A;
     B = !B;
@@ -87,33 +122,182 @@ static int decode_step(int prev, int curr)
 
 // ====== chatgpt suggested code ========
 static atomic_int g_count = 0;   // global rotation count
+static atomic_llong g_last_step_ns = 0;
+static int g_prev = -1;          // last A/B state seen
+static RotaryListener g_listener = NULL;
+static void *g_listener_arg = NULL;
+static int poll_timer_fd = -1;   // reactor mode in simulation
+
+// Move to A/B state `curr`, reached at `ns`, counting the step if it is one
+static int apply_state(int curr, long long ns)
+{
+    int step = decode_step(g_prev, curr);
+    g_prev = curr;
+    if (step != 0) {
+        atomic_store(&g_last_step_ns, ns);
+        atomic_fetch_add(&g_count, step);  // +1 clockwise, -1 counter-clockwise
+    }
+    return step;
+}
+
+static void notify_listener(void)
+{
+    if (g_listener) g_listener(atomic_load(&g_count), atomic_load(&g_last_step_ns), g_listener_arg);
+}
+
+// Read A/B once and count the step, if any. Returns false on read failure.
+static bool sample_once(void)
+{
+    int curr = AB_read();
+    if (curr < 0) return false;
+    if (apply_state(curr, getTimeInNs()) != 0) notify_listener();
+    return true;
+}
 
 // thread function that polls the encoder
 static void* rotary_thread(void* arg)
 {
     (void)arg;  // Explicitly ignore the unused parameter
-    int prev = AB_read();
-    if (prev < 0) return NULL;
-
-    while (1) {
-        int curr = AB_read();
-        if (curr < 0) break;
+    ThreadConfig_applySelf(THREAD_ROTARY);
+    g_prev = AB_read();
+    if (g_prev < 0) return NULL;
 
-        int step = decode_step(prev, curr);
-        if (step == +1)
-            g_count++;               // clockwise
-        else if (step == -1)
-            g_count--;               // counter-clockwise
-
-        prev = curr;
+    while (sample_once()) {
         usleep(2000);                // 2 ms poll
     }
     return NULL;
 }
 
+static void on_poll_tick(uint64_t expirations, void *arg)
+{
+    (void)expirations; (void)arg;
+    sample_once();
+}
+
+#define EVENT_BATCH 16
+#define EDGE_MAX_AGE_NS 1000000000LL
+static const int line_bit[2] = { 2, 1 };   // A and B in the AB state
+
+// Edge timestamps are CLOCK_MONOTONIC since Linux 5.7, the timeline of
+// getTimeInNs(); older kernels stamp CLOCK_REALTIME. Anything not in the
+// last second (or a hair in the future, from cycle-counter rounding) is
+// replaced by `now`.
+static long long edge_time_ns(uint64_t timestamp, long long now)
+{
+    long long t = (long long)timestamp;
+    if (t > now) return now;
+    return now - t < EDGE_MAX_AGE_NS ? t : now;
+}
+
+// Every queued edge is one A/B transition: apply them in the order they
+// happened (both queues merged by kernel timestamp), so a burst of edges
+// between wake-ups still counts every step.
+static void on_line_event(int fd, uint32_t events, void *arg)
+{
+    (void)fd; (void)events; (void)arg;
+    struct gpioevent_data ev[2][EVENT_BATCH];
+    bool moved = false, more = true;
+    long long now = getTimeInNs();
+    while (more) {
+        int n[2], pos[2] = { 0, 0 };
+        more = false;
+        for (int i = 0; i < 2; i++) {
+            ssize_t got = read(event_fd[i], ev[i], sizeof(ev[i]));
+            n[i] = got > 0 ? (int)(got / (ssize_t)sizeof(ev[i][0])) : 0;
+            if (n[i] == EVENT_BATCH) more = true;
+        }
+        while (pos[0] < n[0] || pos[1] < n[1]) {
+            int i = pos[1] >= n[1] ||
+                    (pos[0] < n[0] && ev[0][pos[0]].timestamp <= ev[1][pos[1]].timestamp) ? 0 : 1;
+            const struct gpioevent_data *e = &ev[i][pos[i]++];
+            int level = e->id == GPIOEVENT_EVENT_RISING_EDGE;
+#if ACTIVE_LOW
+            level = !level;
+#endif
+            int prev = g_prev < 0 ? 0 : g_prev;
+            int curr = level ? (prev | line_bit[i]) : (prev & ~line_bit[i]);
+            if (apply_state(curr, edge_time_ns(e->timestamp, now)) != 0) moved = true;
+        }
+    }
+    // Edges dropped by a full kernel queue leave the levels elsewhere;
+    // decode whatever is left against the lines' real state
+    int curr = AB_read();
+    if (curr >= 0 && apply_state(curr, now) != 0) moved = true;
+    if (moved) notify_listener();
+}
+
+static void release_line_events(void)
+{
+    for (int i = 0; i < 2; i++) {
+        if (event_fd[i] < 0) continue;
+        Reactor_removeFd(event_fd[i]);   // ignores fds it doesn't watch
+        close(event_fd[i]);
+        event_fd[i] = -1;
+    }
+}
+
+// Swap the polling handle for one edge-event fd per line. On failure the
+// polling handle is back in place and no event fd is left.
+static bool request_line_events(void)
+{
+    int chip_fd = open(GPIOCHIP_PATH, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) { perror("open gpiochip"); return false; }
+    if (line_fd >= 0) { close(line_fd); line_fd = -1; }
+
+    static const int lines[2] = { OUTPUT_A, OUTPUT_B };
+    bool ok = true;
+    for (int i = 0; i < 2 && ok; i++) {
+        struct gpioevent_request req;
+        memset(&req, 0, sizeof(req));
+        req.lineoffset = lines[i];
+        req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+#ifdef GPIOHANDLE_REQUEST_BIAS_PULL_UP
+        req.handleflags |= GPIOHANDLE_REQUEST_BIAS_PULL_UP;
+#endif
+        req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+        snprintf(req.consumer_label, sizeof(req.consumer_label), "rotary");
+        if (ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &req) < 0) {
+            perror("GPIO_GET_LINEEVENT_IOCTL");
+            ok = false;
+            break;
+        }
+        event_fd[i] = req.fd;
+        int flags = fcntl(req.fd, F_GETFL, 0);
+        ok = fcntl(req.fd, F_SETFL, flags | O_NONBLOCK) == 0 &&
+             Reactor_addFd(req.fd, EPOLLIN, on_line_event, NULL) == 0;
+    }
+    close(chip_fd);
+    if (ok) return true;
+
+    // Back to the level handle, so the caller can poll instead
+    release_line_events();
+    if (!request_line_handle()) fprintf(stderr, "rotary: encoder lines unavailable\n");
+    return false;
+}
+
+void rotary_setListener(RotaryListener fn, void *arg)
+{
+    g_listener_arg = arg;
+    g_listener = fn;
+}
+
 // start polling (call this from your main)
 void rotary_start(void)
 {
+    if (Reactor_isActive()) {
+        if (!Sim_isEnabled() && request_line_events()) {
+            g_prev = AB_read();
+            return;
+        }
+        // Simulated input has no fd to wait on, and edge events can be
+        // refused (lines busy, old kernel); poll from a timer instead
+        if (!Sim_isEnabled()) fprintf(stderr, "rotary: no edge events, polling every 2 ms\n");
+        g_prev = AB_read();
+        poll_timer_fd = Reactor_addTimer(2000000LL, on_poll_tick, NULL);   // 2 ms poll
+        if (poll_timer_fd < 0) fprintf(stderr, "rotary: no reactor timer\n");
+        return;
+    }
+
     pthread_t tid;
     pthread_create(&tid, NULL, rotary_thread, NULL);
     pthread_detach(tid);             // run in background
@@ -125,6 +309,11 @@ int rotary_getCount(void)
     return atomic_load(&g_count);
 }
 
+long long rotary_getLastStepNs(void)
+{
+    return atomic_load(&g_last_step_ns);
+}
+
 // ====== end of chatgpt suggested code ========
 
 /*
@@ -142,5 +331,7 @@ bool GPIO_read(bool *valueA, bool *valueB) {
 
 void rotary_close(void) {
     if (line_fd >= 0) { close(line_fd); line_fd = -1; }
+    release_line_events();
+    if (poll_timer_fd >= 0) { Reactor_removeFd(poll_timer_fd); poll_timer_fd = -1; }
 }
 
@@ -0,0 +1,141 @@
+// sampleRing.c
+// Live sample ring in POSIX shared memory (see sampleRing.h).
+
+#include "hal/sampleRing.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RING_MASK (SAMPLE_RING_CAPACITY - 1)
+
+_Static_assert((SAMPLE_RING_CAPACITY & RING_MASK) == 0, "capacity must be a power of 2");
+
+static SampleRingShm *s_ring = NULL;
+static uint64_t s_head = 0;   // writer's private copy of shm->head
+
+bool SampleRing_create(void)
+{
+    shm_unlink(SAMPLE_RING_SHM_NAME);  // start from a clean ring
+    int fd = shm_open(SAMPLE_RING_SHM_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("SampleRing_create: shm_open");
+        return false;
+    }
+    if (ftruncate(fd, sizeof(SampleRingShm)) < 0) {
+        perror("SampleRing_create: ftruncate");
+        close(fd);
+        shm_unlink(SAMPLE_RING_SHM_NAME);
+        return false;
+    }
+    void *p = mmap(NULL, sizeof(SampleRingShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("SampleRing_create: mmap");
+        shm_unlink(SAMPLE_RING_SHM_NAME);
+        return false;
+    }
+
+    SampleRingShm *ring = p;
+    memset(ring, 0, sizeof(*ring));   // also pre-faults every page
+    ring->capacity = SAMPLE_RING_CAPACITY;
+    ring->slotSize = sizeof(SampleRingSlot);
+    ring->version = SAMPLE_RING_VERSION;
+    s_head = 0;
+    // Readers check the magic last, so publish it after everything else
+    atomic_thread_fence(memory_order_release);
+    ring->magic = SAMPLE_RING_MAGIC;
+    s_ring = ring;
+    return true;
+}
+
+void SampleRing_publish(int64_t timestampNs, double volts, uint32_t flags)
+{
+    if (!s_ring) return;
+    uint64_t idx = s_head;
+    SampleRingSlot *slot = &s_ring->slots[idx & RING_MASK];
+
+    atomic_store_explicit(&slot->seq, 2 * idx + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->timestampNs = timestampNs;
+    slot->volts = volts;
+    slot->flags = flags;
+    atomic_store_explicit(&slot->seq, 2 * idx + 2, memory_order_release);
+
+    s_head = idx + 1;
+    atomic_store_explicit(&s_ring->head, s_head, memory_order_release);
+}
+
+void SampleRing_destroy(void)
+{
+    if (!s_ring) return;
+    munmap(s_ring, sizeof(SampleRingShm));
+    s_ring = NULL;
+    shm_unlink(SAMPLE_RING_SHM_NAME);
+}
+
+bool SampleRing_openReader(SampleRingReader *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = shm_open(SAMPLE_RING_SHM_NAME, O_RDONLY, 0);
+    if (r->fd < 0) return false;
+
+    void *p = mmap(NULL, sizeof(SampleRingShm), PROT_READ, MAP_SHARED, r->fd, 0);
+    if (p == MAP_FAILED) {
+        close(r->fd);
+        r->fd = -1;
+        return false;
+    }
+    r->shm = p;
+    if (r->shm->magic != SAMPLE_RING_MAGIC || r->shm->version != SAMPLE_RING_VERSION ||
+        r->shm->capacity != SAMPLE_RING_CAPACITY) {
+        fprintf(stderr, "SampleRing_openReader: ring format mismatch\n");
+        SampleRing_closeReader(r);
+        return false;
+    }
+    r->next = atomic_load_explicit(&r->shm->head, memory_order_acquire);
+    return true;
+}
+
+int SampleRing_read(SampleRingReader *r, SampleRingEntry *out, int max)
+{
+    uint64_t head = atomic_load_explicit(&r->shm->head, memory_order_acquire);
+    if (head - r->next > SAMPLE_RING_CAPACITY) {
+        r->lost += head - SAMPLE_RING_CAPACITY - r->next;
+        r->next = head - SAMPLE_RING_CAPACITY;
+    }
+
+    int n = 0;
+    while (n < max && r->next < head) {
+        uint64_t idx = r->next;
+        SampleRingSlot *slot = (SampleRingSlot*)&r->shm->slots[idx & RING_MASK];
+
+        uint64_t s1 = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        out[n].timestampNs = slot->timestampNs;
+        out[n].volts = slot->volts;
+        out[n].flags = slot->flags;
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t s2 = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+        r->next++;
+        if (s1 != s2 || s1 != 2 * idx + 2) {
+            // Overwritten while (or before) we read it
+            r->lost++;
+            continue;
+        }
+        out[n].index = idx;
+        n++;
+    }
+    return n;
+}
+
+void SampleRing_closeReader(SampleRingReader *r)
+{
+    if (r->shm) munmap((void*)r->shm, sizeof(SampleRingShm));
+    if (r->fd >= 0) close(r->fd);
+    r->shm = NULL;
+    r->fd = -1;
+}
@@ -12,47 +12,178 @@
 #include "hal/sampler.h"
 #include "hal/SPI.h"
 #include "hal/periodTimer.h"
+#include "hal/sampleRing.h"
+#include "hal/dipDetector.h"
+#include "hal/freqAnalyzer.h"
+#include "hal/windowStats.h"
+#include "hal/medianFilter.h"
+#include "hal/filterChain.h"
+#include "hal/threadConfig.h"
+#include "hal/trace.h"
+#include "hal/metrics.h"
+#include "hal/overrun.h"
 
 //#define DEBUG
 
 #define SENSOR_CHANNEL 0 // ADC channel for light sensor
 
-#define MAX_SAMPLES_PER_SECOND 1000
+#define DEFAULT_SAMPLE_RATE_HZ 1000
+#define MAX_SAMPLE_RATE_HZ 15000   // limited by MAX_EVENT_TIMESTAMPS in periodTimer.h
 #define MAX_ADC_VALUE 4095.0   
 #define MAX_VOLTAGE 3.3       // Maximum voltage corresponding to ADC full scale 
-#define MAX_SAMPLE_SIZE (MAX_SAMPLES_PER_SECOND + 0.1*MAX_SAMPLES_PER_SECOND) // buffer for 10% overhead
-#define DIP_THRESHOLD 0.1     // Must drop this far below average to trigger (volts)
-#define DIP_HYSTERESIS 0.03   // Must recover this much to re-arm
 static pthread_t samplerThreadId;
 static bool keepRunning = false;
 
 // Thread function declaration
 static void* samplerThread(void* arg);
 
+// Sampling rate (set before Sampler_init)
+static int sampleRateHz = DEFAULT_SAMPLE_RATE_HZ;
+static int maxSampleSize = 0;   // samples per second + 10% overhead
+
 // Buffers
 static double *currentSamples = NULL;
 static int currentSize = 0;
+static int currentRawCount = 0;    // full-rate samples this second
+static FilterChain *filterChain = NULL; // decimates what is stored (NULL = raw)
+static FilterChain filterStore[2];      // active + spare, so changes don't allocate
+static pthread_mutex_t filterConfigLock = PTHREAD_MUTEX_INITIALIZER;
 
 static double *historySamples = NULL;
 static int historySize = 0;
+static unsigned long long historySeq = 0; // bumped every time history is replaced
 
 // Stats
 static long long totalSamples = 0;
-static double avgExp = 0.0;
-static bool firstSample = true;
+static DipDetector detector;   // exponential average + dip state
+static MedianFilter prefilter;  // optional spike rejection before the detector
+static int prefilterWidth = 0;  // 0 = off
+static double prefilterThreshold = 0;
+
+// Metrics (see Sampler_init)
+static Metric *mSamples, *mDips, *mInterval;
+static long long lastSampleNs = 0;   // sampler thread only
+
+// Frequency analysis
+static FreqAnalyzer analyzer;       // sliding bins, fed per sample
+static FreqAnalyzer retarget;       // copy re-centred outside the lock
+static bool analyzerOk = false;
+static int ledFrequencyHz = 0;      // commanded LED frequency (0 = unknown)
+static FreqEstimate lastEstimate;   // published once a second
+
+// Sliding-window statistics (window lengths set before Sampler_init)
+static int statsWindowMs[SAMPLER_MAX_STATS_WINDOWS] = {100, 1000, 10000};
+static int numStatsWindows = 3;
+static WindowStats windowStats[SAMPLER_MAX_STATS_WINDOWS];
 
 
 
 // Synchronization
 static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 
+bool Sampler_setSampleRate(int hz){
+    if (hz <= 0 || hz > MAX_SAMPLE_RATE_HZ || keepRunning) return false;
+    sampleRateHz = hz;
+    return true;
+}
+
+bool Sampler_setStatsWindows(const int *windowMs, int count){
+    if (count < 0 || count > SAMPLER_MAX_STATS_WINDOWS || keepRunning) return false;
+    for (int i = 0; i < count; i++) {
+        if (windowMs[i] <= 0) return false;
+    }
+    memcpy(statsWindowMs, windowMs, sizeof(int) * count);
+    numStatsWindows = count;
+    return true;
+}
+
+bool Sampler_setPrefilter(int width, double threshold){
+    MedianFilter probe;
+    if (keepRunning) return false;
+    if (width != 0 && !MedianFilter_init(&probe, width, threshold)) return false;
+    prefilterWidth = width;
+    prefilterThreshold = threshold;
+    return true;
+}
+
+bool Sampler_setFilter(const char *spec, char *err, int errLen){
+    // Build the new chain in whichever store isn't active, then swap it in;
+    // filterConfigLock keeps two callers from building into the same store.
+    pthread_mutex_lock(&filterConfigLock);
+    FilterChain *fc = NULL;
+    if (spec && spec[0] && strcmp(spec, "off") != 0) {
+        fc = (filterChain == &filterStore[0]) ? &filterStore[1] : &filterStore[0];
+        if (!FilterChain_init(fc, spec, sampleRateHz, err, errLen)) {
+            pthread_mutex_unlock(&filterConfigLock);
+            return false;
+        }
+    }
+    pthread_mutex_lock(&lock);
+    filterChain = fc;
+    pthread_mutex_unlock(&lock);
+    pthread_mutex_unlock(&filterConfigLock);
+    return true;
+}
+
+void Sampler_describeFilter(char *buf, int len){
+    pthread_mutex_lock(&lock);
+    if (filterChain) {
+        FilterChain_describe(filterChain, buf, len);
+    } else {
+        snprintf(buf, len, "off: %d Hz raw", sampleRateHz);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void register_metrics(void){
+    double periodS = 1.0 / sampleRateHz;
+    static const double scale[] = { 0.5, 0.9, 1.0, 1.1, 1.25, 1.5, 2, 5, 10, 100 };
+    double bounds[sizeof(scale) / sizeof(scale[0])];
+    for (size_t i = 0; i < sizeof(scale) / sizeof(scale[0]); i++) bounds[i] = scale[i] * periodS;
+    mSamples = Metrics_counter("light_samples_total", "Light samples taken.");
+    mDips = Metrics_counter("light_dips_total", "Dips detected.");
+    mInterval = Metrics_histogram("light_sample_interval_seconds",
+                                  "Time between consecutive light samples.",
+                                  bounds, (int)(sizeof(bounds) / sizeof(bounds[0])));
+}
+
 void Sampler_init(void){
     // Initialize the period timer first
     Period_init();
+    register_metrics();
+    Overrun_init();
+    lastSampleNs = 0;
     
+    // Local consumers read live samples from shared memory; carry on without it
+    if (!SampleRing_create()) {
+        fprintf(stderr, "Sampler_init: shared-memory sample ring disabled\n");
+    }
+
+    DipDetector_init(&detector);
+    if (prefilterWidth > 0) {
+        MedianFilter_init(&prefilter, prefilterWidth, prefilterThreshold);
+    }
+    analyzerOk = FreqAnalyzer_init(&analyzer, sampleRateHz);
+    if (analyzerOk && !FreqAnalyzer_init(&retarget, sampleRateHz)) {
+        FreqAnalyzer_cleanup(&analyzer);
+        analyzerOk = false;
+    }
+    if (!analyzerOk) {
+        fprintf(stderr, "Sampler_init: frequency analyzer disabled\n");
+    }
+    for (int i = 0; i < numStatsWindows; i++) {
+        long long len = (long long)statsWindowMs[i] * sampleRateHz / 1000;
+        if (!WindowStats_init(&windowStats[i], len > 0 ? (int)len : 1)) {
+            perror("Sampler_init: window stats");
+            exit(-1);
+        }
+    }
     keepRunning = true;
-    currentSamples = malloc(sizeof(double) * MAX_SAMPLE_SIZE);
-    if (!currentSamples) {
+    maxSampleSize = sampleRateHz + sampleRateHz / 10; // buffer for 10% overhead
+    // Two buffers that swap roles every second, so steady state never allocates
+    currentSamples = malloc(sizeof(double) * maxSampleSize);
+    historySamples = malloc(sizeof(double) * maxSampleSize);
+    if (!currentSamples || !historySamples) {
         perror("Sampler_init: malloc");
         exit(-1);
     }
@@ -74,12 +205,22 @@ double ADC_to_volts (int ADC_Reading)
 void Sampler_cleanup(void){
     keepRunning = false;
     pthread_join(samplerThreadId, NULL);
+    SampleRing_destroy();
 
     pthread_mutex_lock(&lock);
     free(currentSamples);
     free(historySamples);
     currentSamples = historySamples = NULL;
     currentSize = historySize = 0;
+    filterChain = NULL;
+    if (analyzerOk) {
+        FreqAnalyzer_cleanup(&analyzer);
+        FreqAnalyzer_cleanup(&retarget);
+    }
+    analyzerOk = false;
+    for (int i = 0; i < numStatsWindows; i++) {
+        WindowStats_cleanup(&windowStats[i]);
+    }
     pthread_mutex_unlock(&lock);
 }
 
@@ -87,16 +228,77 @@ void Sampler_cleanup(void){
 // Moves the samples that it has been collecting this second into
 // the history, which makes the samples available for reads (below).
 void Sampler_moveCurrentDataToHistory(void){
+    Trace_begin("move_history");
     pthread_mutex_lock(&lock);
-    free(historySamples);
-    historySamples = malloc(sizeof(double) * currentSize);
-    if (historySamples) {
-        memcpy(historySamples, currentSamples, sizeof(double) * currentSize);
-        historySize = currentSize;
-    } else {
-        historySize = 0;
-    }
+    double *done = currentSamples;
+    currentSamples = historySamples;
+    historySamples = done;
+    historySize = currentSize;
+    historySeq++;
     currentSize = 0; // reset for next second
+
+    // The sliding bins (fed at full rate) follow the commanded frequency at
+    // the rate we actually achieve. Re-centring rebuilds every bin from the
+    // window, so it only happens when either changed, and on a copy while
+    // the sampler thread keeps feeding the live bins.
+    int rawRate = currentRawCount > 0 ? currentRawCount : sampleRateHz;
+    int rate = historySize > 0 ? historySize : sampleRateHz;  // history may be decimated
+    int targetHz = ledFrequencyHz;
+    currentRawCount = 0;
+    bool recentre = analyzerOk && targetHz > 0 &&
+                    FreqAnalyzer_needsTarget(&analyzer, targetHz, rawRate);
+    if (recentre) {
+        FreqAnalyzer_copy(&retarget, &analyzer);
+    } else if (analyzerOk && targetHz > 0) {
+        lastEstimate.tracked = FreqAnalyzer_peak(&analyzer);
+    }
+    lastEstimate.commandedHz = targetHz;
+    pthread_mutex_unlock(&lock);
+
+    if (recentre) {
+        FreqAnalyzer_setTarget(&retarget, targetHz, rawRate);
+        pthread_mutex_lock(&lock);
+        FreqAnalyzer_adopt(&analyzer, &retarget);
+        lastEstimate.tracked = FreqAnalyzer_peak(&analyzer);
+        pthread_mutex_unlock(&lock);
+    }
+
+    // Only this function swaps the buffers, so the FFT can read history
+    // without holding the lock and stalling the sampler thread.
+    FreqPeak fft = FreqAnalyzer_blockFft(historySamples, historySize, rate);
+    pthread_mutex_lock(&lock);
+    lastEstimate.fft = fft;
+    pthread_mutex_unlock(&lock);
+    Trace_end("move_history");
+}
+
+void Sampler_setLedFrequency(int hz){
+    pthread_mutex_lock(&lock);
+    ledFrequencyHz = hz;
+    pthread_mutex_unlock(&lock);
+}
+
+int Sampler_getStatsWindows(int *windowMs, int max){
+    int n = numStatsWindows < max ? numStatsWindows : max;
+    memcpy(windowMs, statsWindowMs, sizeof(int) * n);
+    return numStatsWindows;
+}
+
+bool Sampler_getWindowStats(int windowMs, WindowStatsResult *out){
+    for (int i = 0; i < numStatsWindows; i++) {
+        if (statsWindowMs[i] == windowMs) {
+            pthread_mutex_lock(&lock);
+            WindowStats_get(&windowStats[i], out);
+            pthread_mutex_unlock(&lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Sampler_getFrequencyEstimate(FreqEstimate *out){
+    pthread_mutex_lock(&lock);
+    *out = lastEstimate;
     pthread_mutex_unlock(&lock);
 }
 
@@ -126,6 +328,29 @@ double* Sampler_getHistory(int *size){
     pthread_mutex_unlock(&lock);
     return copy;
 }
+int Sampler_copyHistory(double *dst, int max){
+    Trace_begin("copy_history");
+    pthread_mutex_lock(&lock);
+    int n = historySize < max ? historySize : max;
+    if (historySamples && n > 0) {
+        memcpy(dst, historySamples, sizeof(double) * n);
+    }
+    pthread_mutex_unlock(&lock);
+    Trace_end("copy_history");
+    return n > 0 ? n : 0;
+}
+
+int Sampler_getMaxHistorySize(void){
+    return maxSampleSize;
+}
+
+unsigned long long Sampler_getHistorySeq(void){
+    pthread_mutex_lock(&lock);
+    unsigned long long seq = historySeq;
+    pthread_mutex_unlock(&lock);
+    return seq;
+}
+
 Period_statistics_t Sampler_getLastSecondStatistics(void){
     pthread_mutex_lock(&lock);
     Period_statistics_t _lastSecondsSample;
@@ -138,7 +363,7 @@ Period_statistics_t Sampler_getLastSecondStatistics(void){
 // Get the average light level (not tied to the history).
 double Sampler_getAverageReading(void){
     pthread_mutex_lock(&lock);
-    double val = avgExp;
+    double val = detector.avgExp;
     pthread_mutex_unlock(&lock);
     return val;
 }
@@ -159,59 +384,86 @@ int Sampler_getDipCount(void){
     return stats.numSamples;
 }
 
+// Process one sample exactly as the sampler thread does: mark its timing,
+// run the dip detector, store it for this second and publish it.
+void Sampler_recordSample(double volts){
+    long long sampleTimeNs = getTimeInNs();
+    Period_markEventAt(PERIOD_EVENT_SAMPLE_LIGHT, sampleTimeNs);
+    if (lastSampleNs > 0) {
+        long long intervalNs = sampleTimeNs - lastSampleNs;
+        Metrics_observe(mInterval, intervalNs * 1e-9);
+        // Late: more than half a period after it was due
+        if (intervalNs * sampleRateHz > 1500000000LL) {
+            Overrun_recordAt(OVERRUN_LATE_SAMPLE, sampleTimeNs);
+        }
+    }
+    lastSampleNs = sampleTimeNs;
+    Metrics_inc(mSamples);
+    uint32_t ringFlags = 0;
+    Trace_begin("sampler_lock");
+    pthread_mutex_lock(&lock);
+    Trace_end("sampler_lock");
+
+    // Only the detector sees the prefiltered value; history, the ring and
+    // recordings keep raw samples so they can be replayed with any filter.
+    double detectVolts = prefilterWidth > 0 ? MedianFilter_feed(&prefilter, volts) : volts;
+    if (DipDetector_feed(&detector, detectVolts)) {
+        Period_markEventAt(PERIOD_EVENT_DIP, sampleTimeNs);  // Record dip in period timer
+        Metrics_inc(mDips);
+        ringFlags |= SAMPLE_RING_FLAG_DIP;
+        #ifdef DEBUG
+            printf("Detected dip!\n");
+        #endif
+    }
+    if (analyzerOk) {
+        FreqAnalyzer_feed(&analyzer, volts);
+    }
+    for (int i = 0; i < numStatsWindows; i++) {
+        WindowStats_feed(&windowStats[i], volts);
+    }
+    // History stores the filtered/decimated stream; detection above and
+    // the shared-memory ring below see every raw sample.
+    double stored = volts;
+    bool haveOutput = !filterChain || FilterChain_push(filterChain, volts, &stored);
+    if (haveOutput && currentSize < maxSampleSize) {
+        currentSamples[currentSize++] = stored;
+    } else if (haveOutput) {
+        Overrun_recordAt(OVERRUN_DROPPED_SAMPLE, sampleTimeNs);
+    }
+    currentRawCount++;
+    totalSamples++;
+    pthread_mutex_unlock(&lock);
+
+    // Hand the sample to local shared-memory readers (no syscalls)
+    SampleRing_publish(sampleTimeNs, volts, ringFlags);
+}
+
 
 // Sampler thread function
 // Continuously samples light levels and stores them.
 static void* samplerThread(void* arg) {
     (void)arg;  // Suppress unused parameter warning
-    bool dipArmed = true;  // State of dip detector
-    
+    ThreadConfig_applySelf(THREAD_SAMPLER);
+
      while (keepRunning) {
         // 1) Sample ADC (single call)
+        Trace_begin("sample");
         double volts = ADC_to_volts(Read_ADC_Values(SENSOR_CHANNEL));
         if (volts < 0) {
+            Trace_end("sample");
+            Overrun_record(OVERRUN_ADC_FAILURE);
             perror("samplerThread: failed Read_ADC_Values");
             // small sleep to avoid busy-looping on persistent error
             sleepForMs(1);
             continue;
         }
 
-        // 2) Record timing event
-        Period_markEvent(PERIOD_EVENT_SAMPLE_LIGHT);
-        pthread_mutex_lock(&lock);
-
-        // Detect a dip as a transition from above-average to below-average.
-        // Use the previous stored sample (if any) and a time-based refractory
-        // window so that multiple sampled points inside the same physical dip
-        // aren't counted more than once.
-        if (!firstSample && currentSize > 0 && !dipArmed && volts > (avgExp - DIP_HYSTERESIS)) {
-            dipArmed = true;
-        }
-        else if (!firstSample && currentSize > 0 && dipArmed && volts < (avgExp - DIP_THRESHOLD)) {
-            Period_markEvent(PERIOD_EVENT_DIP);  // Record dip in period timer
-            dipArmed = false;
-            #ifdef DEBUG
-                printf("Detected dip!\n");
-            #endif
-    
-        }
-
-        // 3) Update exponential average and store sample
-        
-        if (firstSample) {
-            avgExp = volts;
-            firstSample = false;
-        } else {
-            avgExp = 0.999 * avgExp + 0.001 * volts;
-        }
-        if (currentSize < MAX_SAMPLE_SIZE) {
-            currentSamples[currentSize++] = volts;
-        }
-        totalSamples++;
-        pthread_mutex_unlock(&lock);
+        // 2) Detect dips, store and publish the sample
+        Sampler_recordSample(volts);
+        Trace_end("sample");
 
-        // 4) Sleep for 1 ms
-        sleepForMs(1);
+        // 3) Sleep for one sample period
+        sleepForUs(1000000 / sampleRateHz);
      }
         return NULL;
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+// simulation.c
+// Host simulation backend for the HAL (see simulation.h).
+
+#include "hal/simulation.h"
+#include "hal/timing.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ADC_VALUE 4095.0
+#define MAX_VOLTAGE   3.3
+#define MAX_ROTARY_STEPS 32
+
+typedef enum { WAVE_NONE, WAVE_SINE, WAVE_SQUARE } SimWave;
+
+typedef struct {
+    double atSec;
+    int detents;
+} RotaryStep;
+
+static struct {
+    double ambient, led, noise;
+    SimWave wave;
+    double waveHz, waveAmp;
+    double glitch;
+    long long lagNs;
+    RotaryStep rotary[MAX_ROTARY_STEPS];
+    int numRotary;
+} s_cfg;
+
+static bool s_enabled = false;
+static long long s_startNs = 0;
+
+// PWM state changes, written by the PWM owner and read by the sampler
+// thread. A short timeline is kept so the sensor can see each change
+// lag_us after it was made, as with a real optical/ADC delay.
+#define SIM_PWM_HISTORY 16
+
+typedef struct {
+    long long atNs;
+    long long periodNs, dutyNs;
+    bool enabled;
+} SimPwmState;
+
+static SimPwmState s_pwm[SIM_PWM_HISTORY];
+static int s_pwmNewest = 0;
+static pthread_mutex_t s_pwmLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Rotary position in edges as seen by the poller (rotary thread only)
+static int s_rotaryEdges = 0;
+
+// Simple per-thread PRNG so noise doesn't serialize threads on rand()
+static _Thread_local unsigned long long s_rng = 88172645463325252ULL;
+
+static double uniform(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (s_rng >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(void)
+{
+    double u1 = uniform() + 1e-12, u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static bool parse_rotary(char *script)
+{
+    s_cfg.numRotary = 0;
+    for (char *tok = strtok(script, ";"); tok; tok = strtok(NULL, ";")) {
+        char *at = strchr(tok, '@');
+        if (!at || s_cfg.numRotary == MAX_ROTARY_STEPS) return false;
+        *at = '\0';
+        s_cfg.rotary[s_cfg.numRotary].detents = atoi(tok);
+        s_cfg.rotary[s_cfg.numRotary].atSec = atof(at + 1);
+        s_cfg.numRotary++;
+    }
+    return true;
+}
+
+bool Sim_enable(const char *spec)
+{
+    memset(&s_cfg, 0, sizeof(s_cfg));
+    s_cfg.ambient = 1.2;
+    s_cfg.led = 0.6;
+    s_cfg.noise = 0.005;
+    s_cfg.waveHz = 1.0;
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", spec ? spec : "");
+    char *save = NULL;
+    for (char *kv = strtok_r(buf, ",", &save); kv; kv = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(kv, '=');
+        if (!eq) {
+            fprintf(stderr, "Sim_enable: expected key=value, got '%s'\n", kv);
+            return false;
+        }
+        *eq = '\0';
+        const char *val = eq + 1;
+        if      (!strcmp(kv, "ambient"))  s_cfg.ambient = atof(val);
+        else if (!strcmp(kv, "led"))      s_cfg.led = atof(val);
+        else if (!strcmp(kv, "noise"))    s_cfg.noise = atof(val);
+        else if (!strcmp(kv, "wave_hz"))  s_cfg.waveHz = atof(val);
+        else if (!strcmp(kv, "wave_amp")) s_cfg.waveAmp = atof(val);
+        else if (!strcmp(kv, "glitch"))   s_cfg.glitch = atof(val);
+        else if (!strcmp(kv, "lag_us"))   s_cfg.lagNs = (long long)(atof(val) * 1000);
+        else if (!strcmp(kv, "wave")) {
+            if      (!strcmp(val, "none"))   s_cfg.wave = WAVE_NONE;
+            else if (!strcmp(val, "sine"))   s_cfg.wave = WAVE_SINE;
+            else if (!strcmp(val, "square")) s_cfg.wave = WAVE_SQUARE;
+            else { fprintf(stderr, "Sim_enable: unknown wave '%s'\n", val); return false; }
+        } else if (!strcmp(kv, "rotary")) {
+            if (!parse_rotary(eq + 1)) {
+                fprintf(stderr, "Sim_enable: bad rotary script\n");
+                return false;
+            }
+        } else {
+            fprintf(stderr, "Sim_enable: unknown key '%s'\n", kv);
+            return false;
+        }
+    }
+
+    s_startNs = getTimeInNs();
+    s_enabled = true;
+    printf("Simulation backend enabled (ambient %.2fV, LED +%.2fV, noise %.3fV)\n",
+           s_cfg.ambient, s_cfg.led, s_cfg.noise);
+    return true;
+}
+
+bool Sim_isEnabled(void)
+{
+    return s_enabled;
+}
+
+// Record a PWM change made now
+static void pwm_update(int field, long long value)
+{
+    pthread_mutex_lock(&s_pwmLock);
+    SimPwmState st = s_pwm[s_pwmNewest];
+    st.atNs = getTimeInNs();
+    if (field == 0) st.periodNs = value;
+    else if (field == 1) st.dutyNs = value;
+    else st.enabled = value != 0;
+    s_pwmNewest = (s_pwmNewest + 1) % SIM_PWM_HISTORY;
+    s_pwm[s_pwmNewest] = st;
+    pthread_mutex_unlock(&s_pwmLock);
+}
+
+bool Sim_ledIsOn(long long timeNs)
+{
+    // Newest PWM state already in effect at timeNs (the oldest kept if none)
+    pthread_mutex_lock(&s_pwmLock);
+    int i = s_pwmNewest;
+    for (int n = 0; n < SIM_PWM_HISTORY - 1 && s_pwm[i].atNs > timeNs; n++) {
+        i = (i + SIM_PWM_HISTORY - 1) % SIM_PWM_HISTORY;
+    }
+    SimPwmState st = s_pwm[i];
+    pthread_mutex_unlock(&s_pwmLock);
+
+    long long period = st.periodNs, duty = st.dutyNs;
+    if (!st.enabled || period <= 0 || duty <= 0) return false;
+    if (duty >= period) return true;
+    long long t = timeNs - s_startNs;
+    return t >= 0 && (t % period) < duty;
+}
+
+int Sim_readAdc(int channel)
+{
+    (void)channel;
+    long long now = getTimeInNs();
+    double t = (now - s_startNs) / 1e9;
+
+    double v = s_cfg.ambient;
+    if (Sim_ledIsOn(now - s_cfg.lagNs)) v += s_cfg.led;
+    switch (s_cfg.wave) {
+    case WAVE_SINE:   v += s_cfg.waveAmp * sin(2.0 * M_PI * s_cfg.waveHz * t); break;
+    case WAVE_SQUARE: v += fmod(t * s_cfg.waveHz, 1.0) < 0.5 ? s_cfg.waveAmp : -s_cfg.waveAmp; break;
+    case WAVE_NONE:   break;
+    }
+    if (s_cfg.noise > 0) v += s_cfg.noise * gaussian();
+    if (s_cfg.glitch > 0 && uniform() < s_cfg.glitch) v = 0.0;  // ADC dropout
+
+    if (v < 0) v = 0;
+    if (v > MAX_VOLTAGE) v = MAX_VOLTAGE;
+    return (int)(v / MAX_VOLTAGE * MAX_ADC_VALUE + 0.5);
+}
+
+void Sim_pwmSetPeriod(long long ns)    { pwm_update(0, ns); }
+void Sim_pwmSetDutyCycle(long long ns) { pwm_update(1, ns); }
+void Sim_pwmSetEnable(bool enabled)    { pwm_update(2, enabled); }
+
+int Sim_readRotaryAB(void)
+{
+    // Gray code sequence for clockwise rotation (see rotary_encoder.c)
+    static const int gray[4] = { 0, 1, 3, 2 };
+
+    double t = (getTimeInNs() - s_startNs) / 1e9;
+    int target = 0;
+    for (int i = 0; i < s_cfg.numRotary; i++) {
+        if (s_cfg.rotary[i].atSec <= t) target += 4 * s_cfg.rotary[i].detents;
+    }
+    if (s_rotaryEdges < target) s_rotaryEdges++;
+    else if (s_rotaryEdges > target) s_rotaryEdges--;
+    return gray[s_rotaryEdges & 3];
+}
@@ -0,0 +1,152 @@
+// startup.c
+// Parallel, timed start-up steps and inotify waits (see startup.h).
+
+#define _GNU_SOURCE
+#include "hal/startup.h"
+#include "hal/timing.h"
+
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+typedef struct {
+    const char *name;
+    long long startNs;
+    long long endNs;
+    bool ok;
+} StepRecord;
+
+static StepRecord s_steps[STARTUP_MAX_STEPS];
+static int s_numSteps = 0;
+
+static void record(const StepRecord *r)
+{
+    if (s_numSteps < STARTUP_MAX_STEPS) s_steps[s_numSteps++] = *r;
+}
+
+bool Startup_run(const char *name, StartupFn fn, void *arg)
+{
+    StepRecord r = { name, getTimeInNs(), 0, false };
+    r.ok = fn(arg);
+    r.endNs = getTimeInNs();
+    record(&r);
+    return r.ok;
+}
+
+typedef struct {
+    const StartupStep *step;
+    StepRecord rec;
+} Worker;
+
+static void* run_worker(void *arg)
+{
+    Worker *w = arg;
+    w->rec.ok = w->step->fn(w->step->arg);
+    w->rec.endNs = getTimeInNs();
+    return NULL;
+}
+
+bool Startup_runParallel(const StartupStep *steps, int n)
+{
+    if (n > STARTUP_MAX_STEPS) n = STARTUP_MAX_STEPS;
+    Worker workers[STARTUP_MAX_STEPS];
+    pthread_t threads[STARTUP_MAX_STEPS];
+    bool started[STARTUP_MAX_STEPS] = { false };
+
+    long long startNs = getTimeInNs();
+    for (int i = 0; i < n; i++) {
+        workers[i] = (Worker){ &steps[i], { steps[i].name, startNs, 0, false } };
+    }
+    for (int i = 1; i < n; i++) {
+        started[i] = pthread_create(&threads[i], NULL, run_worker, &workers[i]) == 0;
+    }
+    // The caller takes the first step, and any whose thread didn't start
+    for (int i = 0; i < n; i++) {
+        if (i == 0 || !started[i]) run_worker(&workers[i]);
+    }
+
+    bool ok = true;
+    for (int i = 0; i < n; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        record(&workers[i].rec);
+        ok = ok && workers[i].rec.ok;
+    }
+    return ok;
+}
+
+void Startup_report(FILE *out)
+{
+    if (s_numSteps == 0) return;
+    long long first = s_steps[0].startNs, last = s_steps[0].endNs;
+    for (int i = 1; i < s_numSteps; i++) {
+        if (s_steps[i].startNs < first) first = s_steps[i].startNs;
+        if (s_steps[i].endNs > last) last = s_steps[i].endNs;
+    }
+    fprintf(out, "Startup took %.1f ms\n", (last - first) / 1e6);
+    for (int i = 0; i < s_numSteps; i++) {
+        const StepRecord *r = &s_steps[i];
+        fprintf(out, "  %-10s %6.1f ms + %6.1f ms%s\n", r->name, (r->startNs - first) / 1e6,
+                (r->endNs - r->startNs) / 1e6, r->ok ? "" : "  FAILED");
+    }
+}
+
+// Deepest existing directory on the way to `path`, into `dir`
+static void existing_parent(const char *path, char *dir, size_t len)
+{
+    snprintf(dir, len, "%s", path);
+    for (;;) {
+        char *slash = strrchr(dir, '/');
+        if (!slash) {
+            snprintf(dir, len, ".");
+            return;
+        }
+        if (slash == dir) {
+            dir[1] = '\0';   // the root
+            return;
+        }
+        *slash = '\0';
+        if (access(dir, F_OK) == 0) return;
+    }
+}
+
+bool Startup_waitForPath(const char *path, int timeoutMs)
+{
+    if (access(path, F_OK) == 0) return true;
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) perror("Startup_waitForPath: inotify_init1");   // fall back to re-checks
+    long long deadlineNs = getTimeInNs() + timeoutMs * 1000000LL;
+    char watched[PATH_MAX] = "";
+    int wd = -1;
+    bool found = false;
+
+    for (;;) {
+        // Move the watch down as directories on the way appear
+        char dir[PATH_MAX];
+        existing_parent(path, dir, sizeof(dir));
+        if (fd >= 0 && strcmp(dir, watched) != 0) {
+            if (wd >= 0) inotify_rm_watch(fd, wd);
+            wd = inotify_add_watch(fd, dir, IN_CREATE | IN_MOVED_TO | IN_ATTRIB);
+            snprintf(watched, sizeof(watched), "%s", dir);
+        }
+        // Checked after the watch is in place, so nothing created in between is missed
+        if (access(path, F_OK) == 0) {
+            found = true;
+            break;
+        }
+        long long leftMs = (deadlineNs - getTimeInNs()) / 1000000LL;
+        if (leftMs <= 0) break;
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int waitMs = leftMs < STARTUP_RECHECK_MS ? (int)leftMs : STARTUP_RECHECK_MS;
+        if (poll(&pfd, fd >= 0 ? 1 : 0, waitMs) > 0) {
+            char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            while (read(fd, events, sizeof(events)) > 0) {}   // only the wakeup matters
+        }
+    }
+    if (fd >= 0) close(fd);
+    return found;
+}
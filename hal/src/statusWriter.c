@@ -0,0 +1,155 @@
+// statusWriter.c
+// Asynchronous console output (see statusWriter.h).
+
+#define _GNU_SOURCE
+#include "hal/statusWriter.h"
+#include "hal/threadConfig.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+typedef struct {
+    int len;
+    char text[STATUS_LINE_MAX];
+} Slot;
+
+static Slot s_slots[STATUS_QUEUE_LEN];
+static atomic_uint s_head;        // next slot the writer takes
+static atomic_uint s_tail;        // next slot the producer publishes
+static Slot s_overflow;           // scratch for an entry that will be dropped
+static Slot *s_building = NULL;   // producer's entry in progress
+static atomic_llong s_dropped;
+
+static int s_fd = -1;
+static int s_wakeFd = -1;
+static pthread_t s_thread;
+static atomic_bool s_running;
+static sem_t s_started;          // posted once the writer thread runs
+
+static void write_all(int fd, const char *p, int len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, p, (size_t)len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;   // nothing useful to do about a broken console
+        }
+        p += n;
+        len -= (int)n;
+    }
+}
+
+static void drain(void)
+{
+    unsigned head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    while (head != atomic_load_explicit(&s_tail, memory_order_acquire)) {
+        Slot *slot = &s_slots[head % STATUS_QUEUE_LEN];
+        write_all(s_fd, slot->text, slot->len);
+        atomic_store_explicit(&s_head, ++head, memory_order_release);
+    }
+}
+
+static void* writer_thread(void *arg)
+{
+    (void)arg;
+    ThreadConfig_applySelf(THREAD_CONSOLE);
+    sem_post(&s_started);
+    while (atomic_load(&s_running)) {
+        uint64_t n;
+        if (read(s_wakeFd, &n, sizeof(n)) < 0 && errno != EINTR) break;
+        drain();
+    }
+    drain();
+    return NULL;
+}
+
+bool StatusWriter_start(int fd)
+{
+    if (atomic_load(&s_running)) return true;
+    s_fd = fd;
+    fflush(stdout);   // keep earlier stdio output ahead of ours
+    s_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (s_wakeFd < 0) {
+        perror("status writer: eventfd");
+        return false;
+    }
+    atomic_store(&s_running, true);
+    sem_init(&s_started, 0, 0);
+    if (pthread_create(&s_thread, NULL, writer_thread, NULL) != 0) {
+        perror("status writer: pthread_create");
+        atomic_store(&s_running, false);
+        close(s_wakeFd);
+        s_wakeFd = -1;
+        return false;
+    }
+    // Its start-up (stack, TLS, scheduling) is over before the caller goes
+    // on, e.g. into Realtime_beginSteadyState()
+    while (sem_wait(&s_started) != 0 && errno == EINTR) {}
+    return true;
+}
+
+static void wake(void)
+{
+    uint64_t one = 1;
+    if (write(s_wakeFd, &one, sizeof(one)) < 0) perror("status writer: wake");
+}
+
+void StatusWriter_stop(void)
+{
+    if (!atomic_load(&s_running)) return;
+    atomic_store(&s_running, false);
+    wake();
+    pthread_join(s_thread, NULL);
+    close(s_wakeFd);
+    s_wakeFd = -1;
+}
+
+void StatusWriter_printf(const char *fmt, ...)
+{
+    if (!s_building) {
+        unsigned tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&s_head, memory_order_acquire);
+        s_building = tail - head < STATUS_QUEUE_LEN ? &s_slots[tail % STATUS_QUEUE_LEN]
+                                                    : &s_overflow;
+        s_building->len = 0;
+    }
+    int room = STATUS_LINE_MAX - s_building->len;
+    if (room <= 1) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(s_building->text + s_building->len, (size_t)room, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    s_building->len += n < room ? n : room - 1;
+}
+
+bool StatusWriter_commit(void)
+{
+    Slot *slot = s_building;
+    s_building = NULL;
+    if (!slot) return true;
+
+    if (!atomic_load(&s_running)) {
+        write_all(s_fd >= 0 ? s_fd : STDOUT_FILENO, slot->text, slot->len);
+        return true;
+    }
+    if (slot == &s_overflow) {
+        atomic_fetch_add(&s_dropped, 1);
+        return false;
+    }
+    atomic_fetch_add_explicit(&s_tail, 1, memory_order_release);
+    wake();
+    return true;
+}
+
+long long StatusWriter_dropped(void)
+{
+    return atomic_load(&s_dropped);
+}
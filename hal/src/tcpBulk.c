@@ -0,0 +1,265 @@
+// tcpBulk.c
+// TCP bulk-transfer channel (see tcpBulk.h).
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "hal/tcpBulk.h"
+#include "hal/historyCache.h"
+#include "hal/tcpServer.h"
+#include "hal/metrics.h"
+
+#define MAX_CLIENTS   64
+#define MAX_QUEUED    16      // replies queued per client before we stop reading
+#define MAX_IOV       16      // reply chunks handed to one sendmsg()
+#define LINE_MAX_LEN  128
+#define INLINE_MAX    160     // short text replies are copied, not referenced
+
+// One queued reply: either a reference into a shared history blob or a
+// short message copied inline.
+typedef struct {
+    const HistoryBlob *blob;
+    const char *ptr;
+    int len;
+    char text[INLINE_MAX];
+} OutItem;
+
+typedef struct {
+    int fd;                        // -1 when the slot is free
+    char in[LINE_MAX_LEN * 4];     // received bytes not yet run as commands
+    int inLen;
+    bool peerClosed;               // peer finished sending; flush then close
+    OutItem q[MAX_QUEUED];
+    int qHead, qCount;
+    int sentInHead;                // bytes of q[qHead] already written
+    bool reading;                  // EPOLLIN enabled
+    bool writing;                  // EPOLLOUT enabled
+} Client;
+
+static TcpServer s_server;
+static Client    s_clients[MAX_CLIENTS];
+static Metric   *s_mBytesSent, *s_mClients;
+
+static void update_events(int idx)
+{
+    Client *c = &s_clients[idx];
+    bool wantRead = c->qCount < MAX_QUEUED && !c->peerClosed;
+    bool wantWrite = c->qCount > 0;
+    if (wantRead == c->reading && wantWrite == c->writing) return;
+
+    uint32_t events = 0;
+    if (wantRead)  events |= EPOLLIN | EPOLLRDHUP;
+    if (wantWrite) events |= EPOLLOUT;
+    TcpServer_setEvents(&s_server, c->fd, (uint32_t)idx, events);
+    c->reading = wantRead;
+    c->writing = wantWrite;
+}
+
+static void drop_client(int idx)
+{
+    Client *c = &s_clients[idx];
+    if (c->fd < 0) return;
+    TcpServer_closeClient(&s_server, c->fd);
+    for (int i = 0; i < c->qCount; i++) {
+        HistoryCache_release(c->q[(c->qHead + i) % MAX_QUEUED].blob);
+    }
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+static OutItem* push_item(Client *c)
+{
+    OutItem *it = &c->q[(c->qHead + c->qCount) % MAX_QUEUED];
+    c->qCount++;
+    memset(it, 0, sizeof(*it));
+    return it;
+}
+
+static void queue_text(Client *c, const char *msg)
+{
+    OutItem *it = push_item(c);
+    it->len = (int)strlen(msg);
+    if (it->len > INLINE_MAX) it->len = INLINE_MAX;
+    memcpy(it->text, msg, it->len);
+    it->ptr = it->text;
+}
+
+static void queue_history(Client *c, HistoryEncoding enc)
+{
+    const HistoryBlob *h = HistoryCache_get(enc);
+    if (!h) {
+        queue_text(c, "(no history)\n");
+        return;
+    }
+    OutItem *it = push_item(c);
+    it->blob = h;
+    it->ptr = h->data;
+    it->len = h->len;
+}
+
+static void handle_line(Client *c, char *s)
+{
+    // Trim CR and surrounding blanks
+    while (*s == ' ' || *s == '\t') s++;
+    for (int i = (int)strlen(s) - 1; i >= 0 && (s[i]=='\r'||s[i]==' '||s[i]=='\t'); --i) s[i] = '\0';
+    if (s[0] == '\0') return;
+
+    if (!strcmp(s, "history")) {
+        queue_history(c, HISTORY_TEXT);
+    } else if (!strcmp(s, "history_bin")) {
+        queue_history(c, HISTORY_BIN);
+    } else if (!strcmp(s, "help") || !strcmp(s, "?")) {
+        queue_text(c,
+            "TCP bulk commands:\n"
+            "history     -- all samples of the previous second as text.\n"
+            "history_bin -- same as HBIN header + 16-bit millivolts.\n");
+    } else {
+        queue_text(c, "Unknown command\n");
+    }
+}
+
+// Write as much of the queue as the socket takes. Returns false if the
+// client went away.
+static bool flush_client(Client *c)
+{
+    while (c->qCount > 0) {
+        struct iovec iov[MAX_IOV];
+        int n = 0;
+        size_t want = 0;
+        for (int i = 0; i < c->qCount && n < MAX_IOV; i++) {
+            OutItem *it = &c->q[(c->qHead + i) % MAX_QUEUED];
+            int skip = (i == 0) ? c->sentInHead : 0;
+            iov[n].iov_base = (void*)(it->ptr + skip);
+            iov[n].iov_len = (size_t)(it->len - skip);
+            want += iov[n].iov_len;
+            n++;
+        }
+
+        // sendmsg() is writev() plus MSG_NOSIGNAL, so a vanished peer
+        // doesn't raise SIGPIPE in the whole process.
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)n };
+        ssize_t sent = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        Metrics_add(s_mBytesSent, (uint64_t)sent);
+
+        // Retire whatever was fully written
+        size_t done = (size_t)sent;
+        while (done > 0) {
+            OutItem *it = &c->q[c->qHead];
+            size_t left = (size_t)(it->len - c->sentInHead);
+            if (done < left) {
+                c->sentInHead += (int)done;
+                break;
+            }
+            done -= left;
+            HistoryCache_release(it->blob);
+            c->qHead = (c->qHead + 1) % MAX_QUEUED;
+            c->qCount--;
+            c->sentInHead = 0;
+        }
+        if ((size_t)sent < want) return true;  // socket buffer is full
+    }
+    return true;
+}
+
+// Run complete command lines while there is room to queue their replies.
+static void run_lines(Client *c)
+{
+    int start = 0;
+    for (int i = 0; i < c->inLen && c->qCount < MAX_QUEUED; i++) {
+        if (c->in[i] != '\n') continue;
+        c->in[i] = '\0';
+        if (i - start < LINE_MAX_LEN) handle_line(c, c->in + start);
+        start = i + 1;
+    }
+    // An overlong line with no newline in sight is discarded
+    if (start == 0 && c->inLen == (int)sizeof(c->in)) start = c->inLen;
+    memmove(c->in, c->in + start, c->inLen - start);
+    c->inLen -= start;
+}
+
+// Read and run commands until the socket is empty or the queue is full.
+// Returns false on a socket error.
+static bool read_client(Client *c)
+{
+    run_lines(c);
+    while (c->qCount < MAX_QUEUED && !c->peerClosed) {
+        ssize_t n = recv(c->fd, c->in + c->inLen, sizeof(c->in) - c->inLen, MSG_DONTWAIT);
+        if (n == 0) {
+            c->peerClosed = true;
+        } else if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        } else {
+            c->inLen += (int)n;
+        }
+        run_lines(c);
+    }
+    return true;
+}
+
+static bool on_accept(TcpServer *srv, int fd)
+{
+    int idx = -1;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (s_clients[i].fd < 0) { idx = i; break; }
+    }
+    if (idx < 0 || !TcpServer_addClient(srv, fd, (uint32_t)idx)) return false;
+
+    Client *c = &s_clients[idx];
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->reading = true;
+    Metrics_inc(s_mClients);
+    return true;
+}
+
+static void on_events(TcpServer *srv, uint32_t tag, uint32_t ev)
+{
+    (void)srv;
+    Client *c = &s_clients[tag];
+    if (c->fd < 0) return;
+    bool ok = !(ev & (EPOLLERR | EPOLLHUP));
+    if (ok) ok = read_client(c);   // also resumes parked input
+    if (ok) ok = flush_client(c);
+    if (ok && c->peerClosed && c->qCount == 0) ok = false;
+    if (ok) update_events((int)tag);
+    else    drop_client((int)tag);
+}
+
+static void on_stop(TcpServer *srv)
+{
+    (void)srv;
+    for (int i = 0; i < MAX_CLIENTS; i++) drop_client(i);
+}
+
+int tcp_bulk_start(uint16_t port, UdpCallbacks cb)
+{
+    if (TcpServer_isRunning(&s_server)) return 0;
+    HistoryCache_setSource(cb.get_history, cb.get_history_seq);
+    s_mBytesSent = Metrics_counter("tcp_bytes_sent_total", "Bytes sent on the TCP bulk channel.");
+    s_mClients = Metrics_counter("tcp_connections_total", "TCP bulk connections accepted.");
+    for (int i = 0; i < MAX_CLIENTS; i++) s_clients[i].fd = -1;
+
+    static const TcpServerConfig cfg = {
+        .name = "tcp_bulk", .thread = THREAD_TCP, .backlog = 16,
+        .onAccept = on_accept, .onEvents = on_events, .onStop = on_stop,
+    };
+    return TcpServer_start(&s_server, &cfg, port);
+}
+
+void tcp_bulk_stop(void)
+{
+    TcpServer_stop(&s_server);
+}
@@ -0,0 +1,171 @@
+// tcpServer.c
+// Listening TCP socket served by a thread or the reactor (see tcpServer.h).
+
+#define _GNU_SOURCE
+#include "hal/tcpServer.h"
+#include "hal/reactor.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 32
+
+static void accept_clients(TcpServer *s)
+{
+    for (;;) {
+        int fd = accept4(s->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (!s->cfg.onAccept(s, fd)) close(fd);   // busy: the client retries
+    }
+}
+
+// Wait up to `timeoutMs` for socket events and serve them.
+// Returns false if epoll itself failed.
+static bool serve_events(TcpServer *s, int timeoutMs)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(s->epollFd, events, MAX_EVENTS, timeoutMs);
+    if (n < 0) {
+        if (errno == EINTR) return true;
+        fprintf(stderr, "%s: epoll_wait: %s\n", s->cfg.name, strerror(errno));
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        uint32_t tag = events[i].data.u32;
+        if (tag == TCP_SERVER_TAG_WAKE) continue;   // TcpServer_stop(): `running` says the rest
+        if (tag == TCP_SERVER_TAG_LISTEN) {
+            accept_clients(s);
+            continue;
+        }
+        s->cfg.onEvents(s, tag, events[i].events);
+    }
+    return true;
+}
+
+static void* server_thread(void *arg)
+{
+    TcpServer *s = arg;
+    ThreadConfig_applySelf(s->cfg.thread);
+    while (atomic_load(&s->running)) {
+        if (!serve_events(s, -1)) break;
+    }
+    return NULL;
+}
+
+// Reactor mode: our epoll fd is itself readable whenever a socket is ready.
+static void on_ready(int fd, uint32_t events, void *arg)
+{
+    (void)fd; (void)events;
+    serve_events(arg, 0);
+}
+
+static void close_sockets(TcpServer *s)
+{
+    if (s->listenFd >= 0) { close(s->listenFd); s->listenFd = -1; }
+    if (s->wakeFd >= 0)   { close(s->wakeFd);   s->wakeFd = -1; }
+    if (s->epollFd >= 0)  { close(s->epollFd);  s->epollFd = -1; }
+}
+
+int TcpServer_start(TcpServer *s, const TcpServerConfig *cfg, uint16_t port)
+{
+    if (atomic_load(&s->running)) return 0;
+    memset(s, 0, sizeof(*s));
+    s->cfg = *cfg;
+    s->listenFd = s->epollFd = s->wakeFd = -1;
+
+    s->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s->listenFd < 0) {
+        fprintf(stderr, "%s: socket: %s\n", cfg->name, strerror(errno));
+        return -1;
+    }
+    int yes = 1; setsockopt(s->listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in srv = {0};
+    srv.sin_family = AF_INET;
+    srv.sin_addr.s_addr = htonl(INADDR_ANY);
+    srv.sin_port = htons(port);
+    if (bind(s->listenFd, (struct sockaddr*)&srv, sizeof(srv)) < 0 ||
+        listen(s->listenFd, cfg->backlog) < 0) {
+        fprintf(stderr, "%s: bind/listen: %s\n", cfg->name, strerror(errno));
+        close_sockets(s);
+        return -1;
+    }
+
+    s->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    s->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event lev = { .events = EPOLLIN, .data.u32 = TCP_SERVER_TAG_LISTEN };
+    struct epoll_event wev = { .events = EPOLLIN, .data.u32 = TCP_SERVER_TAG_WAKE };
+    if (s->epollFd < 0 || s->wakeFd < 0 ||
+        epoll_ctl(s->epollFd, EPOLL_CTL_ADD, s->listenFd, &lev) < 0 ||
+        epoll_ctl(s->epollFd, EPOLL_CTL_ADD, s->wakeFd, &wev) < 0) {
+        fprintf(stderr, "%s: epoll: %s\n", cfg->name, strerror(errno));
+        close_sockets(s);
+        return -1;
+    }
+
+    if (Reactor_isActive()) {
+        if (Reactor_addFd(s->epollFd, EPOLLIN, on_ready, s) < 0) {
+            close_sockets(s);
+            return -1;
+        }
+        s->attached = true;
+        atomic_store(&s->running, true);
+        return 0;
+    }
+    atomic_store(&s->running, true);
+    if (pthread_create(&s->thread, NULL, server_thread, s) != 0) {
+        fprintf(stderr, "%s: pthread_create failed\n", cfg->name);
+        atomic_store(&s->running, false);
+        close_sockets(s);
+        return -1;
+    }
+    return 0;
+}
+
+bool TcpServer_isRunning(const TcpServer *s)
+{
+    return atomic_load(&s->running);
+}
+
+void TcpServer_stop(TcpServer *s)
+{
+    if (!atomic_load(&s->running)) return;
+    atomic_store(&s->running, false);
+    if (s->attached) {
+        Reactor_removeFd(s->epollFd);
+        s->attached = false;
+    } else {
+        uint64_t one = 1;
+        if (write(s->wakeFd, &one, sizeof(one)) < 0) {
+            fprintf(stderr, "%s: wake: %s\n", s->cfg.name, strerror(errno));
+        }
+        pthread_join(s->thread, NULL);
+    }
+    if (s->cfg.onStop) s->cfg.onStop(s);
+    close_sockets(s);
+}
+
+bool TcpServer_addClient(TcpServer *s, int fd, uint32_t tag)
+{
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.u32 = tag };
+    return tag < TCP_SERVER_TAG_LISTEN && epoll_ctl(s->epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+void TcpServer_setEvents(TcpServer *s, int fd, uint32_t tag, uint32_t events)
+{
+    struct epoll_event ev = { .events = events, .data.u32 = tag };
+    epoll_ctl(s->epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void TcpServer_closeClient(TcpServer *s, int fd)
+{
+    epoll_ctl(s->epollFd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+}
@@ -0,0 +1,189 @@
+// threadConfig.c
+// Per-thread CPU affinity and scheduling policy (see threadConfig.h).
+
+#define _GNU_SOURCE
+#include "hal/threadConfig.h"
+#include "hal/realtime.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *s_names[THREAD_COUNT] = {
+    "sampler", "rotary", "udp", "tcp", "recorder", "main", "console", "metrics",
+    "pwm"
+};
+
+static ThreadState s_state[THREAD_COUNT];
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+
+// Nothing requested: any CPU, default policy; the console writer only
+// runs when nothing else wants the CPU
+static ThreadSettings default_settings(int which)
+{
+    int policy = which == THREAD_CONSOLE ? SCHED_IDLE : SCHED_OTHER;
+    return (ThreadSettings){ -1, policy, 0 };
+}
+
+static void init_state(void)
+{
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        s_state[i].requested = s_state[i].applied = default_settings(i);
+    }
+}
+
+static const char *policy_name(int policy)
+{
+    switch (policy) {
+    case SCHED_FIFO: return "fifo";
+    case SCHED_RR:   return "rr";
+    case SCHED_IDLE: return "idle";
+    default:         return "other";
+    }
+}
+
+const char *ThreadConfig_name(HalThread which)
+{
+    return which < THREAD_COUNT ? s_names[which] : "?";
+}
+
+static bool parse_setting(const char *s, ThreadSettings *t)
+{
+    char *end;
+    if (!strncmp(s, "cpu", 3)) {
+        long cpu = strtol(s + 3, &end, 10);
+        if (end == s + 3 || *end || cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        t->cpu = (int)cpu;
+    } else if (!strcmp(s, "other") || !strcmp(s, "idle")) {
+        t->policy = s[0] == 'o' ? SCHED_OTHER : SCHED_IDLE;
+        t->priority = 0;
+    } else if (!strncmp(s, "fifo", 4) || !strncmp(s, "rr", 2)) {
+        const char *num = s + (s[0] == 'f' ? 4 : 2);
+        long prio = strtol(num, &end, 10);
+        if (end == num || *end || prio < 1 || prio > 99) return false;
+        t->policy = s[0] == 'f' ? SCHED_FIFO : SCHED_RR;
+        t->priority = (int)prio;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ThreadConfig_parse(const char *spec)
+{
+    ThreadSettings req[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; i++) req[i] = default_settings(i);
+
+    char buf[256];
+    if (strlen(spec) >= sizeof(buf)) return false;
+    strcpy(buf, spec);
+    for (char *save1, *item = strtok_r(buf, ",", &save1); item; item = strtok_r(NULL, ",", &save1)) {
+        char *eq = strchr(item, '=');
+        if (!eq) return false;
+        *eq = '\0';
+        int which = -1;
+        for (int i = 0; i < THREAD_COUNT; i++) {
+            if (!strcmp(item, s_names[i])) which = i;
+        }
+        if (which < 0) return false;
+        for (char *save2, *set = strtok_r(eq + 1, ":", &save2); set; set = strtok_r(NULL, ":", &save2)) {
+            if (!parse_setting(set, &req[which])) return false;
+        }
+    }
+    for (int i = 0; i < THREAD_COUNT; i++) ThreadConfig_set(i, req[i]);
+    return true;
+}
+
+void ThreadConfig_set(HalThread which, ThreadSettings settings)
+{
+    if (which >= THREAD_COUNT) return;
+    pthread_once(&s_once, init_state);
+    pthread_mutex_lock(&s_lock);
+    s_state[which].requested = settings;
+    pthread_mutex_unlock(&s_lock);
+}
+
+bool ThreadConfig_applySelf(HalThread which)
+{
+    if (which >= THREAD_COUNT) return false;
+    pthread_setname_np(pthread_self(), s_names[which]);
+    if (Realtime_isEnabled()) Realtime_prefaultStack(REALTIME_STACK_PREFAULT);
+    pthread_once(&s_once, init_state);
+
+    pthread_mutex_lock(&s_lock);
+    ThreadSettings req = s_state[which].requested;
+    pthread_mutex_unlock(&s_lock);
+
+    ThreadSettings got = { -1, SCHED_OTHER, 0 };
+    bool ok = true;
+    int err = 0;
+
+    if (req.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(req.cpu, &set);
+        err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err == 0) {
+            got.cpu = req.cpu;
+        } else {
+            fprintf(stderr, "thread %s: cpu%d refused: %s\n", s_names[which], req.cpu, strerror(err));
+            ok = false;
+        }
+    }
+    struct sched_param sp = { .sched_priority = req.priority };
+    err = pthread_setschedparam(pthread_self(), req.policy, &sp);
+    if (err != 0) {
+        fprintf(stderr, "thread %s: %s%d refused: %s\n", s_names[which],
+                policy_name(req.policy), req.priority, strerror(err));
+        ok = false;
+    }
+    // Record what is really in effect rather than what we asked for
+    int policy;
+    if (pthread_getschedparam(pthread_self(), &policy, &sp) == 0) {
+        got.policy = policy;
+        got.priority = sp.sched_priority;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    s_state[which].started = true;
+    s_state[which].applied = got;
+    s_state[which].tid = (int)syscall(SYS_gettid);
+    pthread_mutex_unlock(&s_lock);
+    return ok;
+}
+
+ThreadState ThreadConfig_get(HalThread which)
+{
+    ThreadState st = {0};
+    if (which >= THREAD_COUNT) return st;
+    pthread_once(&s_once, init_state);
+    pthread_mutex_lock(&s_lock);
+    st = s_state[which];
+    pthread_mutex_unlock(&s_lock);
+    return st;
+}
+
+static void format_settings(char *buf, size_t len, const ThreadSettings *t)
+{
+    char cpu[16] = "any";
+    if (t->cpu >= 0) snprintf(cpu, sizeof(cpu), "%d", t->cpu);
+    snprintf(buf, len, "cpu %-3s %s %d", cpu, policy_name(t->policy), t->priority);
+}
+
+void ThreadConfig_report(FILE *f)
+{
+    fprintf(f, "%-9s %6s  %-18s %s\n", "thread", "tid", "requested", "applied");
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        ThreadState st = ThreadConfig_get(i);
+        if (!st.started) continue;
+        char req[40], got[40];
+        format_settings(req, sizeof(req), &st.requested);
+        format_settings(got, sizeof(got), &st.applied);
+        fprintf(f, "%-9s %6d  %-18s %s\n", s_names[i], st.tid, req, got);
+    }
+}
@@ -0,0 +1,120 @@
+// threadStats.c
+// Per-thread CPU and scheduling statistics (see threadStats.h).
+
+#define _GNU_SOURCE
+#include "hal/threadStats.h"
+#include "hal/timing.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Read a small /proc file into buf (NUL-terminated). Returns false if absent.
+static bool read_proc(int tid, const char *file, char *buf, size_t len)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/%s", tid, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ssize_t n = read(fd, buf, len - 1);
+    close(fd);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    return true;
+}
+
+// utime and stime are fields 14 and 15; the name in field 2 may hold
+// spaces or parentheses, so count from its closing ')'.
+static bool parse_stat(const char *buf, ThreadCounters *c)
+{
+    const char *p = strrchr(buf, ')');
+    if (!p) return false;
+    p++;
+    for (int field = 3; field <= 15; field++) {
+        char *end;
+        while (*p == ' ') p++;
+        if (field == 3) {            // state letter
+            p++;
+            continue;
+        }
+        long long v = strtoll(p, &end, 10);
+        if (end == p) return false;
+        if (field == 14) c->userTicks = v;
+        if (field == 15) c->sysTicks = v;
+        p = end;
+    }
+    return true;
+}
+
+static long long status_value(const char *buf, const char *key)
+{
+    const char *p = strstr(buf, key);
+    return p ? strtoll(p + strlen(key), NULL, 10) : 0;
+}
+
+void ThreadStats_sample(ThreadStatsSnapshot *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+    snap->timeNs = getTimeInNs();
+    char buf[2048];
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        ThreadState st = ThreadConfig_get(i);
+        ThreadCounters *c = &snap->t[i];
+        if (!st.started || st.tid <= 0) continue;
+        c->tid = st.tid;
+        if (!read_proc(st.tid, "stat", buf, sizeof(buf)) || !parse_stat(buf, c)) continue;
+        if (read_proc(st.tid, "schedstat", buf, sizeof(buf))) {
+            sscanf(buf, "%lld %lld %lld", &c->cpuNs, &c->runDelayNs, &c->runs);
+        }
+        if (read_proc(st.tid, "status", buf, sizeof(buf))) {
+            c->volSwitches = status_value(buf, "\nvoluntary_ctxt_switches:");
+            c->involSwitches = status_value(buf, "\nnonvoluntary_ctxt_switches:");
+        }
+        c->valid = true;
+    }
+}
+
+void ThreadStats_diff(const ThreadStatsSnapshot *prev, const ThreadStatsSnapshot *cur,
+                      HalThread which, ThreadPerf *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (which >= THREAD_COUNT) return;
+    const ThreadCounters *a = &prev->t[which], *b = &cur->t[which];
+    double secs = (cur->timeNs - prev->timeNs) / 1e9;
+    if (!a->valid || !b->valid || a->tid != b->tid || secs <= 0) return;
+
+    static long ticksPerSec = 0;
+    if (ticksPerSec == 0) ticksPerSec = sysconf(_SC_CLK_TCK);
+    double tick = ticksPerSec > 0 ? 1.0 / ticksPerSec : 0.01;
+
+    out->valid = true;
+    out->userPct = 100.0 * (b->userTicks - a->userTicks) * tick / secs;
+    out->sysPct = 100.0 * (b->sysTicks - a->sysTicks) * tick / secs;
+    // schedstat's ns counter is far finer than ticks; use it when present
+    out->cpuPct = b->cpuNs > 0 ? 100.0 * (b->cpuNs - a->cpuNs) / 1e9 / secs
+                               : out->userPct + out->sysPct;
+    out->volPerSec = (b->volSwitches - a->volSwitches) / secs;
+    out->involPerSec = (b->involSwitches - a->involSwitches) / secs;
+    out->waitPct = 100.0 * (b->runDelayNs - a->runDelayNs) / 1e9 / secs;
+    long long runs = b->runs - a->runs;
+    out->avgWaitUs = runs > 0 ? (b->runDelayNs - a->runDelayNs) / 1e3 / runs : 0;
+}
+
+int ThreadStats_format(const ThreadStatsSnapshot *prev, const ThreadStatsSnapshot *cur,
+                       char *buf, int len)
+{
+    int used = snprintf(buf, len, "%-9s %6s %6s %6s %6s %8s %8s %6s %8s\n", "thread", "tid",
+                        "cpu%", "usr%", "sys%", "vcs/s", "ivcs/s", "wait%", "wait_us");
+    for (int i = 0; i < THREAD_COUNT && used < len; i++) {
+        ThreadPerf p;
+        ThreadStats_diff(prev, cur, i, &p);
+        if (!p.valid) continue;
+        used += snprintf(buf + used, len - used,
+                         "%-9s %6d %6.1f %6.1f %6.1f %8.1f %8.1f %6.2f %8.1f\n",
+                         ThreadConfig_name(i), cur->t[i].tid, p.cpuPct, p.userPct, p.sysPct,
+                         p.volPerSec, p.involPerSec, p.waitPct, p.avgWaitUs);
+    }
+    return used < len ? used : len - 1;
+}
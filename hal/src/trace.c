@@ -0,0 +1,218 @@
+// trace.c
+// Per-thread trace rings and Chrome trace export (see trace.h).
+
+#define _GNU_SOURCE
+#include "hal/trace.h"
+#include "hal/timing.h"
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define PHASE_END  (1ULL << 63)   // top bit of the timestamp: 'E', else 'B'
+
+typedef struct {
+    uint64_t ns;                  // getTimeInNs(), PHASE_END for end events
+    const char *name;
+} TraceEvent;
+
+typedef struct {
+    atomic_ulong head;            // events ever written; owner thread only
+    pid_t tid;
+    TraceEvent *events;
+} TraceRing;
+
+static bool s_enabled = false;
+static unsigned s_events = 0;     // per ring, power of two
+static TraceEvent *s_pool = NULL;
+static size_t s_poolSize = 0;
+static TraceRing s_rings[TRACE_MAX_THREADS];
+static atomic_int s_numRings;
+static char s_path[256] = TRACE_DEFAULT_PATH;
+static atomic_flag s_dumping = ATOMIC_FLAG_INIT;
+
+static __thread TraceRing *t_ring = NULL;
+static __thread bool t_noRing = false;   // all rings taken
+
+bool Trace_enable(unsigned eventsPerThread, const char *path)
+{
+    if (s_enabled) return true;
+    if (eventsPerThread == 0) eventsPerThread = TRACE_DEFAULT_EVENTS;
+    unsigned n = 1;
+    while (n < eventsPerThread) n <<= 1;
+
+    s_poolSize = (size_t)n * TRACE_MAX_THREADS * sizeof(TraceEvent);
+    s_pool = mmap(NULL, s_poolSize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (s_pool == MAP_FAILED) {
+        perror("trace: mmap");
+        s_pool = NULL;
+        return false;
+    }
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        s_rings[i].events = s_pool + (size_t)i * n;
+    }
+    if (path) snprintf(s_path, sizeof(s_path), "%s", path);
+    s_events = n;
+    s_enabled = true;
+    return true;
+}
+
+bool Trace_isEnabled(void)
+{
+    return s_enabled;
+}
+
+const char* Trace_defaultPath(void)
+{
+    return s_path;
+}
+
+static TraceRing* claim_ring(void)
+{
+    if (t_noRing) return NULL;
+    int i = atomic_fetch_add(&s_numRings, 1);
+    if (i >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub(&s_numRings, 1);
+        t_noRing = true;
+        return NULL;
+    }
+    s_rings[i].tid = gettid();
+    t_ring = &s_rings[i];
+    return t_ring;
+}
+
+static inline void record(const char *name, uint64_t phase)
+{
+    TraceRing *ring = t_ring ? t_ring : claim_ring();
+    if (!ring) return;
+    uint64_t now = (uint64_t)getTimeInNs();
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    TraceEvent *ev = &ring->events[head & (s_events - 1)];
+    ev->ns = now | phase;
+    ev->name = name;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void Trace_begin(const char *name)
+{
+    if (s_enabled) record(name, 0);
+}
+
+void Trace_end(const char *name)
+{
+    if (s_enabled) record(name, PHASE_END);
+}
+
+// Buffered writes to the dump file (no stdio, so no heap)
+typedef struct {
+    int fd;
+    int len;
+    bool failed;
+    char buf[16384];
+} DumpOut;
+
+static void out_flush(DumpOut *o)
+{
+    const char *p = o->buf;
+    while (o->len > 0 && !o->failed) {
+        ssize_t n = write(o->fd, p, (size_t)o->len);
+        if (n < 0) { o->failed = true; break; }
+        p += n;
+        o->len -= (int)n;
+    }
+    o->len = 0;
+}
+
+static void out_printf(DumpOut *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void out_printf(DumpOut *o, const char *fmt, ...)
+{
+    if ((size_t)o->len + 256 > sizeof(o->buf)) out_flush(o);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, sizeof(o->buf) - (size_t)o->len, fmt, ap);
+    va_end(ap);
+    if (n > 0 && (size_t)n < sizeof(o->buf) - (size_t)o->len) o->len += n;
+}
+
+static void thread_name(pid_t tid, char *name, size_t len)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/comm", (int)tid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t n = fd >= 0 ? read(fd, name, len - 1) : -1;
+    if (fd >= 0) close(fd);
+    if (n <= 0) {
+        snprintf(name, len, "tid %d", (int)tid);   // thread has exited
+        return;
+    }
+    name[n] = '\0';
+    name[strcspn(name, "\n\"\\")] = '\0';
+}
+
+long Trace_dump(const char *path)
+{
+    if (!s_enabled) return -1;
+    if (!path) path = s_path;
+    static DumpOut out;   // kept off the caller's stack
+    if (atomic_flag_test_and_set(&s_dumping)) return -1;   // one dump at a time
+    out.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out.fd < 0) {
+        atomic_flag_clear(&s_dumping);
+        return -1;
+    }
+    out.len = 0;
+    out.failed = false;
+
+    int pid = (int)getpid();
+    long written = 0;
+    out_printf(&out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int rings = atomic_load(&s_numRings);
+    if (rings > TRACE_MAX_THREADS) rings = TRACE_MAX_THREADS;
+    for (int r = 0; r < rings; r++) {
+        TraceRing *ring = &s_rings[r];
+        char name[32];
+        thread_name(ring->tid, name, sizeof(name));
+        out_printf(&out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                   "\"args\":{\"name\":\"%s\"}}",
+                   r ? ",\n" : "", pid, (int)ring->tid, name);
+
+        unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned long first = head > s_events ? head - s_events : 0;
+        int depth = 0;   // drop ends whose begin was already overwritten
+        for (unsigned long i = first; i < head; i++) {
+            TraceEvent ev = ring->events[i & (s_events - 1)];
+            atomic_thread_fence(memory_order_acquire);
+            // The owner may have lapped us while we copied this one
+            if (atomic_load_explicit(&ring->head, memory_order_relaxed) - i >= s_events) continue;
+            bool end = ev.ns & PHASE_END;
+            if (end && depth == 0) continue;
+            depth += end ? -1 : 1;
+            uint64_t ns = ev.ns & ~PHASE_END;
+            out_printf(&out, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,"
+                       "\"pid\":%d,\"tid\":%d}",
+                       ev.name, end ? 'E' : 'B', (unsigned long long)(ns / 1000),
+                       (unsigned)(ns % 1000), pid, (int)ring->tid);
+            written++;
+        }
+    }
+    out_printf(&out, "\n]}\n");
+    out_flush(&out);
+    bool failed = out.failed;
+    if (close(out.fd) < 0) failed = true;
+    atomic_flag_clear(&s_dumping);
+    return failed ? -1 : written;
+}
+
+void Trace_cleanup(void)
+{
+    if (!s_enabled) return;
+    s_enabled = false;
+    munmap(s_pool, s_poolSize);
+    s_pool = NULL;
+}
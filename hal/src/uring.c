@@ -0,0 +1,222 @@
+// uring.c
+// Minimal io_uring wrapper (see uring.h).
+
+#define _GNU_SOURCE
+#include "hal/uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static bool s_enabled = false;
+
+void Uring_enable(void)
+{
+    s_enabled = true;
+}
+
+bool Uring_isEnabled(void)
+{
+    return s_enabled;
+}
+
+static int sys_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int sys_register(int fd, unsigned op, const void *arg, unsigned nr)
+{
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+bool Uring_init(Uring *r, unsigned entries, unsigned cqEntries)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if (cqEntries > 0) {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = cqEntries;
+    }
+    int fd = sys_setup(entries, &p);
+    if (fd < 0) return false;
+    r->fd = fd;
+
+    r->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && r->cqRingSize > r->sqRingSize) r->sqRingSize = r->cqRingSize;
+
+    r->sqRing = mmap(NULL, r->sqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sqRing == MAP_FAILED) { r->sqRing = NULL; goto fail; }
+    if (single) {
+        r->cqRing = r->sqRing;
+    } else {
+        r->cqRing = mmap(NULL, r->cqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (r->cqRing == MAP_FAILED) { r->cqRing = NULL; goto fail; }
+    }
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) { r->sqes = NULL; goto fail; }
+
+    char *sq = r->sqRing, *cq = r->cqRing;
+    r->sqHead  = (unsigned *)(sq + p.sq_off.head);
+    r->sqTail  = (unsigned *)(sq + p.sq_off.tail);
+    r->sqMask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sqArray = (unsigned *)(sq + p.sq_off.array);
+    r->sqEntries = p.sq_entries;
+    r->sqLocalTail = *r->sqTail;
+    r->cqHead  = (unsigned *)(cq + p.cq_off.head);
+    r->cqTail  = (unsigned *)(cq + p.cq_off.tail);
+    r->cqMask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes    = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return true;
+
+fail:;
+    int err = errno;
+    Uring_cleanup(r);
+    errno = err;
+    return false;
+}
+
+void Uring_cleanup(Uring *r)
+{
+    if (r->sqes) munmap(r->sqes, r->sqesSize);
+    if (r->cqRing && r->cqRing != r->sqRing) munmap(r->cqRing, r->cqRingSize);
+    if (r->sqRing) munmap(r->sqRing, r->sqRingSize);
+    if (r->fd >= 0) close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+struct io_uring_sqe* Uring_getSqe(Uring *r)
+{
+    unsigned head = __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+    if (r->sqLocalTail - head >= r->sqEntries) return NULL;
+    unsigned idx = r->sqLocalTail & *r->sqMask;
+    r->sqArray[idx] = idx;
+    r->sqLocalTail++;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int Uring_submit(Uring *r, unsigned waitFor)
+{
+    unsigned pending = r->sqLocalTail - *r->sqTail;
+    __atomic_store_n(r->sqTail, r->sqLocalTail, __ATOMIC_RELEASE);
+    unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int rc;
+    do {
+        r->enterCalls++;
+        rc = sys_enter(r->fd, pending, waitFor, flags);
+    } while (rc < 0 && errno == EINTR);
+    int result = rc < 0 ? -errno : rc;
+
+    // Without SQPOLL the kernel only reads the queue inside io_uring_enter(),
+    // so whatever it didn't take (an SQE that failed prep ends the batch)
+    // can be withdrawn instead of going out with some later submit.
+    unsigned head = __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+    if (head != r->sqLocalTail) {
+        __atomic_store_n(r->sqTail, head, __ATOMIC_RELEASE);
+        r->sqLocalTail = head;
+    }
+    return result;
+}
+
+struct io_uring_cqe* Uring_peekCqe(Uring *r)
+{
+    unsigned head = *r->cqHead;
+    if (head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) return NULL;
+    return &r->cqes[head & *r->cqMask];
+}
+
+void Uring_cqeSeen(Uring *r)
+{
+    __atomic_store_n(r->cqHead, *r->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+int Uring_registerFiles(Uring *r, const int *fds, unsigned count)
+{
+    return sys_register(r->fd, IORING_REGISTER_FILES, fds, count) < 0 ? -errno : 0;
+}
+
+int Uring_registerBuffers(Uring *r, const struct iovec *iov, unsigned count)
+{
+    return sys_register(r->fd, IORING_REGISTER_BUFFERS, iov, count) < 0 ? -errno : 0;
+}
+
+bool Uring_setupBufRing(Uring *r, UringBufRing *br, uint16_t group,
+                        unsigned count, unsigned bufSize)
+{
+    memset(br, 0, sizeof(*br));
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) return false;
+
+    br->ringSize = count * sizeof(struct io_uring_buf);
+    br->baseSize = (size_t)count * bufSize;
+    br->ring = mmap(NULL, br->ringSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    br->base = mmap(NULL, br->baseSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (br->ring == MAP_FAILED || br->base == MAP_FAILED) goto fail;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)br->ring;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (sys_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) goto fail;
+
+    br->count = count;
+    br->bufSize = bufSize;
+    br->group = group;
+    for (unsigned i = 0; i < count; i++) Uring_recycleBuf(br, (uint16_t)i);
+    return true;
+
+fail:
+    if (br->ring && br->ring != MAP_FAILED) munmap(br->ring, br->ringSize);
+    if (br->base && br->base != MAP_FAILED) munmap(br->base, br->baseSize);
+    memset(br, 0, sizeof(*br));
+    return false;
+}
+
+void Uring_freeBufRing(Uring *r, UringBufRing *br)
+{
+    if (!br->ring) return;
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = br->group;
+    if (r->fd >= 0) sys_register(r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    munmap(br->ring, br->ringSize);
+    munmap(br->base, br->baseSize);
+    memset(br, 0, sizeof(*br));
+}
+
+void* Uring_bufAddr(const UringBufRing *br, uint16_t bid)
+{
+    return br->base + (size_t)bid * br->bufSize;
+}
+
+void Uring_recycleBuf(UringBufRing *br, uint16_t bid)
+{
+    // The ring's tail lives in the reserved field of entry 0
+    uint16_t tail = br->ring->tail;
+    struct io_uring_buf *b = &br->ring->bufs[tail & (br->count - 1)];
+    b->addr = (uint64_t)(uintptr_t)Uring_bufAddr(br, bid);
+    b->len = br->bufSize;
+    b->bid = bid;
+    __atomic_store_n(&br->ring->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+}
@@ -0,0 +1,103 @@
+// windowStats.c
+// Sliding-window mean/variance/min/max (see windowStats.h).
+
+#include "hal/windowStats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool WindowStats_init(WindowStats *ws, int len)
+{
+    memset(ws, 0, sizeof(*ws));
+    if (len <= 0) return false;
+    ws->values = malloc(sizeof(double) * len);
+    ws->minQ = malloc(sizeof(long long) * len);
+    ws->maxQ = malloc(sizeof(long long) * len);
+    if (!ws->values || !ws->minQ || !ws->maxQ) {
+        WindowStats_cleanup(ws);
+        return false;
+    }
+    ws->len = len;
+    return true;
+}
+
+void WindowStats_cleanup(WindowStats *ws)
+{
+    free(ws->values);
+    free(ws->minQ);
+    free(ws->maxQ);
+    memset(ws, 0, sizeof(*ws));
+}
+
+// Deque helpers: a circular array of sample numbers, oldest at head.
+#define Q_AT(q, head, i, len) ((q)[((head) + (i)) % (len)])
+
+// Push sample number `idx` (value v) onto a monotonic deque, dropping every
+// older value that can no longer be the window's min (or max).
+static void push_mono(const WindowStats *ws, long long *q, int *head, int *count,
+                      long long idx, double v, bool forMin)
+{
+    int len = ws->len;
+
+    // Expire the front first once it falls out of the window, so the deque
+    // never holds more than `len` entries.
+    if (*count > 0 && q[*head] <= idx - len) {
+        *head = (*head + 1) % len;
+        (*count)--;
+    }
+    while (*count > 0) {
+        double back = ws->values[Q_AT(q, *head, *count - 1, len) % len];
+        if (forMin ? back < v : back > v) break;
+        (*count)--;
+    }
+    Q_AT(q, *head, *count, len) = idx;
+    (*count)++;
+}
+
+void WindowStats_feed(WindowStats *ws, double v)
+{
+    int len = ws->len;
+    long long idx = ws->n;
+    int slot = (int)(idx % len);
+
+    if (ws->n >= len) {
+        double old = ws->values[slot];
+        ws->sum -= old;
+        ws->sumSq -= old * old;
+    }
+    ws->values[slot] = v;
+    ws->sum += v;
+    ws->sumSq += v * v;
+    ws->n++;
+
+    // Recompute the sums exactly once per window: amortized O(1), and it
+    // keeps add/subtract rounding from accumulating over hours of samples.
+    if (++ws->sinceRecompute >= len) {
+        int count = ws->n < len ? (int)ws->n : len;
+        double s = 0, sq = 0;
+        for (int i = 0; i < count; i++) {
+            s += ws->values[i];
+            sq += ws->values[i] * ws->values[i];
+        }
+        ws->sum = s;
+        ws->sumSq = sq;
+        ws->sinceRecompute = 0;
+    }
+
+    push_mono(ws, ws->minQ, &ws->minHead, &ws->minCount, idx, v, true);
+    push_mono(ws, ws->maxQ, &ws->maxHead, &ws->maxCount, idx, v, false);
+}
+
+void WindowStats_get(const WindowStats *ws, WindowStatsResult *out)
+{
+    memset(out, 0, sizeof(*out));
+    int count = ws->n < ws->len ? (int)ws->n : ws->len;
+    if (count == 0) return;
+
+    out->count = count;
+    out->mean = ws->sum / count;
+    out->variance = ws->sumSq / count - out->mean * out->mean;
+    if (out->variance < 0) out->variance = 0;   // rounding
+    out->min = ws->values[ws->minQ[ws->minHead] % ws->len];
+    out->max = ws->values[ws->maxQ[ws->maxHead] % ws->len];
+}
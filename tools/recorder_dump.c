@@ -0,0 +1,85 @@
+// recorder_dump.c
+// Dump a time window from a light_sampler flight recording as CSV.
+// Works on a recording left behind by a crash or power loss.
+//
+// Usage: recorder_dump FILE [--last SEC] [--from EPOCH] [--to EPOCH] [--dips]
+//   --last SEC    only the final SEC seconds of the recording
+//   --from/--to   wall-clock window in (fractional) seconds since the epoch
+//   --dips        only print samples where a dip was detected
+// Output: wall_time_s,volts,dip
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal/flightRecorder.h"
+
+typedef struct {
+    int64_t fromNs, toNs;
+    bool dipsOnly;
+    long long printed;
+    int64_t lastNs;
+} DumpArgs;
+
+static bool find_last(const RecorderRecord *rec, void *arg)
+{
+    ((DumpArgs*)arg)->lastNs = rec->timestampNs;
+    return true;
+}
+
+static bool print_record(const RecorderRecord *rec, void *arg)
+{
+    DumpArgs *a = arg;
+    if (rec->timestampNs < a->fromNs || rec->timestampNs > a->toNs) return true;
+    bool dip = rec->flags & RECORDER_FLAG_DIP;
+    if (a->dipsOnly && !dip) return true;
+    printf("%lld.%09lld,%.3f,%d\n",
+           (long long)(rec->timestampNs / 1000000000LL),
+           (long long)(rec->timestampNs % 1000000000LL), rec->volts, dip);
+    a->printed++;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option opts[] = {
+        { "last", required_argument, NULL, 'l' },
+        { "from", required_argument, NULL, 'f' },
+        { "to",   required_argument, NULL, 't' },
+        { "dips", no_argument,       NULL, 'd' },
+        { NULL, 0, NULL, 0 }
+    };
+    DumpArgs a = { .fromNs = INT64_MIN, .toNs = INT64_MAX };
+    double last = -1;
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'l': last = atof(optarg); break;
+        case 'f': a.fromNs = (int64_t)(atof(optarg) * 1e9); break;
+        case 't': a.toNs = (int64_t)(atof(optarg) * 1e9); break;
+        case 'd': a.dipsOnly = true; break;
+        default:  optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s FILE [--last SEC] [--from EPOCH] [--to EPOCH] [--dips]\n", argv[0]);
+        return 1;
+    }
+
+    RecorderFile f;
+    if (!Recorder_open(argv[optind], &f)) {
+        fprintf(stderr, "recorder_dump: %s is not a valid recording\n", argv[optind]);
+        return 1;
+    }
+    if (last >= 0) {
+        Recorder_forEach(&f, find_last, &a);
+        a.fromNs = a.lastNs - (int64_t)(last * 1e9);
+    }
+
+    printf("wall_time_s,volts,dip\n");
+    Recorder_forEach(&f, print_record, &a);
+    fprintf(stderr, "%lld records (%llu durable in header, %llu lost while recording)\n",
+            a.printed, (unsigned long long)f.hdr.count, (unsigned long long)f.hdr.lost);
+    Recorder_close(&f);
+    return 0;
+}
@@ -0,0 +1,54 @@
+// ring_tail.c
+// Follow the light sampler's shared-memory sample ring, like `tail -f`.
+// Runs alongside light_sampler on the same machine.
+//
+// Usage: ring_tail [-q]
+//   (default) print every sample as "<index> <time s> <volts> [DIP]"
+//   -q        only print a once-a-second summary (rate, dips, lost)
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal/sampleRing.h"
+#include "hal/timing.h"
+
+int main(int argc, char *argv[])
+{
+    bool quiet = (argc > 1 && !strcmp(argv[1], "-q"));
+
+    SampleRingReader r;
+    if (!SampleRing_openReader(&r)) {
+        fprintf(stderr, "ring_tail: no sample ring (is light_sampler running?)\n");
+        return 1;
+    }
+
+    SampleRingEntry batch[256];
+    long long count = 0, dips = 0;
+    long long lastReport = getTimeInMs();
+    while (true) {
+        int n = SampleRing_read(&r, batch, 256);
+        for (int i = 0; i < n; i++) {
+            bool dip = batch[i].flags & SAMPLE_RING_FLAG_DIP;
+            dips += dip;
+            if (!quiet) {
+                printf("%llu %.6f %.3f%s\n", (unsigned long long)batch[i].index,
+                       batch[i].timestampNs / 1e9, batch[i].volts, dip ? " DIP" : "");
+            }
+        }
+        count += n;
+
+        if (quiet && getTimeInMs() - lastReport >= 1000) {
+            printf("samples/s: %lld  dips: %lld  lost total: %llu\n",
+                   count, dips, (unsigned long long)r.lost);
+            fflush(stdout);
+            count = dips = 0;
+            lastReport = getTimeInMs();
+        }
+        // Nothing new: the sampler runs at ~1 kHz, so poll at a few ms
+        if (n == 0) sleepForMs(5);
+    }
+
+    SampleRing_closeReader(&r);
+    return 0;
+}
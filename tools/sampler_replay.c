@@ -0,0 +1,107 @@
+// sampler_replay.c
+// Run recorded or synthetic samples through the sampler's dip detector
+// faster than real time and report throughput and dips per second.
+//
+// Usage: sampler_replay FILE [--rate HZ] [--repeat N] [-q|--quiet]
+//        sampler_replay --synth LED_HZ [--seconds S] [--rate HZ] [--noise V]
+//        common: [--glitch P] [--median W[:THRESHOLD]]
+//   FILE        flight recording or text/CSV (see replay.h)
+//   --rate      sample rate for files without timestamps / synthesis (1000)
+//   --repeat    run the data N times (benchmark on millions of samples)
+//   --quiet     skip the per-second table
+//   --glitch    replace each sample with a 0 V ADC dropout with probability P
+//   --median    run with the median prefilter too, and report the dips it
+//               removed compared to the unfiltered detector
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal/medianFilter.h"
+#include "hal/replay.h"
+
+int main(int argc, char *argv[])
+{
+    static const struct option opts[] = {
+        { "synth",   required_argument, NULL, 's' },
+        { "seconds", required_argument, NULL, 'S' },
+        { "rate",    required_argument, NULL, 'r' },
+        { "noise",   required_argument, NULL, 'n' },
+        { "repeat",  required_argument, NULL, 'R' },
+        { "quiet",   no_argument,       NULL, 'q' },
+        { "glitch",  required_argument, NULL, 'g' },
+        { "median",  required_argument, NULL, 'm' },
+        { NULL, 0, NULL, 0 }
+    };
+    double synthHz = -1, seconds = 10, rate = 1000, noise = 0.01;
+    double glitch = 0, medianThreshold = 0;
+    int repeat = 1, medianWidth = 0;
+    bool quiet = false;
+    int c;
+    while ((c = getopt_long(argc, argv, "q", opts, NULL)) != -1) {
+        switch (c) {
+        case 's': synthHz = atof(optarg); break;
+        case 'S': seconds = atof(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'n': noise = atof(optarg); break;
+        case 'R': repeat = atoi(optarg); break;
+        case 'q': quiet = true; break;
+        case 'g': glitch = atof(optarg); break;
+        case 'm':
+            if (!MedianFilter_parseSpec(optarg, &medianWidth, &medianThreshold)) {
+                fprintf(stderr, "Bad --median %s (odd width 3..%d, optional :volts)\n",
+                        optarg, MEDIAN_MAX_WIDTH);
+                return 1;
+            }
+            break;
+        default:  return 1;
+        }
+    }
+
+    ReplayData data;
+    bool loaded = (synthHz >= 0)
+        ? Replay_synthesize(synthHz, seconds, rate, noise, &data)
+        : (optind == argc - 1 && Replay_loadFile(argv[optind], rate, &data));
+    if (!loaded || data.count == 0) {
+        fprintf(stderr, "Usage: %s FILE | --synth LED_HZ [options]\n", argv[0]);
+        return 1;
+    }
+
+    if (glitch > 0) {
+        printf("# injected %lld glitches\n", Replay_addGlitches(&data, glitch));
+    }
+
+    ReplayResult res;
+    double totalSec = 0;
+    long long totalSamples = 0;
+    for (int i = 0; i < (repeat > 0 ? repeat : 1); i++) {
+        if (i > 0) Replay_freeResult(&res);
+        if (!Replay_runFiltered(&data, medianWidth, medianThreshold, &res)) return 1;
+        totalSec += res.elapsedSec;
+        totalSamples += res.samples;
+    }
+
+    if (!quiet) {
+        printf("second,samples,dips\n");
+        for (int s = 0; s < res.numSeconds; s++) {
+            printf("%d,%d,%d\n", s, res.samplesPerSecond[s], res.dipsPerSecond[s]);
+        }
+    }
+    printf("# samples: %lld  dips: %lld  seconds: %d  avg dips/s: %.2f\n",
+           res.samples, res.dips, res.numSeconds, (double)res.dips / res.numSeconds);
+    printf("# replay: %lld samples in %.3f s = %.2f M samples/s\n",
+           totalSamples, totalSec, totalSec > 0 ? totalSamples / totalSec / 1e6 : 0.0);
+
+    if (medianWidth > 0) {
+        ReplayResult raw;
+        if (!Replay_run(&data, &raw)) return 1;
+        printf("# median %d%s: %lld dips unfiltered, %lld filtered, %lld removed\n",
+               medianWidth, medianThreshold > 0 ? " (hampel)" : "",
+               raw.dips, res.dips, raw.dips - res.dips);
+        Replay_freeResult(&raw);
+    }
+
+    Replay_freeResult(&res);
+    Replay_freeData(&data);
+    return 0;
+}